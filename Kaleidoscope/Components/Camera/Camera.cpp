@@ -529,7 +529,7 @@ namespace kaleidoscope
 	}
 
 	const char * Camera::LUA_TYPE_NAME = "kaleidoscope.camera";
-	StringID Camera::NAME = hashCRC32("camera");
+	StringID Camera::NAME = "camera"_sid;
 	U32 Camera::MAXNUMOBJECTS = 0;
 
 	bool Camera::initialized = false;
@@ -809,7 +809,7 @@ namespace kaleidoscope
 	}
 
 	const char * Light::LUA_TYPE_NAME = "kaleidoscope.light";
-	StringID Light::NAME = hashCRC32("light");
+	StringID Light::NAME = "light"_sid;
 	U32 Light::MAXNUMOBJECTS = 0;
 
 	bool Light::initialized = false;
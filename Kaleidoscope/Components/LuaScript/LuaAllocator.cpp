@@ -0,0 +1,303 @@
+#include <Components/LuaScript/LuaAllocator.h>
+
+#include <Debug/Logging/SDLLogManager.h>
+extern kaleidoscope::SDLLogManager gLogManager;
+
+#include <cstdlib>
+#include <cstring>
+#include <new>
+
+namespace kaleidoscope
+{
+	const U32 LuaAllocator::sSizeClasses[LuaAllocator::NUMSIZECLASSES] = { 16, 24, 32, 48, 64, 96, 128, 192, 256, 384, 512 };
+
+
+	LuaAllocator::LuaAllocator()
+	{
+		for (U32 i = 0; i < NUMSIZECLASSES; ++i)
+		{
+			mFreeLists[i] = NULL;
+		}
+
+		mBytesInUse = 0;
+		mPeakBytes = 0;
+		mBytesReserved = 0;
+		mNumAllocations = 0;
+		mNumPooledAllocations = 0;
+	}
+
+
+	LuaAllocator::~LuaAllocator()
+	{
+		for (std::vector<void*>::iterator c = mChunks.begin(); c != mChunks.end(); ++c)
+		{
+			std::free(*c);
+		}
+	}
+
+
+	/*
+	* void* kaleidoscope::LuaAllocator::Alloc(void* ud, void* ptr, size_t osize, size_t nsize)
+	*
+	* In: void* : The LuaAllocator the lua state was created with.
+	* In: void* : The block to resize or free, NULL for a new allocation.
+	* In: size_t : The size of the block being resized or freed.
+	* In: size_t : The requested size, 0 to free the block.
+	* Out: void* : The resized block.
+	*			   NULL if the block was freed or the allocation failed.
+	*
+	* The lua_Alloc handed to lua_newstate.
+	*/
+	void* LuaAllocator::Alloc(void* ud, void* ptr, size_t osize, size_t nsize)
+	{
+		LuaAllocator* a = static_cast<LuaAllocator*>(ud);
+
+		if (nsize == 0)
+		{
+			if (ptr != NULL)
+			{
+				a->deallocate(ptr, osize);
+			}
+			return NULL;
+		}
+
+		// When ptr is NULL osize holds the type of object being allocated, not a size.
+		if (ptr == NULL)
+		{
+			return a->allocate(nsize);
+		}
+
+		return a->reallocate(ptr, osize, nsize);
+	}
+
+
+	/*
+	* void kaleidoscope::LuaAllocator::printState() const
+	*
+	* In: void :
+	* Out: void :
+	*
+	* Print the memory statistics of the allocator.
+	*/
+	void LuaAllocator::printState() const
+	{
+		gLogManager.log("		bytes in use = %llu", mBytesInUse);
+		gLogManager.log("		peak bytes = %llu", mPeakBytes);
+		gLogManager.log("		pool bytes reserved = %llu", mBytesReserved);
+		gLogManager.log("		allocations = %llu (%llu pooled)", mNumAllocations, mNumPooledAllocations);
+	}
+
+
+	/*
+	* U32 kaleidoscope::LuaAllocator::SizeClass(size_t size)
+	*
+	* In: size_t : The size of the allocation.
+	* Out: U32 : The index of the smallest size class that fits the allocation.
+	*			 NUMSIZECLASSES if the allocation is too large to be pooled.
+	*/
+	U32 LuaAllocator::SizeClass(size_t size)
+	{
+		if (size > MAXPOOLEDSIZE)
+		{
+			return NUMSIZECLASSES;
+		}
+
+		U32 sc = 0;
+		while (sSizeClasses[sc] < size)
+		{
+			++sc;
+		}
+		return sc;
+	}
+
+
+	/*
+	* void* kaleidoscope::LuaAllocator::allocate(size_t size)
+	*
+	* In: size_t : The number of bytes to allocate.
+	* Out: void* : The new block.
+	*			   NULL if the allocation failed.
+	*/
+	void* LuaAllocator::allocate(size_t size)
+	{
+		void* block = NULL;
+		U32 sc = SizeClass(size);
+
+		if (sc < NUMSIZECLASSES)
+		{
+			if (mFreeLists[sc] == NULL)
+			{
+				refill(sc);
+			}
+
+			FreeBlock* b = mFreeLists[sc];
+			if (b != NULL)
+			{
+				mFreeLists[sc] = b->mNext;
+				block = b;
+				++mNumPooledAllocations;
+			}
+		}
+		else
+		{
+			block = std::malloc(size);
+		}
+
+		if (block != NULL)
+		{
+			++mNumAllocations;
+			mBytesInUse += size;
+			if (mBytesInUse > mPeakBytes)
+			{
+				mPeakBytes = mBytesInUse;
+			}
+		}
+
+		return block;
+	}
+
+
+	/*
+	* void kaleidoscope::LuaAllocator::deallocate(void* ptr, size_t size)
+	*
+	* In: void* : The block to free.
+	* In: size_t : The size the block was allocated with.
+	* Out: void :
+	*
+	* Pooled blocks go back on the free list of their size class, the chunk memory is held until the allocator is destroyed.
+	*/
+	void LuaAllocator::deallocate(void* ptr, size_t size)
+	{
+		U32 sc = SizeClass(size);
+
+		if (sc < NUMSIZECLASSES)
+		{
+			FreeBlock* b = static_cast<FreeBlock*>(ptr);
+			b->mNext = mFreeLists[sc];
+			mFreeLists[sc] = b;
+		}
+		else
+		{
+			std::free(ptr);
+		}
+
+		mBytesInUse -= size;
+	}
+
+
+	/*
+	* void* kaleidoscope::LuaAllocator::reallocate(void* ptr, size_t osize, size_t nsize)
+	*
+	* In: void* : The block to resize.
+	* In: size_t : The current size of the block.
+	* In: size_t : The requested size of the block.
+	* Out: void* : The resized block.
+	*			   NULL if the allocation failed, ptr is left untouched in that case as lua expects.
+	*
+	* Lua assumes shrinking never fails, so a shrink that can not get a new block keeps the old one.
+	*/
+	void* LuaAllocator::reallocate(void* ptr, size_t osize, size_t nsize)
+	{
+		U32 osc = SizeClass(osize);
+		U32 nsc = SizeClass(nsize);
+
+		// The block already fits.
+		if (osc < NUMSIZECLASSES && osc == nsc)
+		{
+			mBytesInUse += nsize;
+			mBytesInUse -= osize;
+			if (mBytesInUse > mPeakBytes)
+			{
+				mPeakBytes = mBytesInUse;
+			}
+			return ptr;
+		}
+
+		// Neither block is pooled so let the system resize in place if it can.
+		if (osc == NUMSIZECLASSES && nsc == NUMSIZECLASSES)
+		{
+			void* block = std::realloc(ptr, nsize);
+			if (block != NULL)
+			{
+				++mNumAllocations;
+				mBytesInUse += nsize;
+				mBytesInUse -= osize;
+				if (mBytesInUse > mPeakBytes)
+				{
+					mPeakBytes = mBytesInUse;
+				}
+			}
+			else if (nsize <= osize)
+			{
+				mBytesInUse -= osize - nsize;
+				return ptr;
+			}
+			return block;
+		}
+
+		void* block = allocate(nsize);
+		if (block != NULL)
+		{
+			std::memcpy(block, ptr, (osize < nsize ? osize : nsize));
+			deallocate(ptr, osize);
+		}
+		else if (nsize <= osize)
+		{
+			// The old block is at least as large as the new size class, so it is freed onto that free list later.
+			// A system block that ends up there is adopted as a chunk so the destructor still frees it.
+			// No exception may unwind through lua, if the chunk list can not grow the block is only leaked.
+			if (osc == NUMSIZECLASSES)
+			{
+				try
+				{
+					mChunks.push_back(ptr);
+				}
+				catch (const std::bad_alloc&)
+				{
+					gLogManager.log("LuaAllocator: leaking a %u byte block, the chunk list could not grow", static_cast<U32>(osize));
+				}
+			}
+			mBytesInUse -= osize - nsize;
+			return ptr;
+		}
+		return block;
+	}
+
+
+	/*
+	* void kaleidoscope::LuaAllocator::refill(U32 sizeClass)
+	*
+	* In: U32 : The size class to grow.
+	* Out: void :
+	*
+	* Carves a new chunk into blocks of the size class and pushes them onto its free list.
+	*/
+	void LuaAllocator::refill(U32 sizeClass)
+	{
+		U8* chunk = static_cast<U8*>(std::malloc(CHUNKSIZE));
+		if (chunk == NULL)
+		{
+			return;
+		}
+
+		// Called from inside lua, so running out of memory must not throw.
+		try
+		{
+			mChunks.push_back(chunk);
+		}
+		catch (const std::bad_alloc&)
+		{
+			std::free(chunk);
+			return;
+		}
+		mBytesReserved += CHUNKSIZE;
+
+		const U32 blockSize = sSizeClasses[sizeClass];
+		for (U32 offset = 0; offset + blockSize <= CHUNKSIZE; offset += blockSize)
+		{
+			FreeBlock* b = reinterpret_cast<FreeBlock*>(chunk + offset);
+			b->mNext = mFreeLists[sizeClass];
+			mFreeLists[sizeClass] = b;
+		}
+	}
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <Utility/Typedefs.h>
+
+#include <cstddef>
+#include <vector>
+
+namespace kaleidoscope
+{
+	// A lua_Alloc backed by size-class pools.
+	// Each lua state owns its own allocator so the pools are never shared across threads and need no locking,
+	//	a lua state is only ever run by one thread at a time.
+	// Blocks larger than MAXPOOLEDSIZE go straight to the system allocator.
+	class LuaAllocator
+	{
+	public:
+		LuaAllocator();
+		~LuaAllocator();
+
+		static void* Alloc(void* ud, void* ptr, size_t osize, size_t nsize);
+
+		U64 getBytesInUse() const { return mBytesInUse; };
+		U64 getPeakBytes() const { return mPeakBytes; };
+		U64 getBytesReserved() const { return mBytesReserved; };
+		U64 getNumAllocations() const { return mNumAllocations; };
+		U64 getNumPooledAllocations() const { return mNumPooledAllocations; };
+
+		void printState() const;
+
+	private:
+		static const U32 NUMSIZECLASSES = 11;
+		static const U32 MAXPOOLEDSIZE = 512;
+		static const U32 CHUNKSIZE = 16 * 1024;
+		static const U32 sSizeClasses[NUMSIZECLASSES];
+
+		static U32 SizeClass(size_t size);
+
+		void* allocate(size_t size);
+		void deallocate(void* ptr, size_t size);
+		void* reallocate(void* ptr, size_t osize, size_t nsize);
+		void refill(U32 sizeClass);
+
+		// Lua hands back the original size on every free, so blocks need no header.
+		struct FreeBlock
+		{
+			FreeBlock* mNext;
+		};
+
+		FreeBlock* mFreeLists[NUMSIZECLASSES];
+		std::vector<void*> mChunks;
+
+		U64 mBytesInUse;
+		U64 mPeakBytes;
+		U64 mBytesReserved;
+		U64 mNumAllocations;
+		U64 mNumPooledAllocations;
+
+		// Non copyable, the free lists point into chunks owned by this allocator.
+		LuaAllocator(const LuaAllocator&);
+		LuaAllocator& operator=(const LuaAllocator&);
+	};
+}
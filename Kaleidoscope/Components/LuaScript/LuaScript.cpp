@@ -8,13 +8,14 @@ extern kaleidoscope::SDLLogManager gLogManager;
 #include <Synchronization/Locks/Mutex/Mutex.h>
 #include <Synchronization/Locks/Semaphore/Semaphore.h>
 
+#include <SDL_timer.h>
+
 #include <string>
 #include <algorithm>
 
 #include <boost/foreach.hpp>
 #include <boost/optional.hpp>
 #include <boost/format.hpp>
-#include <Utility/Parsing/Lowerize.h>
 
 #include <LuaLibs/Utility/lua_old_typenames.h>
 #include <LuaLibs/Utility/lua_getters.h>
@@ -35,6 +36,7 @@ extern kaleidoscope::SDLLogManager gLogManager;
 #include <LuaLibs/Camera/CameraHandleLibLua.h>
 #include <LuaLibs/Renderer/RendererLibLua.h>
 #include <LuaLibs/Light/LightHandleLibLua.h>
+#include <LuaLibs/Task/TaskLibLua.h>
 
 #include <Utility/Parsing/parseMathsFromStrings.h>
 #include <Utility/Parsing/generateStringFromMaths.h>
@@ -46,6 +48,7 @@ namespace kaleidoscope
 	static Semaphore nameSem;
 	static Semaphore bucketSem;
 	static Semaphore errorSem;
+	static Semaphore taskSem;
 	static std::vector< StringID > reservedWorldList;
 
 	LuaScript::LuaScript()
@@ -55,6 +58,21 @@ namespace kaleidoscope
 	}
 
 
+	/*
+	* static int kaleidoscope::luapanic(lua_State* L)
+	*
+	* In: lua_State* : The lua state that raised an unprotected error.
+	* Out: int : 
+	*
+	* The panic function luaL_newstate would have installed, needed because states are created with lua_newstate.
+	*/
+	static int luapanic(lua_State* L)
+	{
+		gLogManager.log("PANIC: unprotected error in call to Lua API (%s)", lua_tostring(L, -1));
+		return 0;
+	}
+
+
 	/*
 	* bool kaleidoscope::LuaScript::init(const kaleidoscope::StringID name, const kaleidoscope::StringID fileName)
 	*
@@ -73,15 +91,46 @@ namespace kaleidoscope
 		mBucket = 0;
 		mEnabled = false;
 		mCurrentState = STARTUP_STATE;
+		mHasUpdate = false;
+
+		mUpdateRate = LuaScriptHandle::UPDATE_EVERY_FRAME;
+		mUpdateRateValue = 0.0f;
+		mFramesSinceUpdate = 0;
+		mAccumulatedDt = 0.0f;
+		mEventPending = false;
+		mOwnerTransform = TransformHandle::null;
 
 		mFileName = fileName;
-		mL = luaL_newstate();
+		mSubscriptions = new boost::unordered_map<StringID, std::string>();
+		mAllocator = NULL;
+		if (USEPOOLEDALLOCATOR)
+		{
+			mAllocator = new LuaAllocator();
+			mL = lua_newstate(LuaAllocator::Alloc, mAllocator);
+			if (mL != NULL)
+			{
+				lua_atpanic(mL, luapanic);
+			}
+		}
+		else
+		{
+			mL = luaL_newstate();
+		}
 		if (mL == NULL)
 		{
 			setError(CODE_LUA_ERROR, "Could not initialize new Lua state.");
 			return false;
 		}
 
+		// The collector is stepped by UpdateAll() so it never runs at an arbitrary point in the frame.
+		lua_gc(mL, LUA_GCSTOP, 0);
+#ifdef LUA_GCGEN
+		if (GCGENERATIONAL)
+		{
+			lua_gc(mL, LUA_GCGEN, 0);
+		}
+#endif
+
 		luaL_openlibs(mL);
 		kaleidoscope::luaopen_klogging(mL);
 		kaleidoscope::luaopen_stringID(mL);
@@ -99,6 +148,17 @@ namespace kaleidoscope
 		kaleidoscope::luaopen_CameraHandle(mL);
 		kaleidoscope::luaopen_kRenderer(mL);
 		kaleidoscope::luaopen_LightHandle(mL);
+		kaleidoscope::luaopen_kTask(mL);
+		kaleidoscope::luaset_taskowner(mL, LuaScriptHandle(this));
+
+		// Builds with KALEIDOSCOPE_STRIP_STRINGS only know the names in their string database, luaL_dofile would read
+		//	stdin given NULL.
+		if (getString(mFileName) == NULL)
+		{
+			gLogManager.log("error loading component: script file name %u is not in the string database\n", mFileName);
+			setError(CODE_LUA_ERROR, "The script file name is not in the string database.");
+			return false;
+		}
 
 		if (luaL_dofile(mL, getString(mFileName)))
 		{
@@ -107,6 +167,12 @@ namespace kaleidoscope
 			return false;
 		}
 
+		subscribeHandlers();
+
+		mGCLastKB = static_cast<U32>(lua_gc(mL, LUA_GCCOUNT, 0));
+		mGCThresholdKB = (mGCLastKB * 2 > GCMINTHRESHOLD ? mGCLastKB * 2 : GCMINTHRESHOLD);
+		mGCCycleActive = false;
+
 		return true;
 	}
 
@@ -121,9 +187,23 @@ namespace kaleidoscope
 	*/
 	bool LuaScript::destroy()
 	{
+		removeTasks();
+
+		unsubscribeAll();
+		delete mSubscriptions;
+		mSubscriptions = NULL;
+
 		if (mL != NULL)
 		{
 			lua_close(mL);
+			mL = NULL;
+		}
+
+		// The allocator must outlive the state, lua_close frees through it.
+		if (mAllocator != NULL)
+		{
+			delete mAllocator;
+			mAllocator = NULL;
 		}
 
 		mInitialized = false;
@@ -150,23 +230,28 @@ namespace kaleidoscope
 	*	<type> variable type </type>
 	*	<value> variable value </value>
 	* </variable>
+	* <updaterate>
+	*	<mode> every frame | frames | hz | event | distance </mode>
+	*	<value> frames between updates | updates per second | distance per frame skipped </value>
+	* </updaterate>
 	*/
-	static const StringID variableID = hashCRC32("variable");
-	static const StringID numberID = hashCRC32("number");
-	static const StringID boolID = hashCRC32("bool");
-	static const StringID stringidID = hashCRC32("stringid");
-	static const StringID vec3ID = hashCRC32("vec3");
-	static const StringID vec4ID = hashCRC32("vec4");
-	static const StringID mat4ID = hashCRC32("mat4");
-	static const StringID quatID = hashCRC32("quat");
-	static const StringID gameobjecthandleID = hashCRC32("gameobjecthandle");
+	static const StringID variableID = "variable"_sid;
+	static const StringID numberID = "number"_sid;
+	static const StringID boolID = "bool"_sid;
+	static const StringID stringidID = "stringid"_sid;
+	static const StringID vec3ID = "vec3"_sid;
+	static const StringID vec4ID = "vec4"_sid;
+	static const StringID mat4ID = "mat4"_sid;
+	static const StringID quatID = "quat"_sid;
+	static const StringID gameobjecthandleID = "gameobjecthandle"_sid;
+	static const StringID updaterateID = "updaterate"_sid;
 	void LuaScript::SerializeIn(const boost::property_tree::ptree& LUAScriptInfo)
 	{
 		using boost::property_tree::ptree;
 
 		BOOST_FOREACH(ptree::value_type const & lsField, LUAScriptInfo)
 		{
-			StringID lsFieldID = lowerize(lsField.first.c_str());
+			StringID lsFieldID = hashCRC32Lower(lsField.first.c_str());
 			if (lsFieldID == variableID)
 			{
 
@@ -221,6 +306,19 @@ namespace kaleidoscope
 					}
 				}
 			}
+			else if (lsFieldID == updaterateID)
+			{
+				boost::optional<std::string> mode = lsField.second.get_optional<std::string>("mode");
+				LuaScriptHandle::UpdateRate rate;
+				if (mode && UpdateRateFromString(mode->c_str(), rate))
+				{
+					setUpdateRate(rate, lsField.second.get<F32>("value", 0.0f));
+				}
+				else
+				{
+					gLogManager.log("%s: unknown update rate mode", getString(mFileName));
+				}
+			}
 		}
 	}
 
@@ -319,7 +417,7 @@ namespace kaleidoscope
 					variableInfo.add("name", lua_tostring(mL, -2));
 					variableInfo.add("type", getString(typenm));
 
-					if ((typenm == boolID) || (typenm == numberID) || (typenm == internString("string")))
+					if ((typenm == boolID) || (typenm == numberID) || (typenm == "string"_sid))
 					{
 						variableInfo.add("value", lua_tostring(mL, -1));
 					}
@@ -350,6 +448,13 @@ namespace kaleidoscope
 			lua_pop(mL, 1);
 		}
 
+		if (mUpdateRate != LuaScriptHandle::UPDATE_EVERY_FRAME)
+		{
+			ptree rateInfo;
+			rateInfo.add("mode", UpdateRateToString(mUpdateRate));
+			rateInfo.add("value", mUpdateRateValue);
+			lsI->add_child("updaterate", rateInfo);
+		}
 		
 		return lsI;
 	}
@@ -409,7 +514,7 @@ namespace kaleidoscope
 			{
 				sStartupBuckets[mBucket].push_back(LuaScriptHandle(this));
 			}
-			else if (mCurrentState == UPDATING_STATE)
+			else if (mCurrentState == UPDATING_STATE && mHasUpdate)
 			{
 				sUpdateBuckets[mBucket].push_back(LuaScriptHandle(this));
 			}
@@ -458,78 +563,616 @@ namespace kaleidoscope
 		{
 			return;
 		}
-		if (lua_pcall(mL, 0, 0, 0) != 0)
+		if (lua_pcall(mL, 0, 0, 0) != 0)
+		{
+			gLogManager.log("pcall error: start Function: %s", luaL_checklstring(mL, -1, NULL));
+		}
+
+		// Pick up handlers defined by start().
+		subscribeHandlers();
+	}
+
+
+	/*
+	* void kaleidoscope::LuaScript::update(F32 dt)
+	*
+	* In: F32 : The time since update was last called on this script.
+	* Out: void :
+	*
+	* calls the update( number ) function in the provided script.
+	*/
+	void LuaScript::update(F32 dt)
+	{
+		lua_getglobal(mL, "update");
+		if (lua_type(mL, -1) != LUA_TFUNCTION)
+		{
+			lua_pop(mL, 1);
+			return;
+		}
+		lua_pushnumber(mL, dt);
+		if (lua_pcall(mL, 1, 0, 0) != 0)
+		{
+			gLogManager.log("pcall error: update Function: %s", luaL_checklstring(mL, -1, NULL) );
+			lua_pop(mL, 1);
+		}
+	}
+
+
+	/*
+	* void kaleidoscope::LuaScript::shutdown()
+	*
+	* In: void :
+	* Out: void :
+	*
+	* Not currently implemented.
+	*/
+	void LuaScript::shutdown()
+	{
+	}
+
+
+	/*
+	* void kaleidoscope::LuaScript::onEvent(const kaleidoscope::Event& e)
+	*
+	* In: Event : The event to feed to the script.
+	* Out: void :
+	*
+	* Events sent directly to the scripts GameObject. The function with the events type name is called and
+	*	passed the event structure whether or not the script is subscribed to the type, then the scripts tasks
+	*	waiting for the type are woken. Types the string database does not know are only handled when subscribed.
+	*/
+	void LuaScript::onEvent(const Event& e)
+	{
+		boost::unordered_map<StringID, std::string>::const_iterator s = mSubscriptions->find(e.getEventType());
+		callEventHandler(e, (s != mSubscriptions->end() ? s->second.c_str() : getString(e.getEventType())));
+
+		mEventPending = true;
+		wakeEventTasks(e);
+	}
+
+
+	/*
+	* void kaleidoscope::LuaScript::onBroadcast(const kaleidoscope::Event& e)
+	*
+	* In: Event : The broadcast event to feed to the script.
+	* Out: void :
+	*
+	* Broadcasts only reach the handler while the script is subscribed to the events type, unsubscribed scripts never
+	*	touch their lua state here. Waiting tasks are left to WakeEventTasks() so each wakes once per broadcast.
+	*/
+	void LuaScript::onBroadcast(const Event& e)
+	{
+		boost::unordered_map<StringID, std::string>::const_iterator s = mSubscriptions->find(e.getEventType());
+		if (s != mSubscriptions->end())
+		{
+			callEventHandler(e, s->second.c_str());
+		}
+
+		mEventPending = true;
+	}
+
+
+	/*
+	* void kaleidoscope::LuaScript::callEventHandler(const kaleidoscope::Event& e, const char* handler)
+	*
+	* In: Event : The event to hand to the script.
+	* In: const char* : The name of the global handler function, NULL or empty when it is not known.
+	* Out: void :
+	*
+	* Calls the handler, if the script defines one.
+	*/
+	void LuaScript::callEventHandler(const Event& e, const char* handler)
+	{
+		if (handler == NULL || handler[0] == '\0')
+		{
+			return;
+		}
+
+		lua_getglobal(mL, handler);
+		if (lua_type(mL, -1) != LUA_TFUNCTION)
+		{
+			lua_pop(mL, 1);
+			return;
+		}
+
+		// The handler reads the event through a proxy, the event itself is not copied.
+		const Event** proxy = luapush_eventproxy(mL, e);
+		if (lua_pcall(mL, 1, 0, 0) != 0)
+		{
+			gLogManager.log("pcall error: onEvent Function");
+			lua_pop(mL, 1);
+		}
+		luarelease_eventproxy(mL, proxy);
+	}
+
+
+	/*
+	* void kaleidoscope::LuaScript::subscribe(kaleidoscope::StringID eventType, const char* handler)
+	*
+	* In: StringID : The event type to receive broadcasts of.
+	* In: const char* : The handler function name, NULL to look it up with getString().
+	* Out: void :
+	*
+	* The name is kept with the subscription so events are handled without getString(), which only knows the
+	*	string database under KALEIDOSCOPE_STRIP_STRINGS.
+	*/
+	void LuaScript::subscribe(StringID eventType, const char* handler)
+	{
+		if (handler == NULL)
+		{
+			handler = getString(eventType);
+		}
+
+		std::pair<boost::unordered_map<StringID, std::string>::iterator, bool> s =
+			mSubscriptions->insert(std::make_pair(eventType, std::string(handler != NULL ? handler : "")));
+		if (s.second)
+		{
+			GameObject::SubscribeScript(eventType, LuaScriptHandle(this));
+		}
+		else if (handler != NULL)
+		{
+			s.first->second = handler;
+		}
+	}
+
+
+	/*
+	* void kaleidoscope::LuaScript::unsubscribe(kaleidoscope::StringID eventType)
+	*
+	* In: StringID : The event type to stop receiving.
+	* Out: void :
+	*/
+	void LuaScript::unsubscribe(StringID eventType)
+	{
+		if (mSubscriptions->erase(eventType) != 0)
+		{
+			GameObject::UnsubscribeScript(eventType, LuaScriptHandle(this));
+		}
+	}
+
+
+	/*
+	* bool kaleidoscope::LuaScript::subscribed(kaleidoscope::StringID eventType) const
+	*
+	* In: StringID : The event type.
+	* Out: bool : true if events of this type are handed to the script.
+	*/
+	bool LuaScript::subscribed(StringID eventType) const
+	{
+		return mSubscriptions->find(eventType) != mSubscriptions->end();
+	}
+
+
+	/*
+	* void kaleidoscope::LuaScript::subscribeHandlers()
+	*
+	* In: void :
+	* Out: void :
+	*
+	* Subscribes the script to the event types listed in its global events table, events = { "collision", ... }.
+	* Scripts without the table are subscribed to every global function they define outside the libraries and
+	*	start, update and shutdown, so helper functions there cost a subscription each.
+	* Handlers defined later at runtime need kEvent.subscribe().
+	*/
+	void LuaScript::subscribeHandlers()
+	{
+		lua_getglobal(mL, "events");
+		if (lua_type(mL, -1) == LUA_TTABLE)
+		{
+			const I32 n = static_cast<I32>(lua_rawlen(mL, -1));
+			for (I32 i = 1; i <= n; ++i)
+			{
+				lua_rawgeti(mL, -1, i);
+				if (lua_type(mL, -1) == LUA_TSTRING)
+				{
+					subscribe(internString(lua_tostring(mL, -1)), lua_tostring(mL, -1));
+				}
+				lua_pop(mL, 1);
+			}
+			lua_pop(mL, 1);
+			return;
+		}
+		lua_pop(mL, 1);
+
+		lua_getglobal(mL, "_G");
+		I32 t = lua_absindex(mL, -1);
+		lua_pushnil(mL);
+		while (lua_next(mL, t) != 0)
+		{
+			if (lua_type(mL, -2) == LUA_TSTRING && lua_type(mL, -1) == LUA_TFUNCTION)
+			{
+				const StringID fn = internString(lua_tostring(mL, -2));
+				if (std::find(reservedWorldList.begin(), reservedWorldList.end(), fn) == reservedWorldList.end())
+				{
+					subscribe(fn, lua_tostring(mL, -2));
+				}
+			}
+			lua_pop(mL, 1);
+		}
+		lua_pop(mL, 1);
+	}
+
+
+	/*
+	* void kaleidoscope::LuaScript::unsubscribeAll()
+	*
+	* In: void :
+	* Out: void :
+	*/
+	void LuaScript::unsubscribeAll()
+	{
+		const LuaScriptHandle self(this);
+		for (boost::unordered_map<StringID, std::string>::iterator s = mSubscriptions->begin(); s != mSubscriptions->end(); ++s)
+		{
+			GameObject::UnsubscribeScript(s->first, self);
+		}
+		mSubscriptions->clear();
+	}
+
+
+	/*
+	* void kaleidoscope::LuaScript::setUpdateRate(kaleidoscope::LuaScriptHandle::UpdateRate rate, F32 value)
+	*
+	* In: UpdateRate : How often update() should be called.
+	* In: F32 : The frame count, frequency, or distance the rate uses, see LuaScriptHandle::UpdateRate.
+	* Out: void :
+	*
+	* Negative and NaN values are taken as 0, which updates every frame.
+	*/
+	void LuaScript::setUpdateRate(LuaScriptHandle::UpdateRate rate, F32 value)
+	{
+		mUpdateRate = rate;
+		mUpdateRateValue = (value >= 0.0f ? value : 0.0f);
+		mFramesSinceUpdate = 0;
+		mEventPending = false;
+	}
+
+
+	/*
+	* kaleidoscope::LuaScriptHandle::UpdateRate kaleidoscope::LuaScript::getUpdateRate() const
+	*
+	* In: void :
+	* Out: UpdateRate : How often update() is called.
+	*/
+	LuaScriptHandle::UpdateRate LuaScript::getUpdateRate() const
+	{
+		return mUpdateRate;
+	}
+
+
+	/*
+	* F32 kaleidoscope::LuaScript::getUpdateRateValue() const
+	*
+	* In: void :
+	* Out: F32 : The frame count, frequency, or distance the update rate uses.
+	*/
+	F32 LuaScript::getUpdateRateValue() const
+	{
+		return mUpdateRateValue;
+	}
+
+
+	/*
+	* bool kaleidoscope::LuaScript::dueForUpdate()
+	*
+	* In: void :
+	* Out: bool : true if update() should be called this frame.
+	*			  false if the script should keep accumulating time.
+	*
+	* Used by UpdateAll() after it has added this frames dt to the script.
+	*/
+	bool LuaScript::dueForUpdate()
+	{
+		switch (mUpdateRate)
+		{
+		case LuaScriptHandle::UPDATE_EVERY_N_FRAMES:
+			return static_cast<F32>(mFramesSinceUpdate) >= mUpdateRateValue;
+
+		case LuaScriptHandle::UPDATE_FIXED_HZ:
+			return (mUpdateRateValue <= 0.0f) || (mAccumulatedDt * mUpdateRateValue >= 1.0f);
+
+		case LuaScriptHandle::UPDATE_ON_EVENT:
+			return mEventPending;
+
+		case LuaScriptHandle::UPDATE_BY_DISTANCE:
+		{
+			if (mUpdateRateValue <= 0.0f)
+			{
+				return true;
+			}
+
+			if (!mOwnerTransform.valid())
+			{
+				bool b = false;
+				GameObjectHandle owner = getGlobalGameObjectHandle("this", b);
+				lua_pop(mL, 1);
+				if (!b || !owner.valid() || !owner.transform().valid())
+				{
+					return true;
+				}
+				mOwnerTransform = owner.transform();
+			}
+
+			// Clamped before the cast, far scripts and tiny distances would not fit in a U32.
+			F32 steps = math::length(mOwnerTransform.getWorldPosition() - sLODOrigin) / mUpdateRateValue;
+			U32 interval = LODMAXINTERVAL;
+			if (steps < static_cast<F32>(LODMAXINTERVAL))
+			{
+				interval = 1 + static_cast<U32>(steps);
+				if (interval > LODMAXINTERVAL)
+				{
+					interval = LODMAXINTERVAL;
+				}
+			}
+			return mFramesSinceUpdate >= interval;
+		}
+
+		default:
+			return true;
+		}
+	}
+
+
+	/*
+	* static lua_State* kaleidoscope::gettaskthread(lua_State* L, I32 ref)
+	*
+	* In: lua_State* : The lua state the task was started in.
+	* In: I32 : The registry reference of the task.
+	* Out: lua_State* : The coroutine running the task.
+	*/
+	static lua_State* gettaskthread(lua_State* L, I32 ref)
+	{
+		lua_rawgeti(L, LUA_REGISTRYINDEX, ref);
+		lua_State* co = lua_tothread(L, -1);
+		lua_pop(L, 1);
+		return co;
+	}
+
+
+	/*
+	* void kaleidoscope::LuaScript::startTask(lua_State* L, I32 nargs)
+	*
+	* In: lua_State* : The lua thread kTask.start was called from, holding the function and its arguments on top of the stack.
+	* In: I32 : The number of arguments to pass to the function.
+	* Out: void :
+	*
+	* Wraps the function in a coroutine and runs it until its first wait.
+	*/
+	void LuaScript::startTask(lua_State* L, I32 nargs)
+	{
+		lua_State* co = lua_newthread(L);
+		I32 ref = luaL_ref(L, LUA_REGISTRYINDEX);
+		lua_xmove(L, co, nargs + 1);
+		resumeTask(co, ref, nargs);
+	}
+
+
+	/*
+	* void kaleidoscope::LuaScript::resumeTask(lua_State* co, I32 ref, I32 nargs)
+	*
+	* In: lua_State* : The coroutine running the task.
+	* In: I32 : The registry reference of the task.
+	* In: I32 : The number of values on the coroutines stack to pass in.
+	* Out: void :
+	*
+	* Runs the task until it waits again, then files it in the scheduler under its wake time, wake frame, or event type.
+	* Finished and failed tasks release their registry reference.
+	* Any yield other than a kTask wait, such as a bare coroutine.yield(), waits one frame.
+	*/
+	void LuaScript::resumeTask(lua_State* co, I32 ref, I32 nargs)
+	{
+		I32 status = lua_compat_resume(co, NULL, nargs);
+
+		if (status == LUA_YIELD)
+		{
+			Task t;
+			t.mScript = LuaScriptHandle(this);
+			t.mRef = ref;
+			t.mWaitID = 0;
+
+			// Only kTask waits carry the wait key, any other yield waits one frame.
+			bool isWait = luais_taskwait(co);
+			I32 kind = (isWait ? static_cast<I32>(lua_tointeger(co, 2)) : LuaScriptHandle::TASK_WAIT_FRAMES);
+			lua_Number value = (isWait ? lua_tonumber(co, 3) : 1);
+			lua_settop(co, 0);
+
+			Semaphore::Semaphore_wait(&taskSem);
+			if (kind == LuaScriptHandle::TASK_WAIT_SECONDS)
+			{
+				sTimeTasks.insert(std::make_pair(sTaskTime + value, t));
+			}
+			else if (kind == LuaScriptHandle::TASK_WAIT_EVENT)
+			{
+				t.mWaitID = sNextEventWaitID++;
+				sEventTasks[static_cast<StringID>(value)].push_back(t);
+			}
+			else
+			{
+				U64 frames = (value < 1 ? 1 : static_cast<U64>(value));
+				sFrameTasks.insert(std::make_pair(sTaskFrame + frames, t));
+			}
+			Semaphore::Semaphore_post(&taskSem);
+		}
+		else
+		{
+			if (status != 0)
+			{
+				gLogManager.log("task error in %s: %s", getString(mFileName), lua_tostring(co, -1));
+			}
+			luaL_unref(mL, LUA_REGISTRYINDEX, ref);
+		}
+	}
+
+
+	/*
+	* void kaleidoscope::LuaScript::wakeEventTasks(const kaleidoscope::Event& e)
+	*
+	* In: Event : The event this script just received.
+	* Out: void :
+	*
+	* Resumes this scripts tasks that are waiting for the events type, kTask.waitForEvent returns the event.
+	*/
+	void LuaScript::wakeEventTasks(const Event& e)
+	{
+		std::vector<Task> woken;
+		const LuaScriptHandle self(this);
+
+		Semaphore::Semaphore_wait(&taskSem);
+		boost::unordered_map<StringID, std::list<Task> >::iterator waiting = sEventTasks.find(e.getEventType());
+		if (waiting != sEventTasks.end())
+		{
+			for (std::list<Task>::iterator t = waiting->second.begin(); t != waiting->second.end();)
+			{
+				if ((*t).mScript == self)
+				{
+					woken.push_back(*t);
+					t = waiting->second.erase(t);
+				}
+				else
+				{
+					++t;
+				}
+			}
+			if (waiting->second.empty())
+			{
+				sEventTasks.erase(waiting);
+			}
+		}
+		Semaphore::Semaphore_post(&taskSem);
+
+		for (std::vector<Task>::iterator t = woken.begin(); t != woken.end(); ++t)
 		{
-			gLogManager.log("pcall error: start Function: %s", luaL_checklstring(mL, -1, NULL));
+			lua_State* co = gettaskthread(mL, (*t).mRef);
+			luapush_event(co, e);
+			resumeTask(co, (*t).mRef, 1);
 		}
 	}
 
 
 	/*
-	* void kaleidoscope::LuaScript::update(F32 dt)
-	*
-	* In: F32 : The time since update was last called on this script.
-	* Out: void :
+	* U64 kaleidoscope::LuaScript::EventTaskMark()
 	*
-	* calls the update( number ) function in the provided script.
+	* In: void :
+	* Out: U64 : Orders event waits, tasks that wait after it is taken are not woken by WakeEventTasks() with it.
 	*/
-	void LuaScript::update(F32 dt)
+	U64 LuaScript::EventTaskMark()
 	{
-		lua_getglobal(mL, "update");
-		if (lua_type(mL, -1) != LUA_TFUNCTION)
-		{
-			lua_pop(mL, 1);
-			return;
-		}
-		lua_pushnumber(mL, dt);
-		if (lua_pcall(mL, 1, 0, 0) != 0)
-		{
-			gLogManager.log("pcall error: update Function: %s", luaL_checklstring(mL, -1, NULL) );
-			lua_pop(mL, 1);
-		}
+		Semaphore::Semaphore_wait(&taskSem);
+		const U64 mark = sNextEventWaitID;
+		Semaphore::Semaphore_post(&taskSem);
+		return mark;
 	}
 
 
 	/*
-	* void kaleidoscope::LuaScript::shutdown()
+	* void kaleidoscope::LuaScript::WakeEventTasks(const kaleidoscope::Event& e, U64 mark)
 	*
-	* In: void :
+	* In: Event : The event being broadcast.
+	* In: U64 : The EventTaskMark() taken when the broadcast began.
 	* Out: void :
 	*
-	* Not currently implemented.
+	* Resumes every task waiting for the events type, used by broadcasts so tasks wake in scripts that are not subscribed.
+	* Tasks that started waiting during the broadcast, such as one woken by it that waits again, are left for the next.
 	*/
-	void LuaScript::shutdown()
+	void LuaScript::WakeEventTasks(const Event& e, U64 mark)
 	{
+		std::list<Task> woken;
+
+		Semaphore::Semaphore_wait(&taskSem);
+		boost::unordered_map<StringID, std::list<Task> >::iterator waiting = sEventTasks.find(e.getEventType());
+		if (waiting != sEventTasks.end())
+		{
+			for (std::list<Task>::iterator t = waiting->second.begin(); t != waiting->second.end();)
+			{
+				std::list<Task>::iterator next = t;
+				++next;
+				if ((*t).mWaitID < mark)
+				{
+					woken.splice(woken.end(), waiting->second, t);
+				}
+				t = next;
+			}
+			if (waiting->second.empty())
+			{
+				sEventTasks.erase(waiting);
+			}
+		}
+		Semaphore::Semaphore_post(&taskSem);
+
+		for (std::list<Task>::iterator t = woken.begin(); t != woken.end(); ++t)
+		{
+			LuaScript* ls = (*t).mScript.getObject();
+			if (ls == NULL)
+			{
+				continue;
+			}
+			lua_State* co = gettaskthread(ls->mL, (*t).mRef);
+			luapush_event(co, e);
+			ls->resumeTask(co, (*t).mRef, 1);
+		}
 	}
 
 
 	/*
-	* void kaleidoscope::LuaScript::onEvent(const kaleidoscope::Event& e)
+	* void kaleidoscope::LuaScript::removeTasks()
 	*
-	* In: Event : The event to feed to the script.
+	* In: void :
 	* Out: void :
 	*
-	* This function looks to see if the script has a function with the provided events type name
-	*	and if it does, it calls that function and passes it the event structure.
+	* Drops every waiting task owned by this script from the scheduler.
+	* The coroutines themselves go away with the lua state.
 	*/
-	void LuaScript::onEvent(const Event& e)
+	void LuaScript::removeTasks()
 	{
-		lua_getglobal(mL, getString(e.getEventType()));
-		if (lua_type(mL, -1) != LUA_TFUNCTION)
+		const LuaScriptHandle self(this);
+
+		Semaphore::Semaphore_wait(&taskSem);
+		for (std::multimap<F64, Task>::iterator t = sTimeTasks.begin(); t != sTimeTasks.end();)
 		{
-			lua_pop(mL, 1);
-			return;
+			if (t->second.mScript == self)
+			{
+				sTimeTasks.erase(t++);
+			}
+			else
+			{
+				++t;
+			}
 		}
-		else
+		for (std::multimap<U64, Task>::iterator t = sFrameTasks.begin(); t != sFrameTasks.end();)
 		{
-			kaleidoscope::Event* lua_e = newudata<Event>(mL, eventTypeName);
-			*lua_e = e;
-			if (lua_pcall(mL, 1, 0, 0) != 0)
+			if (t->second.mScript == self)
 			{
-				gLogManager.log("pcall error: onEvent Function");
-				lua_pop(mL, 1);
+				sFrameTasks.erase(t++);
+			}
+			else
+			{
+				++t;
+			}
+		}
+		for (boost::unordered_map<StringID, std::list<Task> >::iterator waiting = sEventTasks.begin(); waiting != sEventTasks.end();)
+		{
+			for (std::list<Task>::iterator t = waiting->second.begin(); t != waiting->second.end();)
+			{
+				if ((*t).mScript == self)
+				{
+					t = waiting->second.erase(t);
+				}
+				else
+				{
+					++t;
+				}
+			}
+
+			if (waiting->second.empty())
+			{
+				waiting = sEventTasks.erase(waiting);
+			}
+			else
+			{
+				++waiting;
 			}
 		}
+		Semaphore::Semaphore_post(&taskSem);
 	}
 
 
@@ -904,6 +1547,23 @@ namespace kaleidoscope
 	}
 
 
+	/*
+	* U64 kaleidoscope::LuaScript::getMemoryUsage() const
+	*
+	* In: void :
+	* Out: U64 : The number of bytes currently allocated by the lua state.
+	*/
+	U64 LuaScript::getMemoryUsage() const
+	{
+		if (mAllocator != NULL)
+		{
+			return mAllocator->getBytesInUse();
+		}
+
+		return (static_cast<U64>(lua_gc(mL, LUA_GCCOUNT, 0)) * 1024) + static_cast<U64>(lua_gc(mL, LUA_GCCOUNTB, 0));
+	}
+
+
 	/*
 	* void kaleidoscope::LuaScript::printState() const
 	*
@@ -920,6 +1580,11 @@ namespace kaleidoscope
 		gLogManager.log("		filename = %s", getString(mFileName));
 		gLogManager.log("		mPoolIndex = %i", mPoolIndex);
 		gLogManager.log("		mBucket = %u", mBucket);
+		gLogManager.log("		memory = %llu bytes", getMemoryUsage());
+		if (mAllocator != NULL)
+		{
+			mAllocator->printState();
+		}
 	}
 
 
@@ -932,6 +1597,13 @@ namespace kaleidoscope
 	*
 	* objects = U32 The maximum number of luascript that can be allocated.
 	* buckets = U32 The maximum number of update buckets.
+	* gc frame time = F32 The frame time in ms that UpdateAll() fits the garbage collection steps into.
+	* gc min budget = F32 The minimum time in ms given to garbage collection each frame.
+	* gc step size = U32 The smallest size in KB of an incremental collection step, steps grow with what the state allocated.
+	* gc generational = bool Run the collectors in generational mode instead of incremental.
+	* lod max interval = U32 The most frames a script updated by distance can go without an update.
+	* allocator = string "pooled" to give each lua state its own size-class pool allocator, "system" to use malloc.
+	*			  Ignored in LuaJIT builds.
 	*/
 	bool LuaScript::StartUp(const boost::property_tree::ptree& properties)
 	{
@@ -961,7 +1633,22 @@ namespace kaleidoscope
 				NUMBUCKETS = DEFAULTMAXBUCKS;
 			}
 
-			if (Semaphore::Semaphore_init(&createSem, 1) != 0 || Semaphore::Semaphore_init(&nameSem, 1) != 0 || Semaphore::Semaphore_init(&bucketSem, 1) != 0 || Semaphore::Semaphore_init(&errorSem, 1) != 0)
+			GCFRAMETIME = properties.get<F32>("gc frame time", DEFAULTGCFRAMETIME);
+			GCMINBUDGET = properties.get<F32>("gc min budget", DEFAULTGCMINBUDGET);
+			GCSTEPSIZE = properties.get<U32>("gc step size", DEFAULTGCSTEPSIZE);
+			GCGENERATIONAL = properties.get<bool>("gc generational", false);
+			LODMAXINTERVAL = properties.get<U32>("lod max interval", DEFAULTLODMAXINTERVAL);
+			USEPOOLEDALLOCATOR = (properties.get<std::string>("allocator", "pooled").compare("system") != 0);
+#ifdef KALEIDOSCOPE_LUAJIT
+			// LuaJIT manages its own memory on 64 bit targets and rejects custom allocators there.
+			USEPOOLEDALLOCATOR = false;
+			gLogManager.log("LuaScript running on %s", LUAJIT_VERSION);
+#else
+			gLogManager.log("LuaScript running on %s", LUA_RELEASE);
+#endif
+			sGCCursor = 0;
+
+			if (Semaphore::Semaphore_init(&createSem, 1) != 0 || Semaphore::Semaphore_init(&nameSem, 1) != 0 || Semaphore::Semaphore_init(&bucketSem, 1) != 0 || Semaphore::Semaphore_init(&errorSem, 1) != 0 || Semaphore::Semaphore_init(&taskSem, 1) != 0)
 			{
 				initialized = false;
 				return false;
@@ -989,7 +1676,7 @@ namespace kaleidoscope
 
 
 			reservedWorldList.push_back(internString("assert"));
-			reservedWorldList.push_back(internString("collectgarbade"));
+			reservedWorldList.push_back(internString("collectgarbage"));
 			reservedWorldList.push_back(internString("dofile"));
 			reservedWorldList.push_back(internString("error"));
 			reservedWorldList.push_back(internString("getmetatable"));
@@ -1033,7 +1720,27 @@ namespace kaleidoscope
 			reservedWorldList.push_back(internString("GameObjectHandle"));
 			reservedWorldList.push_back(internString("kEvent"));
 			reservedWorldList.push_back(internString("kApplication"));
+			reservedWorldList.push_back(internString("kTask"));
 			reservedWorldList.push_back(internString("_VERSION"));
+			reservedWorldList.push_back(internString("_G"));
+			reservedWorldList.push_back(internString("unpack"));
+			reservedWorldList.push_back(internString("loadstring"));
+			reservedWorldList.push_back(internString("module"));
+			reservedWorldList.push_back(internString("newproxy"));
+			reservedWorldList.push_back(internString("gcinfo"));
+			reservedWorldList.push_back(internString("setfenv"));
+			reservedWorldList.push_back(internString("getfenv"));
+			reservedWorldList.push_back(internString("jit"));
+			reservedWorldList.push_back(internString("bit"));
+			reservedWorldList.push_back(internString("utf8"));
+			reservedWorldList.push_back(internString("RenderableHandle"));
+			reservedWorldList.push_back(internString("CameraHandle"));
+			reservedWorldList.push_back(internString("LightHandle"));
+			reservedWorldList.push_back(internString("kRenderer"));
+			reservedWorldList.push_back(internString("events"));
+			reservedWorldList.push_back(internString("start"));
+			reservedWorldList.push_back(internString("update"));
+			reservedWorldList.push_back(internString("shutdown"));
 
 			return true;
 
@@ -1060,9 +1767,14 @@ namespace kaleidoscope
 
 			delete[] sLUAScriptPool;
 
+			sTimeTasks.clear();
+			sFrameTasks.clear();
+			sEventTasks.clear();
+
 			Semaphore::Semaphore_destroy(&createSem);
 			Semaphore::Semaphore_destroy(&nameSem);
 			Semaphore::Semaphore_destroy(&bucketSem);
+			Semaphore::Semaphore_destroy(&taskSem);
 
 			return true;
 		}
@@ -1206,6 +1918,34 @@ namespace kaleidoscope
 	}
 
 
+	/*
+	* void kaleidoscope::LuaScript::printMemoryUsage()
+	*
+	* In: void :
+	* Out: void :
+	*
+	* Print the number of bytes each live lua state is using, and the total across all of them.
+	*/
+	void LuaScript::printMemoryUsage()
+	{
+		U64 total = 0;
+		U32 numStates = 0;
+
+		gLogManager.log("Lua memory usage.");
+		for (U32 i = 0; i < MAXNUMOBJECTS; ++i)
+		{
+			if (sLUAScriptPool[i].mInitialized && sLUAScriptPool[i].mL != NULL)
+			{
+				U64 bytes = sLUAScriptPool[i].getMemoryUsage();
+				gLogManager.log("	script (%s, %s) %llu bytes", getString(sLUAScriptPool[i].mName), getString(sLUAScriptPool[i].mFileName), bytes);
+				total += bytes;
+				++numStates;
+			}
+		}
+		gLogManager.log("%u states, %llu bytes total", numStates, total);
+	}
+
+
 	/*
 	* bool kaleidoscope::LuaScript::hasPendingError()
 	*
@@ -1318,9 +2058,15 @@ namespace kaleidoscope
 	*
 	* Simulates all active luascripts.
 	* Calls startup() if they are new, and calls update() on all.
+	* Whatever is left of the frame time afterwards is handed to the garbage collectors.
 	*/
 	void LuaScript::UpdateAll(F32 dt)
 	{
+		const U64 frameStart = SDL_GetPerformanceCounter();
+
+		// Deliver the events queued last frame before any script runs.
+		GameObject::DispatchEvents(dt);
+
 		// Startup each script.
 		for (U32 bucket = 0; bucket < NUMBUCKETS; ++bucket)
 		{
@@ -1329,9 +2075,19 @@ namespace kaleidoscope
 				std::list<LuaScriptHandle>::iterator curr = scr++;
 				if ((*curr).valid())
 				{
-					(*curr).getObject()->startUp();
-					(*curr).getObject()->mCurrentState = UPDATING_STATE;
-					sUpdateBuckets[bucket].push_back((*curr));
+					LuaScript* ls = (*curr).getObject();
+					ls->startUp();
+					ls->mCurrentState = UPDATING_STATE;
+
+					// Scripts that only react to events or run tasks never need to be visited by the update loop.
+					lua_getglobal(ls->mL, "update");
+					ls->mHasUpdate = (lua_type(ls->mL, -1) == LUA_TFUNCTION);
+					lua_pop(ls->mL, 1);
+
+					if (ls->mHasUpdate)
+					{
+						sUpdateBuckets[bucket].push_back((*curr));
+					}
 				}
 				sStartupBuckets[bucket].erase(curr);
 			}
@@ -1344,7 +2100,27 @@ namespace kaleidoscope
 			{
 				if ((*scr).valid() && (*scr).getObject()->mBucket == bucket)
 				{
-					(*scr).getObject()->update(dt);
+					LuaScript* ls = (*scr).getObject();
+					ls->mAccumulatedDt += dt;
+					++ls->mFramesSinceUpdate;
+
+					if (ls->dueForUpdate())
+					{
+						F32 elapsed = ls->mAccumulatedDt;
+						ls->mAccumulatedDt = 0.0f;
+						if (ls->mUpdateRate == LuaScriptHandle::UPDATE_FIXED_HZ && ls->mUpdateRateValue > 0.0f)
+						{
+							// Carry the remainder over so the rate holds, but never more than one period so a
+							//	long hitch is not made up over the following frames.
+							const F32 period = 1.0f / ls->mUpdateRateValue;
+							const F32 remainder = elapsed - period;
+							ls->mAccumulatedDt = (remainder < period ? remainder : period);
+							elapsed = period;
+						}
+						ls->mFramesSinceUpdate = 0;
+						ls->mEventPending = false;
+						ls->update(elapsed);
+					}
 				}
 				else
 				{
@@ -1354,6 +2130,263 @@ namespace kaleidoscope
 			}
 		}
 
+		RunTasks(dt);
+
+		// Size this frames gc budget to the time the scripts left over.
+		F32 elapsedMS = static_cast<F32>(SDL_GetPerformanceCounter() - frameStart) * 1000.0f / static_cast<F32>(SDL_GetPerformanceFrequency());
+		F32 budgetMS = GCFRAMETIME - elapsedMS;
+		if (budgetMS < GCMINBUDGET)
+		{
+			budgetMS = GCMINBUDGET;
+		}
+		StepGarbageCollectors(budgetMS);
+	}
+
+
+	/*
+	* void kaleidoscope::LuaScript::SetUpdateLODOrigin(const kaleidoscope::math::vec3& origin)
+	*
+	* In: vec3 : The world position scripts updated by distance measure from, usually the view camera.
+	* Out: void :
+	*/
+	void LuaScript::SetUpdateLODOrigin(const math::vec3& origin)
+	{
+		sLODOrigin = origin;
+	}
+
+
+	static const StringID everyframeID = "every frame"_sid;
+	static const StringID framesID = "frames"_sid;
+	static const StringID hzID = "hz"_sid;
+	static const StringID eventID = "event"_sid;
+	static const StringID distanceID = "distance"_sid;
+	/*
+	* bool kaleidoscope::LuaScript::UpdateRateFromString(const char * rateName, kaleidoscope::LuaScriptHandle::UpdateRate& rate)
+	*
+	* In: const char * : The name of the rate, one of "every frame", "frames", "hz", "event", "distance". Case insensitive.
+	* In: UpdateRate : Set to the named rate.
+	* Out: bool : true if the name was recognized.
+	*			  false if it was not, rate is left untouched.
+	*/
+	bool LuaScript::UpdateRateFromString(const char * rateName, LuaScriptHandle::UpdateRate& rate)
+	{
+		StringID id = hashCRC32Lower(rateName);
+		if (id == everyframeID)
+		{
+			rate = LuaScriptHandle::UPDATE_EVERY_FRAME;
+		}
+		else if (id == framesID)
+		{
+			rate = LuaScriptHandle::UPDATE_EVERY_N_FRAMES;
+		}
+		else if (id == hzID)
+		{
+			rate = LuaScriptHandle::UPDATE_FIXED_HZ;
+		}
+		else if (id == eventID)
+		{
+			rate = LuaScriptHandle::UPDATE_ON_EVENT;
+		}
+		else if (id == distanceID)
+		{
+			rate = LuaScriptHandle::UPDATE_BY_DISTANCE;
+		}
+		else
+		{
+			return false;
+		}
+		return true;
+	}
+
+
+	/*
+	* const char * kaleidoscope::LuaScript::UpdateRateToString(kaleidoscope::LuaScriptHandle::UpdateRate rate)
+	*
+	* In: UpdateRate : The rate to name.
+	* Out: const char * : The name UpdateRateFromString() accepts for the rate.
+	*/
+	const char * LuaScript::UpdateRateToString(LuaScriptHandle::UpdateRate rate)
+	{
+		switch (rate)
+		{
+		case LuaScriptHandle::UPDATE_EVERY_N_FRAMES: return "frames";
+		case LuaScriptHandle::UPDATE_FIXED_HZ: return "hz";
+		case LuaScriptHandle::UPDATE_ON_EVENT: return "event";
+		case LuaScriptHandle::UPDATE_BY_DISTANCE: return "distance";
+		default: return "every frame";
+		}
+	}
+
+
+	/*
+	* void kaleidoscope::LuaScript::RunTasks(F32 dt)
+	*
+	* In: F32 : The time since the last call to RunTasks()
+	* Out: void :
+	*
+	* Advances the task clock and frame counter and resumes every task whose wait is over.
+	* Sleeping tasks sit in sorted maps, so only the tasks that wake this frame cost anything.
+	*/
+	void LuaScript::RunTasks(F32 dt)
+	{
+		std::vector<Task> due;
+
+		Semaphore::Semaphore_wait(&taskSem);
+		sTaskTime += dt;
+		++sTaskFrame;
+
+		std::multimap<F64, Task>::iterator timeEnd = sTimeTasks.upper_bound(sTaskTime);
+		for (std::multimap<F64, Task>::iterator t = sTimeTasks.begin(); t != timeEnd; ++t)
+		{
+			due.push_back(t->second);
+		}
+		sTimeTasks.erase(sTimeTasks.begin(), timeEnd);
+
+		std::multimap<U64, Task>::iterator frameEnd = sFrameTasks.upper_bound(sTaskFrame);
+		for (std::multimap<U64, Task>::iterator t = sFrameTasks.begin(); t != frameEnd; ++t)
+		{
+			due.push_back(t->second);
+		}
+		sFrameTasks.erase(sFrameTasks.begin(), frameEnd);
+		Semaphore::Semaphore_post(&taskSem);
+
+		// Resumed tasks can wait again straight away, they land in the maps for a later frame.
+		for (std::vector<Task>::iterator t = due.begin(); t != due.end(); ++t)
+		{
+			LuaScript* ls = (*t).mScript.getObject();
+			if (ls != NULL)
+			{
+				ls->resumeTask(gettaskthread(ls->mL, (*t).mRef), (*t).mRef, 0);
+			}
+		}
+	}
+
+
+	/*
+	* void kaleidoscope::LuaScript::StepGarbageCollectors(F32 budgetMS)
+	*
+	* In: F32 : The time in ms the garbage collectors may use.
+	* Out: void :
+	*
+	* Each step is sized to what the state allocated since its last step, so collection keeps pace with allocation.
+	* States whose heap has grown past their threshold are stepped first whatever the budget, so a heavy frame
+	*	can not starve collection. The rest are stepped round-robin, picking up with the state after the last one
+	*	stepped, and any budget left over advances unfinished cycles until it is used up.
+	*/
+	void LuaScript::StepGarbageCollectors(F32 budgetMS)
+	{
+		if (MAXNUMOBJECTS == 0)
+		{
+			return;
+		}
+
+		for (U32 i = 0; i < MAXNUMOBJECTS; ++i)
+		{
+			LuaScript* ls = &sLUAScriptPool[i];
+			if (ls->mInitialized && ls->mL != NULL && static_cast<U32>(lua_gc(ls->mL, LUA_GCCOUNT, 0)) >= ls->mGCThresholdKB)
+			{
+				ls->stepGarbageCollector(ls->getGCDebt());
+			}
+		}
+
+		const U64 start = SDL_GetPerformanceCounter();
+		const U64 budgetTicks = static_cast<U64>(budgetMS * static_cast<F32>(SDL_GetPerformanceFrequency()) / 1000.0f);
+
+		// Pay off the allocation debt, then spend what is left finishing cycles.
+		bool payingDebt = true;
+		bool stepped = true;
+		while (stepped)
+		{
+			stepped = false;
+			for (U32 visited = 0; visited < MAXNUMOBJECTS; ++visited)
+			{
+				LuaScript* ls = &sLUAScriptPool[sGCCursor];
+				sGCCursor = (sGCCursor + 1) % MAXNUMOBJECTS;
+
+				if (!ls->mInitialized || ls->mL == NULL)
+				{
+					continue;
+				}
+
+				const U32 debt = ls->getGCDebt();
+				if (payingDebt ? debt > 0 : ls->mGCCycleActive)
+				{
+					ls->stepGarbageCollector(payingDebt ? debt : 0);
+					stepped = true;
+
+					if (SDL_GetPerformanceCounter() - start >= budgetTicks)
+					{
+						return;
+					}
+				}
+			}
+
+			if (payingDebt)
+			{
+				payingDebt = false;
+				stepped = true;
+			}
+		}
+	}
+
+
+	/*
+	* bool kaleidoscope::LuaScript::stepGarbageCollector(U32 stepKB)
+	*
+	* In: U32 : The KB of allocation the step should do the work for, at least GCSTEPSIZE is done.
+	* Out: bool : true if the step finished a collection cycle.
+	*
+	* A finished cycle sets the next threshold to twice the live heap, like the automatic collectors pause.
+	*/
+	bool LuaScript::stepGarbageCollector(U32 stepKB)
+	{
+		const bool finished = (lua_gc(mL, LUA_GCSTEP, static_cast<int>(stepKB > GCSTEPSIZE ? stepKB : GCSTEPSIZE)) != 0);
+		mGCLastKB = static_cast<U32>(lua_gc(mL, LUA_GCCOUNT, 0));
+		mGCCycleActive = !finished;
+		if (finished)
+		{
+			mGCThresholdKB = (mGCLastKB * 2 > GCMINTHRESHOLD ? mGCLastKB * 2 : GCMINTHRESHOLD);
+		}
+		return finished;
+	}
+
+
+	/*
+	* U32 kaleidoscope::LuaScript::getGCDebt() const
+	*
+	* In: void :
+	* Out: U32 : The KB allocated since the last gc step.
+	*/
+	U32 LuaScript::getGCDebt() const
+	{
+		const U32 now = static_cast<U32>(lua_gc(mL, LUA_GCCOUNT, 0));
+		return (now > mGCLastKB ? now - mGCLastKB : 0);
+	}
+
+
+	/*
+	* void kaleidoscope::LuaScript::FullCollect()
+	*
+	* In: void :
+	* Out: void :
+	*
+	* Runs a full collection on every live lua state.
+	* This stalls for as long as it takes, only call it when a stall is invisible such as on a load screen.
+	* Each state's growth baseline and forced step threshold restart from its heap after the collection.
+	*/
+	void LuaScript::FullCollect()
+	{
+		for (U32 i = 0; i < MAXNUMOBJECTS; ++i)
+		{
+			LuaScript* s = &(sLUAScriptPool[i]);
+			if (s->mInitialized && s->mL != NULL)
+			{
+				lua_gc(s->mL, LUA_GCCOLLECT, 0);
+				s->mGCLastKB = static_cast<U32>(lua_gc(s->mL, LUA_GCCOUNT, 0));
+				s->mGCThresholdKB = (s->mGCLastKB * 2 > GCMINTHRESHOLD ? s->mGCLastKB * 2 : GCMINTHRESHOLD);
+				s->mGCCycleActive = false;
+			}
+		}
 	}
 
 
@@ -1374,7 +2407,14 @@ namespace kaleidoscope
 		}
 		else if (lh.getObject()->mCurrentState == UPDATING_STATE)
 		{
-			LuaScript::AddToBucket(bucket, lh, sUpdateBuckets);
+			if (lh.getObject()->mHasUpdate)
+			{
+				LuaScript::AddToBucket(bucket, lh, sUpdateBuckets);
+			}
+			else
+			{
+				lh.getObject()->mBucket = bucket;
+			}
 		}
 	}
 
@@ -1424,7 +2464,7 @@ namespace kaleidoscope
 
 	U32 LuaScript::MAXNUMOBJECTS;
 	U32 LuaScript::NUMBUCKETS;
-	StringID LuaScript::NAME = hashCRC32("luascript");
+	StringID LuaScript::NAME = "luascript"_sid;
 
 	std::vector< std::list<LuaScriptHandle> > LuaScript::sStartupBuckets;
 	std::vector< std::list<LuaScriptHandle> > LuaScript::sUpdateBuckets;
@@ -1432,6 +2472,29 @@ namespace kaleidoscope
 	const U32 LuaScript::DEFAULTMAXOBJS = 10;
 	const U32 LuaScript::DEFAULTMAXBUCKS = 3;
 
+	F32 LuaScript::GCFRAMETIME;
+	F32 LuaScript::GCMINBUDGET;
+	U32 LuaScript::GCSTEPSIZE;
+	bool LuaScript::GCGENERATIONAL = false;
+
+	bool LuaScript::USEPOOLEDALLOCATOR = true;
+	U32 LuaScript::sGCCursor = 0;
+
+	U32 LuaScript::LODMAXINTERVAL;
+	math::vec3 LuaScript::sLODOrigin;
+	const U32 LuaScript::DEFAULTLODMAXINTERVAL = 8;
+
+	F64 LuaScript::sTaskTime = 0.0;
+	U64 LuaScript::sTaskFrame = 0;
+	U64 LuaScript::sNextEventWaitID = 0;
+	std::multimap<F64, LuaScript::Task> LuaScript::sTimeTasks;
+	std::multimap<U64, LuaScript::Task> LuaScript::sFrameTasks;
+	boost::unordered_map<StringID, std::list<LuaScript::Task> > LuaScript::sEventTasks;
+
+	const F32 LuaScript::DEFAULTGCFRAMETIME = 16.0f;
+	const F32 LuaScript::DEFAULTGCMINBUDGET = 0.25f;
+	const U32 LuaScript::DEFAULTGCSTEPSIZE = 16;
+
 	bool LuaScript::initialized = false;
 
 	LuaScript* LuaScript::sFirstFree = NULL;
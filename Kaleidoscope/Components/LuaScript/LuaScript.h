@@ -7,18 +7,18 @@
 #include <Debug/ErrorManagement/ErrorManager.h>
 
 #include <Components/LuaScript/LuaScriptHandle.h>
+#include <Components/LuaScript/LuaAllocator.h>
+#include <Components/Transform/TransformHandle.h>
 
 #include <list>
 #include <vector>
+#include <map>
+#include <string>
 
-extern "C"
-{
-	#include <lua.h>
-	#include <lualib.h>
-	#include <lauxlib.h>
-}
+#include <LuaLibs/Utility/lua_compat.h>
 
 #include <boost/property_tree/ptree.hpp>
+#include <boost/unordered_map.hpp>
 
 
 namespace kaleidoscope
@@ -60,6 +60,26 @@ namespace kaleidoscope
 		void shutdown();
 
 		void onEvent(const Event& e);
+		void onBroadcast(const Event& e);
+		void callEventHandler(const Event& e, const char* handler);
+
+		// Event types whose broadcasts this script receives, the handler is the global function named after the type.
+		void subscribe(StringID eventType, const char* handler = NULL);
+		void unsubscribe(StringID eventType);
+		bool subscribed(StringID eventType) const;
+		void subscribeHandlers();
+		void unsubscribeAll();
+
+		void setUpdateRate(LuaScriptHandle::UpdateRate rate, F32 value);
+		LuaScriptHandle::UpdateRate getUpdateRate() const;
+		F32 getUpdateRateValue() const;
+		bool dueForUpdate();
+
+		// Tasks are coroutines started with kTask.start() that sleep in the scheduler until their wait is over.
+		void startTask(lua_State* L, I32 nargs);
+		void resumeTask(lua_State* co, I32 ref, I32 nargs);
+		void wakeEventTasks(const Event& e);
+		void removeTasks();
 
 		// T getT(StringID name)
 		F32 getGlobalNumber(const char * name, bool& success);
@@ -84,6 +104,10 @@ namespace kaleidoscope
 		template <class T>
 		void addudata(const char * name, const char * udataName, T dataToCopy);
 
+		U64 getMemoryUsage() const;
+		bool stepGarbageCollector(U32 stepKB);
+		U32 getGCDebt() const;
+
 		void printState() const;
 
 
@@ -101,6 +125,19 @@ namespace kaleidoscope
 
 				StringID mFileName;
 				lua_State* mL;
+				bool mHasUpdate; // Scripts without an update() function are kept out of the update buckets.
+
+				LuaScriptHandle::UpdateRate mUpdateRate;
+				F32 mUpdateRateValue;
+				U32 mFramesSinceUpdate;
+				F32 mAccumulatedDt;		// Time since update() was last called, handed to update() so throttled scripts see the real dt.
+				bool mEventPending;
+				TransformHandle mOwnerTransform;	// Resolved on first use by UPDATE_BY_DISTANCE.
+				LuaAllocator* mAllocator; // NULL when the state uses the system allocator.
+				boost::unordered_map<StringID, std::string>* mSubscriptions; // Event type to handler function name.
+				U32 mGCLastKB;			// The heap size after the last gc step, what was allocated since is the debt.
+				U32 mGCThresholdKB;		// Past this the state is stepped whatever the budget.
+				bool mGCCycleActive;	// A collection cycle is part way through.
 
 			};
 
@@ -118,7 +155,19 @@ namespace kaleidoscope
 
 		static void UpdateAll(F32 dt);
 
+		static void StepGarbageCollectors(F32 budgetMS);
+		static void FullCollect();
+
+		static void RunTasks(F32 dt);
+		static U64 EventTaskMark();
+		static void WakeEventTasks(const Event& e, U64 mark);
+
+		static void SetUpdateLODOrigin(const math::vec3& origin);
+		static bool UpdateRateFromString(const char * rateName, LuaScriptHandle::UpdateRate& rate);
+		static const char * UpdateRateToString(LuaScriptHandle::UpdateRate rate);
+
 		static void printBuckets();
+		static void printMemoryUsage();
 
 		static bool hasPendingError();
 		static void clearError();
@@ -138,10 +187,41 @@ namespace kaleidoscope
 		static std::vector< std::list<LuaScriptHandle> > sStartupBuckets;
 		static std::vector< std::list<LuaScriptHandle> > sUpdateBuckets;
 
+		struct Task
+		{
+			LuaScriptHandle mScript;
+			I32 mRef; // Registry reference keeping the coroutine alive.
+			U64 mWaitID; // Event waits only, in the order they were made.
+		};
+		static F64 sTaskTime;
+		static U64 sTaskFrame;
+		static U64 sNextEventWaitID;
+		static std::multimap<F64, Task> sTimeTasks;
+		static std::multimap<U64, Task> sFrameTasks;
+		static boost::unordered_map<StringID, std::list<Task> > sEventTasks;
+
 
 		static const U32 DEFAULTMAXOBJS;
 		static const U32 DEFAULTMAXBUCKS;
 
+		// Garbage collection is driven by UpdateAll() instead of by each states allocator.
+		static F32 GCFRAMETIME;		// ms, The frame time UpdateAll() tries to fit the gc steps into.
+		static F32 GCMINBUDGET;		// ms, The smallest gc budget handed out per frame so collection never starves.
+		static U32 GCSTEPSIZE;		// KB, The smallest incremental step.
+		static const U32 GCMINTHRESHOLD = 1024;	// KB, The lowest forced step threshold.
+		static bool GCGENERATIONAL;
+
+		static bool USEPOOLEDALLOCATOR;
+		static U32 sGCCursor;		// The pool index the next gc step starts at.
+
+		static U32 LODMAXINTERVAL;	// The most frames an UPDATE_BY_DISTANCE script can go without an update.
+		static math::vec3 sLODOrigin;
+		static const U32 DEFAULTLODMAXINTERVAL;
+
+		static const F32 DEFAULTGCFRAMETIME;
+		static const F32 DEFAULTGCMINBUDGET;
+		static const U32 DEFAULTGCSTEPSIZE;
+
 		static bool initialized;
 
 		static LuaScript* sFirstFree;
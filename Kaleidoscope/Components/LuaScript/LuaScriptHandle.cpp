@@ -48,6 +48,19 @@ namespace kaleidoscope
 	void LuaScriptHandle::disable() { getObject()->disable(); }
 
 	void LuaScriptHandle::onEvent(const Event& e) { getObject()->onEvent(e); }
+	void LuaScriptHandle::onBroadcast(const Event& e) { getObject()->onBroadcast(e); }
+
+	void LuaScriptHandle::subscribe(StringID eventType, const char* handler) { getObject()->subscribe(eventType, handler); }
+	void LuaScriptHandle::unsubscribe(StringID eventType) { getObject()->unsubscribe(eventType); }
+	bool LuaScriptHandle::isSubscribed(StringID eventType) const { return getObject()->subscribed(eventType); }
+
+	void LuaScriptHandle::setUpdateRate(UpdateRate rate, F32 value) { getObject()->setUpdateRate(rate, value); }
+	LuaScriptHandle::UpdateRate LuaScriptHandle::getUpdateRate() const { return getObject()->getUpdateRate(); }
+	F32 LuaScriptHandle::getUpdateRateValue() const { return getObject()->getUpdateRateValue(); }
+
+	void LuaScriptHandle::startTask(lua_State* L, I32 nargs) { getObject()->startTask(L, nargs); }
+	U64 LuaScriptHandle::EventTaskMark() { return LuaScript::EventTaskMark(); }
+	void LuaScriptHandle::WakeEventTasks(const Event& e, U64 mark) { LuaScript::WakeEventTasks(e, mark); }
 
 	// T getT(StringID name)
 	F32 LuaScriptHandle::getGlobalNumber(const char * name, bool& success) { return getObject()->getGlobalNumber(name, success); }
@@ -69,6 +82,8 @@ namespace kaleidoscope
 	void LuaScriptHandle::setGlobalquat(const char * name, const math::quat& value) { getObject()->setGlobalquat(name, value); }
 	void LuaScriptHandle::setGlobalGameObjectHandle(const char * name, const GameObjectHandle& value) { getObject()->setGlobalGameObjectHandle(name, value); }
 
+	U64 LuaScriptHandle::getMemoryUsage() const { return getObject()->getMemoryUsage(); }
+
 	void LuaScriptHandle::printState() const { getObject()->printState(); }
 
 
@@ -96,7 +111,15 @@ namespace kaleidoscope
 
 	void LuaScriptHandle::UpdateAll(F32 dt) { LuaScript::UpdateAll(dt); }
 
+	void LuaScriptHandle::SetUpdateLODOrigin(const math::vec3& origin) { LuaScript::SetUpdateLODOrigin(origin); }
+	bool LuaScriptHandle::UpdateRateFromString(const char * rateName, UpdateRate& rate) { return LuaScript::UpdateRateFromString(rateName, rate); }
+	const char * LuaScriptHandle::UpdateRateToString(UpdateRate rate) { return LuaScript::UpdateRateToString(rate); }
+
+	void LuaScriptHandle::StepGarbageCollectors(F32 budgetMS) { LuaScript::StepGarbageCollectors(budgetMS); }
+	void LuaScriptHandle::FullCollect() { LuaScript::FullCollect(); }
+
 	void LuaScriptHandle::printBuckets() { LuaScript::printBuckets(); }
+	void LuaScriptHandle::printMemoryUsage() { LuaScript::printMemoryUsage(); }
 
 	void LuaScriptHandle::AddToBucket(const U32 bucket, const LuaScriptHandle& lh) { LuaScript::AddToBucket(bucket, lh); }
 
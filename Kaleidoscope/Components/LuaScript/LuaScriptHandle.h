@@ -11,6 +11,8 @@
 
 #include <boost/property_tree/ptree.hpp>
 
+struct lua_State;
+
 namespace kaleidoscope
 {
 	class LuaScript;
@@ -61,7 +63,36 @@ namespace kaleidoscope
 		void enable();
 		void disable();
 
-		void onEvent(const Event& e);
+		void onEvent(const Event& e);		// Sent to the scripts GameObject.
+		void onBroadcast(const Event& e);	// Broadcast to subscribers.
+
+		void subscribe(StringID eventType, const char* handler = NULL);
+		void unsubscribe(StringID eventType);
+		bool isSubscribed(StringID eventType) const;
+
+		// Update rates.
+		enum UpdateRate
+		{
+			UPDATE_EVERY_FRAME,		// value is unused.
+			UPDATE_EVERY_N_FRAMES,	// value is the number of frames between updates.
+			UPDATE_FIXED_HZ,		// value is the number of updates per second.
+			UPDATE_ON_EVENT,		// update() runs once on the frame after the script receives an event, value is unused.
+			UPDATE_BY_DISTANCE		// value is the distance from the view camera that adds one frame between updates.
+		};
+		void setUpdateRate(UpdateRate rate, F32 value = 0.0f);
+		UpdateRate getUpdateRate() const;
+		F32 getUpdateRateValue() const;
+
+		// Tasks.
+		enum TaskWait
+		{
+			TASK_WAIT_SECONDS,
+			TASK_WAIT_FRAMES,
+			TASK_WAIT_EVENT
+		};
+		void startTask(lua_State* L, I32 nargs);
+		static U64 EventTaskMark();
+		static void WakeEventTasks(const Event& e, U64 mark);
 
 		// T getT(StringID name)
 		F32 getGlobalNumber(const char * name, bool& success);
@@ -86,6 +117,8 @@ namespace kaleidoscope
 		template <class T>
 		void addudata(const char * name, const char * udataName, T dataToCopy);
 
+		U64 getMemoryUsage() const;
+
 		void printState() const;
 
 
@@ -107,7 +140,15 @@ namespace kaleidoscope
 
 		static void UpdateAll(F32 dt);
 
+		static void SetUpdateLODOrigin(const math::vec3& origin);
+		static bool UpdateRateFromString(const char * rateName, UpdateRate& rate);
+		static const char * UpdateRateToString(UpdateRate rate);
+
+		static void StepGarbageCollectors(F32 budgetMS);
+		static void FullCollect();
+
 		static void printBuckets();
+		static void printMemoryUsage();
 
 		static void AddToBucket(const U32 bucket, const LuaScriptHandle& lh);
 
@@ -9,6 +9,8 @@ extern kaleidoscope::SDLLogManager gLogManager;
 
 
 #include <string>
+#include <algorithm>
+#include <cmath>
 #include <boost/foreach.hpp>
 #include <boost/optional.hpp>
 #include <boost/foreach.hpp>
@@ -57,6 +59,22 @@ namespace kaleidoscope
 
 		mTransform = th;
 
+		mPendingMesh = 0;
+		mPendingMeshPath = 0;
+		mPendingMaterials = NULL;
+		mPendingTextures = new boost::unordered_map<U32, std::pair<U32, StringID> >();
+		mDeferredTextures = new boost::unordered_map<U32, irr::video::ITexture*>();
+		mLoadedCallback = NULL;
+		mLoadedUserData = NULL;
+		mSlotTextures = new boost::unordered_map<U32, irr::video::ITexture*>();
+		mStatic = false;
+		mBatched = false;
+		mStaticChunk = 0;
+		mLODs = new std::vector<LODLevel>();
+		mCurrentLOD = 0;
+		mBaseMesh = NULL;
+		mAutoLODs = 0;
+
 		return true;
 	}
 
@@ -71,13 +89,40 @@ namespace kaleidoscope
 	*/
 	bool Renderable::destroy()
 	{
+		staticChanged();
+		mStatic = false;
+		mBatched = false;
+
+		clearLODs();
+		delete mLODs;
+		mLODs = NULL;
+
+		if (mirrMesh != NULL)
+		{
+			mIrrController->releaseMesh(mirrMesh->getMesh());
+		}
 		mIrrController->removeSceneNode(mirrMesh);
 
+		releaseSlotTextures();
+		delete mSlotTextures;
+		mSlotTextures = NULL;
+		releaseDeferredTextures();
+		delete mDeferredTextures;
+		mDeferredTextures = NULL;
+
 		mMeshPath = 0;
 		mAlbedoPath = 0;
 
 		mTransform = TransformHandle::null;
 
+		// Loads still in flight are dropped when they arrive, their tickets no longer match.
+		mPendingMesh = 0;
+		delete mPendingMaterials;
+		mPendingMaterials = NULL;
+		delete mPendingTextures;
+		mPendingTextures = NULL;
+		mLoadedCallback = NULL;
+
 		mInitialized = false;
 		mNextInFreeList = NULL;
 
@@ -96,6 +141,11 @@ namespace kaleidoscope
 	* Fill in the renderables state with the values provided by the property tree.
 	*
 	* <mesh>path/to/mesh</mesh>
+	* <lod>
+	*	<mesh>path/to/coarser/mesh</mesh>
+	*	<screen-size>number</screen-size>
+	* </lod>
+	* <auto-lod>number</auto-lod>
 	* <material-list>
 	*	<material>
 	*		<shader>diffuse</shader>
@@ -118,9 +168,37 @@ namespace kaleidoscope
 			setMesh(internString((*mesh).c_str()));
 		}
 
+		BOOST_FOREACH(ptree::value_type const& lod, renderableInfo)
+		{
+			if (lod.first.compare("lod") == 0)
+			{
+				boost::optional<std::string> lodMesh = lod.second.get_optional<std::string>("mesh");
+				boost::optional<F32> screenSize = lod.second.get_optional<F32>("screen-size");
+				if (lodMesh && screenSize)
+				{
+					addLOD(internString((*lodMesh).c_str()), *screenSize);
+				}
+			}
+		}
+
+		boost::optional<U32> autoLOD = renderableInfo.get_optional<U32>("auto-lod");
+		if (autoLOD)
+		{
+			setAutoLOD(*autoLOD);
+		}
+
 		if (matList)
 		{
-			SerializeMaterialListIn(*matList);
+			// The materials belong to the mesh being loaded, not the placeholder.
+			if (mPendingMesh != 0)
+			{
+				delete mPendingMaterials;
+				mPendingMaterials = new ptree(*matList);
+			}
+			else
+			{
+				SerializeMaterialListIn(*matList);
+			}
 		}
 
 
@@ -220,6 +298,21 @@ namespace kaleidoscope
 			rI->add("mesh", getString(mMeshPath));
 		}
 
+		for (std::vector<LODLevel>::const_iterator l = mLODs->begin(); l != mLODs->end(); ++l)
+		{
+			if (l->mPath != 0)
+			{
+				ptree& lod = rI->add("lod", "");
+				lod.add("mesh", getString(l->mPath));
+				lod.add<F32>("screen-size", l->mScreenSize);
+			}
+		}
+
+		if (mAutoLODs != 0)
+		{
+			rI->add<U32>("auto-lod", mAutoLODs);
+		}
+
 		if (mAlbedoPath != 0)
 		{
 			rI->add("material.albedo", getString(mAlbedoPath));
@@ -234,15 +327,38 @@ namespace kaleidoscope
 	*
 	* In: StringID : The path to the mesh to set.
 	* Out: void :
+	*
+	* The mesh is shared with every other renderable using it, the current mesh is kept if the new one fails to load.
+	* With async loading the mesh is swapped in by MeshLoaded(), a placeholder is shown if there is no mesh until then.
 	*/
 	void Renderable::setMesh(StringID mesh)
 	{
+		if (ASYNCLOADING)
+		{
+			if (mirrMesh->getMesh() == NULL)
+			{
+				mirrMesh->setMesh(mIrrController->getPlaceholderMesh());
+			}
+			mPendingMeshPath = mesh;
+			mPendingMesh = mIrrController->loadMeshAsync(getString(mesh), MeshLoaded, this);
+			return;
+		}
+
 		irr::scene::IMesh* m = mIrrController->getMesh(getString(mesh));
-		mirrMesh->setMesh(m);
 
 		if (m != NULL)
 		{
+			resetLOD();
+			irr::scene::IMesh* previous = mirrMesh->getMesh();
+			mirrMesh->setMesh(m);
+			mIrrController->releaseMesh(previous);
 			mMeshPath = mesh;
+
+			// The new meshes materials replace the textures set on the old ones.
+			releaseSlotTextures();
+			releaseDeferredTextures();
+			staticChanged();
+			rebuildAutoLODs();
 		}
 	}
 
@@ -257,6 +373,17 @@ namespace kaleidoscope
 	*/
 	void Renderable::removeMesh()
 	{
+		mPendingMesh = 0;
+		delete mPendingMaterials;
+		mPendingMaterials = NULL;
+		mPendingTextures->clear();
+		releaseSlotTextures();
+		releaseDeferredTextures();
+		staticChanged();
+		mBatched = false;
+		clearLODs();
+
+		mIrrController->releaseMesh(mirrMesh->getMesh());
 		mIrrController->removeSceneNode(mirrMesh);
 		mirrMesh = mIrrController->addMeshSceneNode();
 
@@ -266,6 +393,32 @@ namespace kaleidoscope
 	}
 
 
+	/*
+	* bool kaleidoscope::Renderable::loading() const
+	*
+	* In: void :
+	* Out: bool : true if a mesh or texture set on the renderable is still loading.
+	*/
+	bool Renderable::loading() const
+	{
+		return (mPendingMesh != 0 || !mPendingTextures->empty());
+	}
+
+
+	/*
+	* void kaleidoscope::Renderable::setLoadedCallback(kaleidoscope::RenderableHandle::LoadedCallback callback, void* userData)
+	*
+	* In: LoadedCallback : Called as each asset requested by the renderable finishes loading, NULL for none.
+	* In: void* : Handed back to the callback.
+	* Out: void :
+	*/
+	void Renderable::setLoadedCallback(RenderableHandle::LoadedCallback callback, void* userData)
+	{
+		mLoadedCallback = callback;
+		mLoadedUserData = userData;
+	}
+
+
 	/*
 	* bool kaleidoscope::Renderable::visible() const
 	*
@@ -275,7 +428,7 @@ namespace kaleidoscope
 	*/
 	bool Renderable::visible() const
 	{
-		return mirrMesh->isVisible();
+		return (mBatched || mirrMesh->isVisible());
 	}
 
 
@@ -289,7 +442,11 @@ namespace kaleidoscope
 	*/
 	void Renderable::makeVisible()
 	{
-		mirrMesh->setVisible(true);
+		if (!visible())
+		{
+			mirrMesh->setVisible(true);
+			staticChanged();
+		}
 	}
 
 
@@ -303,7 +460,12 @@ namespace kaleidoscope
 	*/
 	void Renderable::makeInvisible()
 	{
-		mirrMesh->setVisible(false);
+		if (visible())
+		{
+			staticChanged();
+			mirrMesh->setVisible(false);
+			mBatched = false;
+		}
 	}
 
 
@@ -331,11 +493,13 @@ namespace kaleidoscope
 	*/
 	void Renderable::setMaterialShader(U32 matNumber, StringID shader)
 	{
-		if (shader == internString("diffuse"))
+		staticChanged();
+
+		if (shader == "diffuse"_sid)
 		{
 			mirrMesh->getMaterial(matNumber).MaterialType = irr::video::EMT_SOLID;
 		}
-		else if (shader == internString("normal mapped"))
+		else if (shader == "normal mapped"_sid)
 		{
 			mirrMesh->getMaterial(matNumber).MaterialType = irr::video::EMT_NORMAL_MAP_SOLID;
 		}
@@ -374,7 +538,7 @@ namespace kaleidoscope
 	*/
 	void Renderable::setMaterialAlbedo(U32 matNumber, StringID path)
 	{
-		mirrMesh->getMaterial(matNumber).setTexture(0, mIrrController->getTexture(getString(path)));
+		setMaterialTexture(matNumber, 0, path);
 	}
 
 
@@ -387,7 +551,40 @@ namespace kaleidoscope
 	*/
 	void Renderable::setMaterialNormalMap(U32 matNumber, StringID path)
 	{
-		mirrMesh->getMaterial(matNumber).setTexture(1, mIrrController->getTexture(getString(path)));
+		setMaterialTexture(matNumber, 1, path);
+	}
+
+
+	/*
+	* void kaleidoscope::Renderable::setMaterialTexture(U32 matNumber, U32 layer, kaleidoscope::StringID path)
+	*
+	* In: U32 : The number of the material to change.
+	* In: U32 : The texture layer, 0 for albedo and 1 for the normal map.
+	* In: StringID : The path to the texture.
+	* Out: void :
+	*
+	* With async loading an empty layer shows the placeholder texture until TextureLoaded() sets the real one.
+	* Materials the placeholder mesh does not have are requested all the same, the texture is applied once the mesh arrives.
+	*/
+	void Renderable::setMaterialTexture(U32 matNumber, U32 layer, StringID path)
+	{
+		if (!ASYNCLOADING)
+		{
+			setSlotTexture(matNumber, layer, mIrrController->getTexture(getString(path)));
+			return;
+		}
+
+		if (matNumber < numMaterials() && mirrMesh->getMaterial(matNumber).getTexture(layer) == NULL)
+		{
+			setSlotTexture(matNumber, layer, mIrrController->getPlaceholderTexture());
+		}
+
+		// Only the latest request for a slot is applied.
+		const U32 slot = matNumber * 2 + layer;
+		cancelSlotRequests(slot);
+
+		U32 ticket = mIrrController->loadTextureAsync(getString(path), TextureLoaded, this);
+		(*mPendingTextures)[ticket] = std::make_pair(slot, path);
 	}
 
 
@@ -400,6 +597,7 @@ namespace kaleidoscope
 	*/
 	void Renderable::setMaterialShininess(U32 matNumber, F32 val)
 	{
+		staticChanged();
 		mirrMesh->getMaterial(matNumber).Shininess = val;
 	}
 
@@ -427,6 +625,7 @@ namespace kaleidoscope
 	*/
 	void Renderable::setMaterialSpecularColor(U32 matNumber, const math::vec4& c)
 	{
+		staticChanged();
 		math::ivec4 ic = static_cast<math::ivec4>(c);
 		mirrMesh->getMaterial(matNumber).SpecularColor = irr::video::SColor(ic.w, ic.x, ic.y, ic.z);
 	}
@@ -470,7 +669,10 @@ namespace kaleidoscope
 			mAlbedoPath = albedoTex;
 		}
 
-		mirrMesh->setMaterialTexture(0, tex);
+		for (U32 i = 0; i < numMaterials(); ++i)
+		{
+			setSlotTexture(i, 0, tex);
+		}
 	}
 
 
@@ -493,6 +695,540 @@ namespace kaleidoscope
 	}
 
 
+	/*
+	* void kaleidoscope::Renderable::setSlotTexture(U32 matNumber, U32 layer, irr::video::ITexture* texture)
+	*
+	* In: U32 : The number of the material to change.
+	* In: U32 : The texture layer.
+	* In: ITexture* : The texture to set, may be NULL.
+	* Out: void :
+	*
+	* Sets the texture and moves the renderables reference on the slot from the old texture to the new one.
+	* Materials past numMaterials() are ignored, the node would hand back Irrlichts shared IdentityMaterial.
+	*/
+	void Renderable::setSlotTexture(U32 matNumber, U32 layer, irr::video::ITexture* texture)
+	{
+		if (matNumber >= numMaterials())
+		{
+			return;
+		}
+
+		const U32 slot = matNumber * 2 + layer;
+
+		mIrrController->acquireTexture(texture);
+		boost::unordered_map<U32, irr::video::ITexture*>::iterator held = mSlotTextures->find(slot);
+		if (held != mSlotTextures->end())
+		{
+			mIrrController->releaseTexture(held->second);
+		}
+		(*mSlotTextures)[slot] = texture;
+
+		mirrMesh->getMaterial(matNumber).setTexture(layer, texture);
+		staticChanged();
+	}
+
+
+	/*
+	* void kaleidoscope::Renderable::releaseSlotTextures()
+	*
+	* In: void :
+	* Out: void :
+	*
+	* Drops the references held on every material slot, used when the materials are replaced or destroyed.
+	*/
+	void Renderable::releaseSlotTextures()
+	{
+		for (boost::unordered_map<U32, irr::video::ITexture*>::iterator t = mSlotTextures->begin(); t != mSlotTextures->end(); ++t)
+		{
+			mIrrController->releaseTexture(t->second);
+		}
+		mSlotTextures->clear();
+	}
+
+
+	/*
+	* void kaleidoscope::Renderable::cancelSlotRequests(U32 slot)
+	*
+	* In: U32 : The material slot, material * 2 + layer.
+	* Out: void :
+	*
+	* Drops the texture still loading for the slot and the one waiting for the pending mesh, a newer texture replaces them.
+	*/
+	void Renderable::cancelSlotRequests(U32 slot)
+	{
+		for (boost::unordered_map<U32, std::pair<U32, StringID> >::iterator t = mPendingTextures->begin(); t != mPendingTextures->end(); ++t)
+		{
+			if (t->second.first == slot)
+			{
+				mPendingTextures->erase(t);
+				break;
+			}
+		}
+
+		boost::unordered_map<U32, irr::video::ITexture*>::iterator deferred = mDeferredTextures->find(slot);
+		if (deferred != mDeferredTextures->end())
+		{
+			mIrrController->releaseTexture(deferred->second);
+			mDeferredTextures->erase(deferred);
+		}
+	}
+
+
+	/*
+	* void kaleidoscope::Renderable::releaseDeferredTextures()
+	*
+	* In: void :
+	* Out: void :
+	*
+	* Drops the textures that were waiting for the pending mesh.
+	*/
+	void Renderable::releaseDeferredTextures()
+	{
+		for (boost::unordered_map<U32, irr::video::ITexture*>::iterator t = mDeferredTextures->begin(); t != mDeferredTextures->end(); ++t)
+		{
+			mIrrController->releaseTexture(t->second);
+		}
+		mDeferredTextures->clear();
+	}
+
+
+	/*
+	* void kaleidoscope::Renderable::setStatic(bool value)
+	*
+	* In: bool : true if the renderable never moves.
+	* Out: void :
+	*
+	* Static renderables are merged into the static batches the next time the renderables update. Their transform is
+	*	read when their chunk is built, moving one afterwards needs another change to rebuild the chunk.
+	*/
+	void Renderable::setStatic(bool value)
+	{
+		if (value != mStatic)
+		{
+			mStatic = value;
+			staticChanged();
+		}
+	}
+
+	bool Renderable::isStatic() const { return mStatic; }
+
+
+	/*
+	* void kaleidoscope::Renderable::addLOD(kaleidoscope::StringID mesh, F32 screenSize)
+	*
+	* In: StringID : The path to a coarser version of the mesh.
+	* In: F32 : The fraction of the screens height below which the level is shown.
+	* Out: void :
+	*
+	* The level is skipped until its mesh has loaded.
+	*/
+	void Renderable::addLOD(StringID mesh, F32 screenSize)
+	{
+		resetLOD();
+
+		LODLevel level;
+		level.mPath = mesh;
+		level.mScreenSize = screenSize;
+		level.mMesh = NULL;
+		level.mTicket = 0;
+		if (ASYNCLOADING)
+		{
+			level.mTicket = mIrrController->loadMeshAsync(getString(mesh), LODLoaded, this);
+		}
+		else
+		{
+			level.mMesh = mIrrController->getMesh(getString(mesh));
+		}
+
+		mLODs->push_back(level);
+		std::sort(mLODs->begin(), mLODs->end(), LODOrder);
+	}
+
+
+	/*
+	* void kaleidoscope::Renderable::setAutoLOD(U32 levels)
+	*
+	* In: U32 : The number of levels to generate from the mesh, at most 3.
+	* Out: void :
+	*
+	* The levels are generated by the IrrlichtController and regenerated whenever the mesh changes.
+	*/
+	void Renderable::setAutoLOD(U32 levels)
+	{
+		mAutoLODs = (levels < 3 ? levels : 3);
+		rebuildAutoLODs();
+	}
+
+
+	/*
+	* void kaleidoscope::Renderable::clearLODs()
+	*
+	* In: void :
+	* Out: void :
+	*
+	* Shows the mesh set with setMesh() and drops every level.
+	*/
+	void Renderable::clearLODs()
+	{
+		resetLOD();
+		for (std::vector<LODLevel>::iterator l = mLODs->begin(); l != mLODs->end(); ++l)
+		{
+			mIrrController->releaseMesh(l->mMesh);
+		}
+		mLODs->clear();
+		mAutoLODs = 0;
+	}
+
+
+	/*
+	* U32 kaleidoscope::Renderable::getLOD() const
+	*
+	* In: void :
+	* Out: U32 : The level shown, 0 for the mesh set with setMesh().
+	*/
+	U32 Renderable::getLOD() const
+	{
+		return mCurrentLOD;
+	}
+
+
+	/*
+	* void kaleidoscope::Renderable::updateLOD()
+	*
+	* In: void :
+	* Out: void :
+	*
+	* Picks the level for the renderables size on screen as seen from the LOD camera.
+	* Each boundary has to be passed by LODHYSTERESIS of its size to go back to the level shown, so a renderable
+	*	sitting on a boundary does not switch every frame.
+	*/
+	void Renderable::updateLOD()
+	{
+		if (mLODs->empty() || !sLODCameraValid)
+		{
+			return;
+		}
+
+		const irr::core::aabbox3df& box = mirrMesh->getTransformedBoundingBox();
+		const irr::core::vector3df camera(sLODCameraPosition.x, sLODCameraPosition.y, sLODCameraPosition.z);
+		const F32 radius = box.getExtent().getLength() * 0.5f;
+		const F32 distance = camera.getDistanceFrom(box.getCenter());
+		const F32 size = (distance > radius ? radius / (distance * sLODTanHalfFOV) : 1.0f);
+
+		U32 level = 0;
+		for (U32 i = 0; i < mLODs->size(); ++i)
+		{
+			const F32 threshold = (*mLODs)[i].mScreenSize * (mCurrentLOD > i ? 1.0f + LODHYSTERESIS : 1.0f - LODHYSTERESIS);
+			if (size < threshold)
+			{
+				level = i + 1;
+			}
+		}
+
+		while (level > 0 && (*mLODs)[level - 1].mMesh == NULL)
+		{
+			--level;
+		}
+
+		if (level != mCurrentLOD)
+		{
+			showLOD(level);
+		}
+	}
+
+
+	/*
+	* void kaleidoscope::Renderable::showLOD(U32 level)
+	*
+	* In: U32 : The level to show, its mesh must be loaded.
+	* Out: void :
+	*
+	* Swaps the mesh of the scene node keeping the materials, so textures and shaders set on the renderable carry
+	*	over to every level.
+	*/
+	void Renderable::showLOD(U32 level)
+	{
+		if (mCurrentLOD == 0)
+		{
+			mBaseMesh = mirrMesh->getMesh();
+		}
+		irr::scene::IMesh* mesh = (level == 0 ? mBaseMesh : (*mLODs)[level - 1].mMesh);
+
+		std::vector<irr::video::SMaterial> materials;
+		for (U32 i = 0; i < mirrMesh->getMaterialCount(); ++i)
+		{
+			materials.push_back(mirrMesh->getMaterial(i));
+		}
+
+		mirrMesh->setMesh(mesh);
+
+		for (U32 i = 0; i < mirrMesh->getMaterialCount() && i < materials.size(); ++i)
+		{
+			mirrMesh->getMaterial(i) = materials[i];
+		}
+
+		mCurrentLOD = level;
+		if (level == 0)
+		{
+			mBaseMesh = NULL;
+		}
+	}
+
+
+	/*
+	* void kaleidoscope::Renderable::resetLOD()
+	*
+	* In: void :
+	* Out: void :
+	*
+	* Shows the mesh set with setMesh(), used before anything that changes or releases it.
+	*/
+	void Renderable::resetLOD()
+	{
+		if (mCurrentLOD != 0)
+		{
+			showLOD(0);
+		}
+	}
+
+
+	/*
+	* void kaleidoscope::Renderable::rebuildAutoLODs()
+	*
+	* In: void :
+	* Out: void :
+	*
+	* Replaces the generated levels with ones generated from the current mesh.
+	*/
+	void Renderable::rebuildAutoLODs()
+	{
+		resetLOD();
+
+		for (std::vector<LODLevel>::iterator l = mLODs->begin(); l != mLODs->end();)
+		{
+			if (l->mPath == 0)
+			{
+				mIrrController->releaseMesh(l->mMesh);
+				l = mLODs->erase(l);
+			}
+			else
+			{
+				++l;
+			}
+		}
+
+		irr::scene::IMesh* mesh = mirrMesh->getMesh();
+		if (mesh != NULL && mesh != mIrrController->getPlaceholderMesh())
+		{
+			for (U32 i = 1; i <= mAutoLODs; ++i)
+			{
+				irr::scene::IMesh* simplified = mIrrController->getSimplifiedMesh(mesh, i);
+				if (simplified == NULL)
+				{
+					break;
+				}
+
+				LODLevel level;
+				level.mPath = 0;
+				level.mScreenSize = AUTOLODSIZE / static_cast<F32>(1 << (i - 1));
+				level.mMesh = simplified;
+				level.mTicket = 0;
+				mLODs->push_back(level);
+			}
+		}
+
+		std::sort(mLODs->begin(), mLODs->end(), LODOrder);
+	}
+
+
+	/*
+	* void kaleidoscope::Renderable::LODLoaded(void* userData, U32 ticket, irr::scene::IMesh* mesh)
+	*
+	* In: void* : The renderable that requested the level.
+	* In: U32 : The ticket of the request.
+	* In: IMesh* : The loaded mesh, NULL if it failed to load.
+	* Out: void :
+	*/
+	void Renderable::LODLoaded(void* userData, U32 ticket, irr::scene::IMesh* mesh)
+	{
+		Renderable* r = static_cast<Renderable*>(userData);
+		if (r->mInitialized)
+		{
+			for (std::vector<LODLevel>::iterator l = r->mLODs->begin(); l != r->mLODs->end(); ++l)
+			{
+				if (l->mTicket == ticket)
+				{
+					l->mTicket = 0;
+					l->mMesh = mesh;
+					return;
+				}
+			}
+		}
+
+		// The level was dropped while it loaded.
+		mIrrController->releaseMesh(mesh);
+	}
+
+
+	bool Renderable::LODOrder(const LODLevel& lhs, const LODLevel& rhs)
+	{
+		return lhs.mScreenSize > rhs.mScreenSize;
+	}
+
+
+	/*
+	* void kaleidoscope::Renderable::staticChanged()
+	*
+	* In: void :
+	* Out: void :
+	*
+	* Called before anything the static batches copy from a static renderable changes.
+	* Only the chunk the renderable is batched in is marked for rebuilding, a static renderable outside the batches
+	*	rebuilds the chunk it sits in.
+	*/
+	void Renderable::staticChanged()
+	{
+		if (mBatched)
+		{
+			sDirtyStaticChunks.insert(mStaticChunk);
+		}
+		if (mStatic || mBatched)
+		{
+			sStaticBatchesDirty = true;
+		}
+	}
+
+
+	/*
+	* void kaleidoscope::Renderable::notifyLoaded(kaleidoscope::StringID path, bool success)
+	*
+	* In: StringID : The path of the asset that finished loading.
+	* In: bool : false if the asset could not be loaded.
+	* Out: void :
+	*/
+	void Renderable::notifyLoaded(StringID path, bool success)
+	{
+		if (mLoadedCallback != NULL)
+		{
+			mLoadedCallback(RenderableHandle(this), path, success, mLoadedUserData);
+		}
+	}
+
+
+	/*
+	* void kaleidoscope::Renderable::MeshLoaded(void* userData, U32 ticket, irr::scene::IMesh* mesh)
+	*
+	* In: void* : The renderable that requested the mesh.
+	* In: U32 : The ticket of the request.
+	* In: IMesh* : The loaded mesh, NULL if it failed to load.
+	* Out: void :
+	*
+	* Swaps in the mesh unless the renderable was destroyed or asked for another mesh since, then applies the
+	*	serialized materials and the textures that were waiting for it. The textures were requested after the
+	*	materials were read, so they replace the materials textures on the same slots.
+	* A failed load leaves the renderable as setMesh() would have, with its previous mesh or with none.
+	*/
+	void Renderable::MeshLoaded(void* userData, U32 ticket, irr::scene::IMesh* mesh)
+	{
+		Renderable* r = static_cast<Renderable*>(userData);
+		if (!r->mInitialized || r->mPendingMesh != ticket)
+		{
+			mIrrController->releaseMesh(mesh);
+			return;
+		}
+
+		r->mPendingMesh = 0;
+
+		if (mesh != NULL)
+		{
+			r->resetLOD();
+			irr::scene::IMesh* previous = r->mirrMesh->getMesh();
+			r->mirrMesh->setMesh(mesh);
+			mIrrController->releaseMesh(previous);
+			r->mMeshPath = r->mPendingMeshPath;
+			r->releaseSlotTextures();
+			r->staticChanged();
+			r->rebuildAutoLODs();
+		}
+		else if (r->mirrMesh->getMesh() == mIrrController->getPlaceholderMesh())
+		{
+			// Irrlicht nodes can not drop their mesh, so the placeholder goes with a fresh node.
+			const bool visible = r->mirrMesh->isVisible();
+			mIrrController->removeSceneNode(r->mirrMesh);
+			r->mirrMesh = mIrrController->addMeshSceneNode();
+			r->mirrMesh->setVisible(visible);
+			r->staticChanged();
+		}
+
+		if (r->mPendingMaterials != NULL)
+		{
+			r->SerializeMaterialListIn(*r->mPendingMaterials);
+			delete r->mPendingMaterials;
+			r->mPendingMaterials = NULL;
+		}
+
+		boost::unordered_map<U32, irr::video::ITexture*> deferred;
+		deferred.swap(*r->mDeferredTextures);
+		for (boost::unordered_map<U32, irr::video::ITexture*>::iterator t = deferred.begin(); t != deferred.end(); ++t)
+		{
+			r->cancelSlotRequests(t->first);
+			r->setSlotTexture(t->first / 2, t->first % 2, t->second);
+			mIrrController->releaseTexture(t->second);
+		}
+
+		r->notifyLoaded(r->mPendingMeshPath, mesh != NULL);
+	}
+
+
+	/*
+	* void kaleidoscope::Renderable::TextureLoaded(void* userData, U32 ticket, irr::video::ITexture* texture)
+	*
+	* In: void* : The renderable that requested the texture.
+	* In: U32 : The ticket of the request.
+	* In: ITexture* : The loaded texture, NULL if it failed to load.
+	* Out: void :
+	*
+	* Textures that arrive while a mesh is loading are held until MeshLoaded(), the placeholders materials are dropped with it.
+	*/
+	void Renderable::TextureLoaded(void* userData, U32 ticket, irr::video::ITexture* texture)
+	{
+		Renderable* r = static_cast<Renderable*>(userData);
+		if (!r->mInitialized)
+		{
+			return;
+		}
+
+		boost::unordered_map<U32, std::pair<U32, StringID> >::iterator t = r->mPendingTextures->find(ticket);
+		if (t == r->mPendingTextures->end())
+		{
+			return;
+		}
+
+		const U32 matNumber = t->second.first / 2;
+		const U32 layer = t->second.first % 2;
+		const StringID path = t->second.second;
+		r->mPendingTextures->erase(t);
+
+		if (texture != NULL && r->mPendingMesh != 0)
+		{
+			const U32 slot = matNumber * 2 + layer;
+			mIrrController->acquireTexture(texture);
+			boost::unordered_map<U32, irr::video::ITexture*>::iterator deferred = r->mDeferredTextures->find(slot);
+			if (deferred != r->mDeferredTextures->end())
+			{
+				mIrrController->releaseTexture(deferred->second);
+			}
+			(*r->mDeferredTextures)[slot] = texture;
+		}
+		else if (texture != NULL && matNumber < r->numMaterials())
+		{
+			r->setSlotTexture(matNumber, layer, texture);
+		}
+
+		r->notifyLoaded(path, texture != NULL);
+	}
+
+
 	/*
 	* bool kaleidoscope::Renderable::StartUp(kaleidoscope::IrrlichtController* irrControl, const boost::property_tree::ptree& properties)
 	*
@@ -501,6 +1237,10 @@ namespace kaleidoscope
 	*			  false on failure.
 	*
 	* objects = U32 The maximum number of renderables that can be allocated.
+	* async loading = bool Whether meshes and textures load in the background, true by default.
+	* static chunk size = F32 The edge length of the space each static batch covers.
+	* lod hysteresis = F32 The fraction a level's screen size has to be passed by before the level changes back.
+	* auto lod size = F32 The screen size the first generated level is shown below.
 	*/
 	bool Renderable::StartUp(IrrlichtController* irrControl, const boost::property_tree::ptree& properties)
 	{
@@ -524,6 +1264,15 @@ namespace kaleidoscope
 				MAXNUMOBJECTS = DEFAULTMAX;
 			}
 
+			ASYNCLOADING = properties.get<bool>("async loading", true);
+			STATICCHUNKSIZE = properties.get<F32>("static chunk size", 64.0f);
+			LODHYSTERESIS = properties.get<F32>("lod hysteresis", 0.1f);
+			AUTOLODSIZE = properties.get<F32>("auto lod size", 0.25f);
+			sLODCameraValid = false;
+			sStaticBatchesDirty = false;
+			sDirtyStaticChunks.clear();
+			irrControl->setStaticChunkSize(STATICCHUNKSIZE);
+
 			sRenderablePool = new Renderable[MAXNUMOBJECTS];
 
 			mErrorManager = ErrorManager();
@@ -586,6 +1335,8 @@ namespace kaleidoscope
 		{
 			initialized = false;
 
+			mIrrController->clearStaticBatches();
+			sDirtyStaticChunks.clear();
 			delete[] sRenderablePool;
 
 			Semaphore::Semaphore_destroy(&createSem);
@@ -696,35 +1447,163 @@ namespace kaleidoscope
 	* Out: void :
 	*
 	* Synch the underlying Irrlicht State with the renderables state for rendering.
+	* Each renderable is then submitted to the IrrlichtController's render queue.
+	* Renderables in the static batches are skipped, the batches are rebuilt first if a static renderable changed.
 	* Internal use by RenderManager.
 	*/
 	void Renderable::UpdateAll()
 	{
+		if (sStaticBatchesDirty)
+		{
+			RebuildStaticBatches();
+		}
+
 		for (U32 i = 0; i < MAXNUMOBJECTS; ++i)
 		{
-			if (sRenderablePool[i].mInitialized)
+			if (sRenderablePool[i].mInitialized && !sRenderablePool[i].mBatched)
 			{
 				Renderable* r = &(sRenderablePool[i]);
 
-				math::vec3 wpos = r->transform().getWorldPosition();
-				irr::core::vector3df pos(wpos.x, wpos.y, wpos.z);
-				r->mirrMesh->setPosition(pos);
-				r->mirrMesh->updateAbsolutePosition();
+				r->syncTransform();
+				r->updateLOD();
 
-				math::quat wori = r->transform().getWorldOrientation();
-				math::vec3 weuler = kmath::eulerAnglesNoGimalProtect(wori);
-				irr::core::vector3df rot(weuler.x, weuler.y, weuler.z);
-				rot = rot * (180.0f / kmath::PI );
-				r->mirrMesh->setRotation(rot);
-				r->mirrMesh->updateAbsolutePosition();
+				mIrrController->submitRenderable(r->mirrMesh);
+
+			}
+		}
+	}
 
-				math::vec3 wscale = r->transform().getWorldScale();
-				irr::core::vector3df scl(wscale.x, wscale.y, wscale.z);
-				r->mirrMesh->setScale(scl);
-				r->mirrMesh->updateAbsolutePosition();
 
+	/*
+	* void kaleidoscope::Renderable::SetLODCamera(const kaleidoscope::math::vec3& position, F32 fieldOfView)
+	*
+	* In: vec3 : The world position of the camera levels of detail are picked for.
+	* In: F32 : The vertical field of view of the camera in radians.
+	* Out: void :
+	*
+	* Set by the RenderManager from the view camera before the renderables update.
+	*/
+	void Renderable::SetLODCamera(const math::vec3& position, F32 fieldOfView)
+	{
+		sLODCameraPosition = position;
+		sLODTanHalfFOV = std::tan(fieldOfView * 0.5f);
+		sLODCameraValid = (sLODTanHalfFOV > 0.0f);
+	}
+
+
+	/*
+	* void kaleidoscope::Renderable::syncTransform()
+	*
+	* In: void :
+	* Out: void :
+	*
+	* Copy the world transform of the renderables transform to its scene node.
+	*/
+	void Renderable::syncTransform()
+	{
+		math::vec3 wpos = transform().getWorldPosition();
+		irr::core::vector3df pos(wpos.x, wpos.y, wpos.z);
+		mirrMesh->setPosition(pos);
+		mirrMesh->updateAbsolutePosition();
+
+		math::quat wori = transform().getWorldOrientation();
+		math::vec3 weuler = kmath::eulerAnglesNoGimalProtect(wori);
+		irr::core::vector3df rot(weuler.x, weuler.y, weuler.z);
+		rot = rot * (180.0f / kmath::PI );
+		mirrMesh->setRotation(rot);
+		mirrMesh->updateAbsolutePosition();
+
+		math::vec3 wscale = transform().getWorldScale();
+		irr::core::vector3df scl(wscale.x, wscale.y, wscale.z);
+		mirrMesh->setScale(scl);
+		mirrMesh->updateAbsolutePosition();
+	}
+
+
+	/*
+	* void kaleidoscope::Renderable::RebuildStaticBatches()
+	*
+	* In: void :
+	* Out: void :
+	*
+	* Rebuilds the static batches of the chunks that changed. Every visible static renderable whose assets have
+	*	finished loading and that is not batched yet marks the chunk it sits in, the batches of the other chunks
+	*	are kept. Renderables the IrrlichtController can not batch keep drawing on their own.
+	*/
+	void Renderable::RebuildStaticBatches()
+	{
+		sStaticBatchesDirty = false;
+
+		for (U32 i = 0; i < MAXNUMOBJECTS; ++i)
+		{
+			Renderable* r = &(sRenderablePool[i]);
+			if (r->mInitialized && !r->mBatched && r->batchable())
+			{
+				r->syncTransform();
+				sDirtyStaticChunks.insert(mIrrController->staticChunkKey(r->mirrMesh->getAbsolutePosition()));
 			}
 		}
+
+		for (boost::unordered_set<U64>::iterator chunk = sDirtyStaticChunks.begin(); chunk != sDirtyStaticChunks.end(); ++chunk)
+		{
+			mIrrController->clearStaticBatch(*chunk);
+		}
+
+		// Chunks renderables moved into since they were batched, rebuilt on the next update.
+		std::vector<U64> moved;
+		for (U32 i = 0; i < MAXNUMOBJECTS; ++i)
+		{
+			Renderable* r = &(sRenderablePool[i]);
+			if (!r->mInitialized)
+			{
+				continue;
+			}
+
+			if (r->mBatched)
+			{
+				if (sDirtyStaticChunks.find(r->mStaticChunk) == sDirtyStaticChunks.end())
+				{
+					continue;
+				}
+				r->mBatched = false;
+				r->mirrMesh->setVisible(true);
+			}
+
+			if (r->batchable())
+			{
+				// Batches are built from the full detail mesh.
+				r->resetLOD();
+				r->syncTransform();
+				const U64 chunk = mIrrController->staticChunkKey(r->mirrMesh->getAbsolutePosition());
+				if (sDirtyStaticChunks.find(chunk) == sDirtyStaticChunks.end())
+				{
+					moved.push_back(chunk);
+				}
+				else if (mIrrController->addToStaticBatch(r->mirrMesh))
+				{
+					r->mBatched = true;
+					r->mStaticChunk = chunk;
+					r->mirrMesh->setVisible(false);
+				}
+			}
+		}
+		mIrrController->endStaticBatches();
+
+		sDirtyStaticChunks.clear();
+		sDirtyStaticChunks.insert(moved.begin(), moved.end());
+		sStaticBatchesDirty = !moved.empty();
+	}
+
+
+	/*
+	* bool kaleidoscope::Renderable::batchable() const
+	*
+	* In: void :
+	* Out: bool : true if the renderable can be merged into the static batches now.
+	*/
+	bool Renderable::batchable() const
+	{
+		return (mStatic && mirrMesh->isVisible() && !loading() && mirrMesh->getMesh() != mIrrController->getPlaceholderMesh());
 	}
 
 
@@ -831,7 +1710,7 @@ namespace kaleidoscope
 
 
 	const char * Renderable::LUA_TYPE_NAME = "kaleidoscope.renderable";
-	StringID Renderable::NAME = hashCRC32("renderable");
+	StringID Renderable::NAME = "renderable"_sid;
 	U32 Renderable::MAXNUMOBJECTS = 0;
 
 
@@ -840,6 +1719,18 @@ namespace kaleidoscope
 
 	U32 Renderable::DEFAULTMAX = 10;
 
+	bool Renderable::ASYNCLOADING = true;
+
+	F32 Renderable::LODHYSTERESIS = 0.1f;
+	F32 Renderable::AUTOLODSIZE = 0.25f;
+	bool Renderable::sLODCameraValid = false;
+	math::vec3 Renderable::sLODCameraPosition;
+	F32 Renderable::sLODTanHalfFOV = 1.0f;
+
+	F32 Renderable::STATICCHUNKSIZE = 64.0f;
+	bool Renderable::sStaticBatchesDirty = false;
+	boost::unordered_set<U64> Renderable::sDirtyStaticChunks;
+
 	U32 Renderable::numRenderables = 0;
 	Renderable* Renderable::sFirstFree = NULL;
 	Renderable* Renderable::sRenderablePool = NULL;
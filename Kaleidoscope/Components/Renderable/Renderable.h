@@ -7,16 +7,20 @@
 #include <Debug/ErrorManagement/ErrorManager.h>
 
 #include <Components/Transform/TransformHandle.h>
+#include <Components/Renderable/RenderableHandle.h>
 
 #include <Rendering/Irrlicht/IrrlichtController.h>
 #include <irrlicht.h>
 
 #include <boost/property_tree/ptree.hpp>
+#include <boost/unordered_map.hpp>
+#include <boost/unordered_set.hpp>
+
+#include <utility>
+#include <vector>
 
 namespace kaleidoscope
 {
-	class RenderableHandle;
-
 	class Renderable
 	{
 		friend class RenderableHandle;
@@ -26,6 +30,15 @@ namespace kaleidoscope
 		static U32 MAXNUMOBJECTS;
 		static const char * LUA_TYPE_NAME;
 
+		// A coarser mesh shown once the renderable covers less than mScreenSize of the screens height.
+		struct LODLevel
+		{
+			StringID mPath;				// 0 for a level generated from the mesh.
+			F32 mScreenSize;
+			irr::scene::IMesh* mMesh;	// NULL until loaded.
+			U32 mTicket;				// The ticket of the load in flight, 0 if none.
+		};
+
 
 		bool mInitialized;
 		union 
@@ -41,6 +54,23 @@ namespace kaleidoscope
 				StringID mAlbedoPath;
 
 				TransformHandle mTransform;
+
+				U32 mPendingMesh;		// The ticket of the mesh being loaded, 0 if none.
+				StringID mPendingMeshPath;
+				boost::property_tree::ptree* mPendingMaterials;	// Serialized materials waiting for the pending mesh.
+				boost::unordered_map<U32, std::pair<U32, StringID> >* mPendingTextures;	// Ticket to (material * 2 + layer, path).
+				boost::unordered_map<U32, irr::video::ITexture*>* mDeferredTextures;	// Textures loaded before the pending mesh, by slot.
+				RenderableHandle::LoadedCallback mLoadedCallback;
+				void* mLoadedUserData;
+				boost::unordered_map<U32, irr::video::ITexture*>* mSlotTextures;	// material * 2 + layer to the texture it holds.
+				bool mStatic;		// Merged into the static batches instead of drawing on its own.
+				bool mBatched;		// In the current static batches, the scene node is hidden and not updated.
+				U64 mStaticChunk;	// The chunk of the batch the renderable is in while batched.
+
+				std::vector<LODLevel>* mLODs;	// The levels after the mesh set with setMesh(), largest screen size first.
+				U32 mCurrentLOD;				// 0 for the mesh set with setMesh(), n for mLODs[n - 1].
+				irr::scene::IMesh* mBaseMesh;	// The mesh set with setMesh() while a coarser level is shown.
+				U32 mAutoLODs;					// The number of levels generated from the mesh.
 			};
 			Renderable* mNextInFreeList;
 		};
@@ -61,6 +91,16 @@ namespace kaleidoscope
 
 		void setMesh(StringID mesh);
 		void removeMesh();
+		bool loading() const;
+		void setLoadedCallback(RenderableHandle::LoadedCallback callback, void* userData);
+
+		void setStatic(bool value);
+		bool isStatic() const;
+
+		void addLOD(StringID mesh, F32 screenSize);
+		void setAutoLOD(U32 levels);
+		void clearLODs();
+		U32 getLOD() const;
 
 		bool visible() const;
 		void makeVisible();
@@ -85,6 +125,25 @@ namespace kaleidoscope
 
 		void printState() const;
 
+		void setMaterialTexture(U32 matNumber, U32 layer, StringID path);
+		void setSlotTexture(U32 matNumber, U32 layer, irr::video::ITexture* texture);
+		void releaseSlotTextures();
+		void cancelSlotRequests(U32 slot);
+		void releaseDeferredTextures();
+		void notifyLoaded(StringID path, bool success);
+		static void MeshLoaded(void* userData, U32 ticket, irr::scene::IMesh* mesh);
+		static void TextureLoaded(void* userData, U32 ticket, irr::video::ITexture* texture);
+		void syncTransform();
+		void updateLOD();
+		void showLOD(U32 level);
+		void resetLOD();
+		void rebuildAutoLODs();
+		static void LODLoaded(void* userData, U32 ticket, irr::scene::IMesh* mesh);
+		static bool LODOrder(const LODLevel& lhs, const LODLevel& rhs);
+		void staticChanged();
+		bool batchable() const;
+		static void RebuildStaticBatches();
+
 
 
 
@@ -98,6 +157,7 @@ namespace kaleidoscope
 		static void Destroy(const RenderableHandle& rh);
 
 		static void UpdateAll();
+		static void SetLODCamera(const math::vec3& position, F32 fieldOfView);
 
 		static bool hasPendingError();
 		static void clearError();
@@ -110,6 +170,18 @@ namespace kaleidoscope
 
 		static U32 DEFAULTMAX;
 
+		static bool ASYNCLOADING;		// Meshes and textures load in the background, set by "async loading".
+
+		static F32 LODHYSTERESIS;		// The fraction a screen size has to be passed by before the level changes.
+		static F32 AUTOLODSIZE;			// The screen size of the first generated level, each next level is half as big.
+		static bool sLODCameraValid;
+		static math::vec3 sLODCameraPosition;
+		static F32 sLODTanHalfFOV;
+
+		static F32 STATICCHUNKSIZE;		// The edge length of the space each static batch covers, set by "static chunk size".
+		static bool sStaticBatchesDirty;
+		static boost::unordered_set<U64> sDirtyStaticChunks;	// Chunks to rebuild, besides those unbatched statics sit in.
+
 		static U32 numRenderables;
 		static StringID GenerateName();
 
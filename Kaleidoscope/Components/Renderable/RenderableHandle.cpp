@@ -43,6 +43,16 @@ namespace kaleidoscope
 
 	void RenderableHandle::setMesh(StringID mesh) { getObject()->setMesh(mesh); }
 	void RenderableHandle::removeMesh() { getObject()->removeMesh(); }
+	bool RenderableHandle::loading() const { return getObject()->loading(); }
+	void RenderableHandle::setLoadedCallback(LoadedCallback callback, void* userData) { getObject()->setLoadedCallback(callback, userData); }
+
+	void RenderableHandle::setStatic(bool value) { getObject()->setStatic(value); }
+	bool RenderableHandle::isStatic() const { return getObject()->isStatic(); }
+
+	void RenderableHandle::addLOD(StringID mesh, F32 screenSize) { getObject()->addLOD(mesh, screenSize); }
+	void RenderableHandle::setAutoLOD(U32 levels) { getObject()->setAutoLOD(levels); }
+	void RenderableHandle::clearLODs() { getObject()->clearLODs(); }
+	U32 RenderableHandle::getLOD() const { return getObject()->getLOD(); }
 
 	bool RenderableHandle::isEnabled() const { return getObject()->visible(); }
 	void RenderableHandle::enable() { getObject()->makeVisible(); }
@@ -96,6 +106,7 @@ namespace kaleidoscope
 	void RenderableHandle::Destroy(const RenderableHandle& rh) { Renderable::Destroy(rh); }
 
 	void RenderableHandle::UpdateAll() { Renderable::UpdateAll(); }
+	void RenderableHandle::SetLODCamera(const math::vec3& position, F32 fieldOfView) { Renderable::SetLODCamera(position, fieldOfView); }
 
 	bool RenderableHandle::hasPendingError() { return Renderable::hasPendingError(); }
 	void RenderableHandle::clearError() { Renderable::clearError(); }
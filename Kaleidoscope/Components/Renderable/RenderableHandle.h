@@ -29,6 +29,9 @@ namespace kaleidoscope
 
 		// Copy Control.
 	public:
+		// Called on the render thread when an asset requested by setMesh() or a material setter finishes loading.
+		typedef void (*LoadedCallback)(const RenderableHandle& r, StringID path, bool success, void* userData);
+
 		RenderableHandle(const RenderableHandle& r) : mName(r.mName), mPoolIndex(r.mPoolIndex) {};
 		inline RenderableHandle& operator=(const RenderableHandle& rhs);
 
@@ -58,6 +61,16 @@ namespace kaleidoscope
 
 		void setMesh(StringID mesh);
 		void removeMesh();
+		bool loading() const;
+		void setLoadedCallback(LoadedCallback callback, void* userData);
+
+		void setStatic(bool value);
+		bool isStatic() const;
+
+		void addLOD(StringID mesh, F32 screenSize);
+		void setAutoLOD(U32 levels);
+		void clearLODs();
+		U32 getLOD() const;
 
 		bool isEnabled() const;
 		void enable();
@@ -102,6 +115,7 @@ namespace kaleidoscope
 		static void Destroy(const RenderableHandle& rh);
 
 		static void UpdateAll();
+		static void SetLODCamera(const math::vec3& position, F32 fieldOfView);
 
 		static bool hasPendingError();
 		static void clearError();
@@ -13,7 +13,6 @@
 #include <string>
 #include <boost/foreach.hpp>
 #include <boost/optional.hpp>
-#include <Utility/Parsing/Lowerize.h>
 #include <Utility/Parsing/parseMathsFromStrings.h>
 #include <Utility/Parsing/generateStringFromMaths.h>
 
@@ -1009,7 +1008,7 @@ namespace kaleidoscope
 
 
 	U32 Transform::MAXNUMOBJECTS;
-	StringID Transform::NAME = hashCRC32("transform");
+	StringID Transform::NAME = "transform"_sid;
 
 	
 	bool Transform::initialized = false;
@@ -5,6 +5,8 @@
 
 #include <Math/Math.h>
 
+#include <cstring>
+
 namespace kaleidoscope
 {
 	class VariantType
@@ -34,9 +36,18 @@ namespace kaleidoscope
 
 			// Possibility of handles being added.
 
+			NONE_ARG, // A skipped index.
+
 			COUNT_ARG
 		};
 
+		// The number of payload bytes an argument of the type takes in an Event.
+		static U32 Size(ArgType t)
+		{
+			static const U8 sizes[COUNT_ARG] = { 1, 2, 4, 8, 1, 2, 4, 8, 4, 8, 1, sizeof(StringID), 12, 16, 16, 0 };
+			return (t < COUNT_ARG ? sizes[t] : 0);
+		};
+
 		ArgType type;
 
 		union
@@ -64,310 +75,340 @@ namespace kaleidoscope
 		};
 	};
 
+	// Events are stored packed, each argument is a one byte ArgType tag followed by its value, so an event only
+	//	takes the bytes its arguments need. Small events live in the inline buffer, larger ones spill to the heap.
+	// Arguments are read and written by index, writing past the end pads the skipped indices with NONE_ARG.
 	class Event
 	{
+		friend class EventView;
+
 	private:
-		static const U32 MAXARGS = 8;
-		StringID mType;
-		VariantType mArgs[MAXARGS];
+		static const U32 MAXARGS = 255;
+		static const U32 INLINEBYTES = 48;
 
-	public:
-		Event(){};
-		~Event(){};
+		StringID mType;
+		U8 mNumArgs;
+		U16 mSize;		// Bytes of the buffer in use.
+		U16 mCapacity;	// Bytes available, INLINEBYTES until the event spills to the heap.
+		U8* mHeap;		// NULL while the event fits in mInline.
+		U8 mInline[INLINEBYTES];
 
-		void setEventType(StringID eventName){ mType = eventName; }; // Set the event name. This name corresponds to the function to call on the GOs Scripts.
-		StringID getEventType() const { return mType; };
-		U32 maxSize() const { return MAXARGS; }; // Return the maximum number of arguments an event can possibly have.
+		U8* data() { return (mHeap != NULL ? mHeap : mInline); };
+		const U8* data() const { return (mHeap != NULL ? mHeap : mInline); };
 
 
 		/*
-		* void kaleidoscope::Event::addX(U32 index, X x)
+		* U32 kaleidoscope::Event::offsetOf(U32 index) const
 		*
-		* In: U32 index : What argument to change.
-		* In: X x : The new value to set the argument to.
-		* Out: void :
-		* 
-		* Applies to all functions of the form above.
+		* In: U32 index : The argument to find, must be less than mNumArgs.
+		* Out: U32 : The offset of the arguments tag byte in the buffer.
 		*/
-		void addF32(U32 index, F32 f)
+		U32 offsetOf(U32 index) const
 		{
-			if (index >= 0 && index < MAXARGS)
+			const U8* d = data();
+			U32 offset = 0;
+			for (U32 i = 0; i < index; ++i)
 			{
-				mArgs[index].type = VariantType::F32_ARG;
-				mArgs[index].asF32 = f;
+				offset += 1 + VariantType::Size(static_cast<VariantType::ArgType>(d[offset]));
 			}
+			return offset;
 		};
 
 
 		/*
-		* X kaleidoscope::Event::getX(U32 index)
-		*
-		* In: U32 index : What argument to get.
-		* Out: X : The desired argument as X
-		*
-		* If the argument at index is not of type X then some default value is returned.
+		* void kaleidoscope::Event::reserve(U32 bytes)
 		*
-		* Applies to all functions of the form above.
+		* In: U32 bytes : The buffer size needed.
+		* Out: void :
 		*/
-		F32 getF32(U32 index) const
+		void reserve(U32 bytes)
 		{
-			if (index >= 0 && index < MAXARGS && mArgs[index].type == VariantType::F32_ARG)
-			{
-				return mArgs[index].asF32;
-			}
-			else
+			if (bytes <= mCapacity)
 			{
-				return 0.0f;
+				return;
 			}
-		};
 
-		void addF64(U32 index, F64 f)
-		{
-			if (index >= 0 && index < MAXARGS)
+			U32 capacity = mCapacity * 2;
+			if (capacity < bytes)
 			{
-				mArgs[index].type = VariantType::F64_ARG;
-				mArgs[index].asF64 = f;
+				capacity = bytes;
 			}
+
+			U8* heap = new U8[capacity];
+			std::memcpy(heap, data(), mSize);
+			delete[] mHeap;
+			mHeap = heap;
+			mCapacity = static_cast<U16>(capacity);
 		};
 
-		F64 getF64(U32 index) const
+
+		/*
+		* void kaleidoscope::Event::setArg(U32 index, VariantType::ArgType type, const void* value)
+		*
+		* In: U32 index : What argument to change.
+		* In: ArgType type : The type of the new value.
+		* In: const void* value : VariantType::Size(type) bytes to copy into the argument.
+		* Out: void :
+		*/
+		void setArg(U32 index, VariantType::ArgType type, const void* value)
 		{
-			if (index >= 0 && index < MAXARGS && mArgs[index].type == VariantType::F64_ARG)
+			if (index >= MAXARGS)
 			{
-				return mArgs[index].asF64;
+				return;
 			}
-			else
+
+			const U32 size = VariantType::Size(type);
+
+			// Pad skipped indices so every argument keeps its index.
+			if (index >= mNumArgs)
 			{
-				return 0.0;
+				reserve(mSize + (index - mNumArgs) + 1 + size);
+				U8* d = data();
+				while (mNumArgs < index)
+				{
+					d[mSize++] = VariantType::NONE_ARG;
+					++mNumArgs;
+				}
+				d[mSize] = static_cast<U8>(type);
+				std::memcpy(d + mSize + 1, value, size);
+				mSize = static_cast<U16>(mSize + 1 + size);
+				++mNumArgs;
+				return;
 			}
-		};
 
-		void addU8(U32 index, U8 f)
-		{
-			if (index >= 0 && index < MAXARGS)
+			// Overwrite, moving the arguments after it when the size changes.
+			U32 offset = offsetOf(index);
+			const U32 oldSize = VariantType::Size(static_cast<VariantType::ArgType>(data()[offset]));
+			if (oldSize != size)
 			{
-				mArgs[index].type = VariantType::U8_ARG;
-				mArgs[index].asU8 = f;
+				reserve(mSize - oldSize + size);
+				U8* d = data();
+				const U32 tail = offset + 1 + oldSize;
+				std::memmove(d + offset + 1 + size, d + tail, mSize - tail);
+				mSize = static_cast<U16>(mSize - oldSize + size);
 			}
+			U8* d = data();
+			d[offset] = static_cast<U8>(type);
+			std::memcpy(d + offset + 1, value, size);
 		};
 
-		U8 getU8(U32 index) const
+
+		/*
+		* bool kaleidoscope::Event::getArg(U32 index, VariantType::ArgType type, void* value) const
+		*
+		* In: U32 index : What argument to get.
+		* In: ArgType type : The type the argument must have.
+		* Out: void* value : Filled with VariantType::Size(type) bytes if the argument is of type.
+		* Out: bool : true if the argument exists and is of type.
+		*/
+		bool getArg(U32 index, VariantType::ArgType type, void* value) const
 		{
-			if (index >= 0 && index < MAXARGS && mArgs[index].type == VariantType::U8_ARG)
+			if (index >= mNumArgs)
 			{
-				return mArgs[index].asU8;
+				return false;
 			}
-			else
+
+			const U8* arg = data() + offsetOf(index);
+			if (*arg != type)
 			{
-				return 0;
+				return false;
 			}
+
+			std::memcpy(value, arg + 1, VariantType::Size(type));
+			return true;
 		};
 
-		void addU16(U32 index, U16 f)
+	public:
+		Event() : mType(0), mNumArgs(0), mSize(0), mCapacity(INLINEBYTES), mHeap(NULL) {};
+		~Event(){ delete[] mHeap; };
+
+		Event(const Event& e) : mType(e.mType), mNumArgs(e.mNumArgs), mSize(0), mCapacity(INLINEBYTES), mHeap(NULL)
 		{
-			if (index >= 0 && index < MAXARGS)
-			{
-				mArgs[index].type = VariantType::U16_ARG;
-				mArgs[index].asU16 = f;
-			}
+			reserve(e.mSize);
+			std::memcpy(data(), e.data(), e.mSize);
+			mSize = e.mSize;
 		};
 
-		U16 getU16(U32 index) const
+		Event& operator=(const Event& e)
 		{
-			if (index >= 0 && index < MAXARGS && mArgs[index].type == VariantType::U16_ARG)
-			{
-				return mArgs[index].asU16;
-			}
-			else
+			if (this != &e)
 			{
-				return 0;
+				mType = e.mType;
+				mNumArgs = e.mNumArgs;
+				mSize = 0;
+				reserve(e.mSize);
+				std::memcpy(data(), e.data(), e.mSize);
+				mSize = e.mSize;
 			}
+			return *this;
 		};
 
-		void addU32(U32 index, U32 f)
+		void setEventType(StringID eventName){ mType = eventName; }; // Set the event name. This name corresponds to the function to call on the GOs Scripts.
+		StringID getEventType() const { return mType; };
+		U32 maxSize() const { return MAXARGS; }; // Return the maximum number of arguments an event can possibly have.
+		U32 numArgs() const { return mNumArgs; }; // Return the number of arguments set, including skipped indices.
+		U32 payloadSize() const { return mSize; }; // Return the number of bytes the arguments take.
+
+		VariantType::ArgType getArgType(U32 index) const
 		{
-			if (index >= 0 && index < MAXARGS)
+			if (index >= mNumArgs)
 			{
-				mArgs[index].type = VariantType::U32_ARG;
-				mArgs[index].asU32 = f;
+				return VariantType::NONE_ARG;
 			}
+			return static_cast<VariantType::ArgType>(data()[offsetOf(index)]);
 		};
 
-		U32 getU32(U32 index) const
+		void clear()
 		{
-			if (index >= 0 && index < MAXARGS && mArgs[index].type == VariantType::U32_ARG)
-			{
-				return mArgs[index].asU32;
-			}
-			else
-			{
-				return 0;
-			}
+			mNumArgs = 0;
+			mSize = 0;
 		};
 
-		void addU64(U32 index, U64 f)
+
+		/*
+		* void kaleidoscope::Event::addX(U32 index, X x)
+		*
+		* In: U32 index : What argument to change.
+		* In: X x : The new value to set the argument to.
+		* Out: void :
+		* 
+		* Applies to all functions of the form above.
+		*/
+		void addF32(U32 index, F32 f) { setArg(index, VariantType::F32_ARG, &f); };
+
+
+		/*
+		* X kaleidoscope::Event::getX(U32 index)
+		*
+		* In: U32 index : What argument to get.
+		* Out: X : The desired argument as X
+		*
+		* If the argument at index is not of type X then some default value is returned.
+		*
+		* Applies to all functions of the form above.
+		*/
+		F32 getF32(U32 index) const
 		{
-			if (index >= 0 && index < MAXARGS)
-			{
-				mArgs[index].type = VariantType::U64_ARG;
-				mArgs[index].asU64 = f;
-			}
+			F32 f = 0.0f;
+			getArg(index, VariantType::F32_ARG, &f);
+			return f;
 		};
 
-		U64 getU64(U32 index) const
+		void addF64(U32 index, F64 f) { setArg(index, VariantType::F64_ARG, &f); };
+
+		F64 getF64(U32 index) const
 		{
-			if (index >= 0 && index < MAXARGS && mArgs[index].type == VariantType::U64_ARG)
-			{
-				return mArgs[index].asU64;
-			}
-			else
-			{
-				return 0;
-			}
+			F64 f = 0.0;
+			getArg(index, VariantType::F64_ARG, &f);
+			return f;
 		};
 
-		void addI8(U32 index, I8 f)
+		void addU8(U32 index, U8 f) { setArg(index, VariantType::U8_ARG, &f); };
+
+		U8 getU8(U32 index) const
 		{
-			if (index >= 0 && index < MAXARGS)
-			{
-				mArgs[index].type = VariantType::I8_ARG;
-				mArgs[index].asI8 = f;
-			}
+			U8 f = 0;
+			getArg(index, VariantType::U8_ARG, &f);
+			return f;
 		};
 
-		I8 getI8(U32 index) const
+		void addU16(U32 index, U16 f) { setArg(index, VariantType::U16_ARG, &f); };
+
+		U16 getU16(U32 index) const
 		{
-			if (index >= 0 && index < MAXARGS && mArgs[index].type == VariantType::I8_ARG)
-			{
-				return mArgs[index].asI8;
-			}
-			else
-			{
-				return 0;
-			}
+			U16 f = 0;
+			getArg(index, VariantType::U16_ARG, &f);
+			return f;
 		};
 
-		void addI16(U32 index, I16 f)
+		void addU32(U32 index, U32 f) { setArg(index, VariantType::U32_ARG, &f); };
+
+		U32 getU32(U32 index) const
 		{
-			if (index >= 0 && index < MAXARGS)
-			{
-				mArgs[index].type = VariantType::I16_ARG;
-				mArgs[index].asI16 = f;
-			}
+			U32 f = 0;
+			getArg(index, VariantType::U32_ARG, &f);
+			return f;
 		};
 
-		I16 getI16(U32 index) const
+		void addU64(U32 index, U64 f) { setArg(index, VariantType::U64_ARG, &f); };
+
+		U64 getU64(U32 index) const
 		{
-			if (index >= 0 && index < MAXARGS && mArgs[index].type == VariantType::I16_ARG)
-			{
-				return mArgs[index].asI16;
-			}
-			else
-			{
-				return 0;
-			}
+			U64 f = 0;
+			getArg(index, VariantType::U64_ARG, &f);
+			return f;
 		};
 
-		void addI32(U32 index, I32 f)
+		void addI8(U32 index, I8 f) { setArg(index, VariantType::I8_ARG, &f); };
+
+		I8 getI8(U32 index) const
 		{
-			if (index >= 0 && index < MAXARGS)
-			{
-				mArgs[index].type = VariantType::I32_ARG;
-				mArgs[index].asI32 = f;
-			}
+			I8 f = 0;
+			getArg(index, VariantType::I8_ARG, &f);
+			return f;
 		};
 
-		I32 getI32(U32 index) const
+		void addI16(U32 index, I16 f) { setArg(index, VariantType::I16_ARG, &f); };
+
+		I16 getI16(U32 index) const
 		{
-			if (index >= 0 && index < MAXARGS && mArgs[index].type == VariantType::I32_ARG)
-			{
-				return mArgs[index].asI32;
-			}
-			else
-			{
-				return 0;
-			}
+			I16 f = 0;
+			getArg(index, VariantType::I16_ARG, &f);
+			return f;
 		};
 
-		void addI64(U32 index, I64 f)
+		void addI32(U32 index, I32 f) { setArg(index, VariantType::I32_ARG, &f); };
+
+		I32 getI32(U32 index) const
 		{
-			if (index >= 0 && index < MAXARGS)
-			{
-				mArgs[index].type = VariantType::I64_ARG;
-				mArgs[index].asI64 = f;
-			}
+			I32 f = 0;
+			getArg(index, VariantType::I32_ARG, &f);
+			return f;
 		};
 
+		void addI64(U32 index, I64 f) { setArg(index, VariantType::I64_ARG, &f); };
+
 		I64 getI64(U32 index) const
 		{
-			if (index >= 0 && index < MAXARGS && mArgs[index].type == VariantType::I64_ARG)
-			{
-				return mArgs[index].asI64;
-			}
-			else
-			{
-				return 0;
-			}
+			I64 f = 0;
+			getArg(index, VariantType::I64_ARG, &f);
+			return f;
 		};
 
 		void addBool(U32 index, bool f)
 		{
-			if (index >= 0 && index < MAXARGS)
-			{
-				mArgs[index].type = VariantType::BOOL_ARG;
-				mArgs[index].asBool = f;
-			}
+			U8 b = (f ? 1 : 0);
+			setArg(index, VariantType::BOOL_ARG, &b);
 		};
 
 		bool getBool(U32 index) const
 		{
-			if (index >= 0 && index < MAXARGS && mArgs[index].type == VariantType::BOOL_ARG)
-			{
-				return mArgs[index].asBool;
-			}
-			else
-			{
-				return false;
-			}
+			U8 b = 0;
+			getArg(index, VariantType::BOOL_ARG, &b);
+			return b != 0;
 		};
 
-		void addStringID(U32 index, StringID f)
-		{
-			if (index >= 0 && index < MAXARGS)
-			{
-				mArgs[index].type = VariantType::STRINGID_ARG;
-				mArgs[index].asStringID = f;
-			}
-		};
+		void addStringID(U32 index, StringID f) { setArg(index, VariantType::STRINGID_ARG, &f); };
 
 		StringID getStringID(U32 index) const
 		{
-			if (index >= 0 && index < MAXARGS && mArgs[index].type == VariantType::STRINGID_ARG)
-			{
-				return mArgs[index].asStringID;
-			}
-			else
-			{
-				return 0;
-			}
+			StringID f = 0;
+			getArg(index, VariantType::STRINGID_ARG, &f);
+			return f;
 		};
 
 		void addVec3(U32 index, kaleidoscope::math::vec3 v)
 		{
-			if (index >= 0 && index < MAXARGS)
-			{
-				mArgs[index].type = VariantType::VEC3_ARG;
-				mArgs[index].asVec3[0] = v.x;
-				mArgs[index].asVec3[1] = v.y;
-				mArgs[index].asVec3[2] = v.z;
-			}
+			F32 f[3] = { v.x, v.y, v.z };
+			setArg(index, VariantType::VEC3_ARG, f);
 		};
 
 		kaleidoscope::math::vec3 getVec3(U32 index) const
 		{
-			if (index >= 0 && index < MAXARGS && mArgs[index].type == VariantType::VEC3_ARG)
+			F32 f[3];
+			if (getArg(index, VariantType::VEC3_ARG, f))
 			{
-				return kaleidoscope::math::vec3(mArgs[index].asVec3[0], mArgs[index].asVec3[1], mArgs[index].asVec3[2]);
+				return kaleidoscope::math::vec3(f[0], f[1], f[2]);
 			}
 			else
 			{
@@ -377,21 +418,16 @@ namespace kaleidoscope
 
 		void addVec4(U32 index, kaleidoscope::math::vec4 v)
 		{
-			if (index >= 0 && index < MAXARGS)
-			{
-				mArgs[index].type = VariantType::VEC4_ARG;
-				mArgs[index].asVec4[0] = v.x;
-				mArgs[index].asVec4[1] = v.y;
-				mArgs[index].asVec4[2] = v.z;
-				mArgs[index].asVec4[3] = v.w;
-			}
+			F32 f[4] = { v.x, v.y, v.z, v.w };
+			setArg(index, VariantType::VEC4_ARG, f);
 		};
 
 		kaleidoscope::math::vec4 getVec4(U32 index) const
 		{
-			if (index >= 0 && index < MAXARGS && mArgs[index].type == VariantType::VEC4_ARG)
+			F32 f[4];
+			if (getArg(index, VariantType::VEC4_ARG, f))
 			{
-				return kaleidoscope::math::vec4(mArgs[index].asVec4[0], mArgs[index].asVec4[1], mArgs[index].asVec4[2], mArgs[index].asVec4[3]);
+				return kaleidoscope::math::vec4(f[0], f[1], f[2], f[3]);
 			}
 			else
 			{
@@ -401,21 +437,16 @@ namespace kaleidoscope
 
 		void addQuat(U32 index, kaleidoscope::math::quat v)
 		{
-			if (index >= 0 && index < MAXARGS)
-			{
-				mArgs[index].type = VariantType::QUAT_ARG;
-				mArgs[index].asQuat[0] = v.w;
-				mArgs[index].asQuat[1] = v.x;
-				mArgs[index].asQuat[2] = v.y;
-				mArgs[index].asQuat[3] = v.z;
-			}
+			F32 f[4] = { v.w, v.x, v.y, v.z };
+			setArg(index, VariantType::QUAT_ARG, f);
 		};
 
 		kaleidoscope::math::quat getQuat(U32 index) const
 		{
-			if (index >= 0 && index < MAXARGS && mArgs[index].type == VariantType::QUAT_ARG)
+			F32 f[4];
+			if (getArg(index, VariantType::QUAT_ARG, f))
 			{
-				return kaleidoscope::math::quat(mArgs[index].asVec4[0], mArgs[index].asVec4[1], mArgs[index].asVec4[2], mArgs[index].asVec4[3]);
+				return kaleidoscope::math::quat(f[0], f[1], f[2], f[3]);
 			}
 			else
 			{
@@ -425,4 +456,38 @@ namespace kaleidoscope
 
 
 	};
-}
\ No newline at end of file
+
+
+	// Walks the arguments of an Event in order without copying or re-scanning for each index.
+	// The view is invalidated by any change to the event.
+	//
+	//	for (EventView v(e); v.valid(); v.next())
+	//	{
+	//		if (v.type() == VariantType::F32_ARG) { F32 f; v.read(f); }
+	//	}
+	class EventView
+	{
+	public:
+		explicit EventView(const Event& e) : mCursor(e.data()), mEnd(e.data() + e.mSize), mIndex(0) {};
+
+		bool valid() const { return mCursor < mEnd; };
+		void next()
+		{
+			mCursor += 1 + VariantType::Size(type());
+			++mIndex;
+		};
+
+		U32 index() const { return mIndex; };
+		VariantType::ArgType type() const { return static_cast<VariantType::ArgType>(*mCursor); };
+		const U8* value() const { return mCursor + 1; }; // Unaligned, read through read() or memcpy.
+
+		// The caller checks type(), T must be VariantType::Size(type()) bytes.
+		template <class T>
+		void read(T& out) const { std::memcpy(&out, mCursor + 1, sizeof(T)); };
+
+	private:
+		const U8* mCursor;
+		const U8* mEnd;
+		U32 mIndex;
+	};
+}
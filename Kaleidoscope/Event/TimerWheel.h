@@ -0,0 +1,149 @@
+#pragma once
+
+#include <Utility/Typedefs.h>
+
+#include <vector>
+
+namespace kaleidoscope
+{
+	// A hierarchical timer wheel holding items until the tick they are due on.
+	// Level 0 has one slot per tick, each higher level has one slot per full turn of the level below it.
+	// Scheduling is O(1), and advancing one tick touches one slot plus, once a turn, the slot of the level above,
+	//	whose items are moved down a level. Items further out than the top level are kept aside until it wraps.
+	template <class T>
+	class TimerWheel
+	{
+	public:
+		TimerWheel() : mNow(0), mSize(0) {};
+
+		U64 now() const { return mNow; };
+		U64 size() const { return mSize; };
+
+
+		/*
+		* void kaleidoscope::TimerWheel<T>::schedule(U64 tick, const T& item)
+		*
+		* In: U64 tick : The tick the item is due on, ticks at or before now() are due on the next tick.
+		* In: T item : The item to hold.
+		* Out: void :
+		*/
+		void schedule(U64 tick, const T& item)
+		{
+			Entry e;
+			e.mTick = (tick > mNow ? tick : mNow + 1);
+			e.mItem = item;
+			insert(e);
+			++mSize;
+		};
+
+
+		/*
+		* void kaleidoscope::TimerWheel<T>::advance(U64 tick, F& fire)
+		*
+		* In: U64 tick : The tick to advance to.
+		* In: F fire : Called as fire(item) for every item that comes due, in tick order.
+		* Out: void :
+		*/
+		template <class F>
+		void advance(U64 tick, F& fire)
+		{
+			while (mNow < tick)
+			{
+				// Nothing is pending so skip straight to the tick, the slots are all empty.
+				if (mSize == 0)
+				{
+					mNow = tick;
+					return;
+				}
+
+				++mNow;
+				cascade();
+
+				std::vector<Entry>& slot = mSlots[0][mNow & SLOTMASK];
+				if (!slot.empty())
+				{
+					std::vector<Entry> due;
+					due.swap(slot);
+					mSize -= due.size();
+					for (typename std::vector<Entry>::iterator e = due.begin(); e != due.end(); ++e)
+					{
+						fire((*e).mItem);
+					}
+				}
+			}
+		};
+
+
+		void clear()
+		{
+			for (U32 level = 0; level < NUMLEVELS; ++level)
+			{
+				for (U32 slot = 0; slot < NUMSLOTS; ++slot)
+				{
+					mSlots[level][slot].clear();
+				}
+			}
+			mOverflow.clear();
+			mSize = 0;
+		};
+
+	private:
+		static const U32 NUMLEVELS = 4;
+		static const U32 SLOTBITS = 8;
+		static const U32 NUMSLOTS = 1 << SLOTBITS;
+		static const U64 SLOTMASK = NUMSLOTS - 1;
+
+		struct Entry
+		{
+			U64 mTick;
+			T mItem;
+		};
+
+		void insert(const Entry& e)
+		{
+			const U64 delta = e.mTick - mNow;
+			for (U32 level = 0; level < NUMLEVELS; ++level)
+			{
+				if (delta < (static_cast<U64>(1) << (SLOTBITS * (level + 1))))
+				{
+					mSlots[level][(e.mTick >> (SLOTBITS * level)) & SLOTMASK].push_back(e);
+					return;
+				}
+			}
+			mOverflow.push_back(e);
+		};
+
+		// Moves the items of every level whose slot came up this tick down towards level 0.
+		void cascade()
+		{
+			for (U32 level = 1; level <= NUMLEVELS; ++level)
+			{
+				const U64 turn = (static_cast<U64>(1) << (SLOTBITS * level)) - 1;
+				if ((mNow & turn) != 0)
+				{
+					return;
+				}
+
+				std::vector<Entry> entries;
+				if (level < NUMLEVELS)
+				{
+					entries.swap(mSlots[level][(mNow >> (SLOTBITS * level)) & SLOTMASK]);
+				}
+				else
+				{
+					entries.swap(mOverflow);
+				}
+
+				for (typename std::vector<Entry>::iterator e = entries.begin(); e != entries.end(); ++e)
+				{
+					insert(*e);
+				}
+			}
+		};
+
+		std::vector<Entry> mSlots[NUMLEVELS][NUMSLOTS];
+		std::vector<Entry> mOverflow;
+		U64 mNow;
+		U64 mSize;
+	};
+}
@@ -10,11 +10,12 @@
 #include <boost/property_tree/xml_parser.hpp>
 #include <boost/foreach.hpp>
 #include <boost/optional.hpp>
-#include <Utility/Parsing/Lowerize.h>
 #include <string>
 
 #include <algorithm>
 
+#include <SDL_timer.h>
+
 #include <Components/Transform/Transform.h>
 #include <Components/LuaScript/LuaScript.h>
 #include <Components/Camera/Camera.h>
@@ -31,6 +32,8 @@ namespace kaleidoscope
 
 	static Semaphore bucketAccessSem;
 	static Semaphore enableSem;
+	static Semaphore eventQueueSem;
+	static Semaphore subscriberSem;
 
 
 	GameObject::GameObject()
@@ -406,6 +409,8 @@ namespace kaleidoscope
 		else if (componentType == RenderableHandle::NAME && !renderable().valid())
 		{
 			mRenderable = RenderableHandle::Create(transform());
+			mRenderable.setLoadedCallback(RenderableLoaded, this);
+			mRenderable.setStatic(mStatic);
 		}
 		else if (componentType == LightHandle::NAME && !light().valid())
 		{
@@ -691,9 +696,9 @@ namespace kaleidoscope
 	}
 
 
-	static const StringID tagID = hashCRC32("tag");
-	static const StringID parentID = hashCRC32("parent");
-	static const StringID childID = hashCRC32("child");
+	static const StringID tagID = "tag"_sid;
+	static const StringID parentID = "parent"_sid;
+	static const StringID childID = "child"_sid;
 
 
    /*
@@ -727,7 +732,7 @@ namespace kaleidoscope
 		StringID fieldID;
 		BOOST_FOREACH(ptree::value_type const& goInfoField, goInfo)
 		{
-			fieldID = lowerize(goInfoField.first.c_str());
+			fieldID = hashCRC32Lower(goInfoField.first.c_str());
 
 			if (fieldID == tagID)
 			{
@@ -882,11 +887,22 @@ namespace kaleidoscope
 
 		sGameObjectPool[MAXNUMOBJECTS - 1].mNextInFreeList = NULL;
 
-		if ((Mutex::Mutex_init(&creationMutex) != 0) || (Mutex::Mutex_init(&tagMutex) != 0) || (Mutex::Mutex_init(&childBucketMutex) != 0) || (Semaphore::Semaphore_init(&bucketAccessSem, 1) != 0) || (Semaphore::Semaphore_init(&enableSem, 1) != 0) )
+		if ((Mutex::Mutex_init(&creationMutex) != 0) || (Mutex::Mutex_init(&tagMutex) != 0) || (Mutex::Mutex_init(&childBucketMutex) != 0) || (Semaphore::Semaphore_init(&bucketAccessSem, 1) != 0) || (Semaphore::Semaphore_init(&enableSem, 1) != 0) || (Semaphore::Semaphore_init(&eventQueueSem, 1) != 0) || (Semaphore::Semaphore_init(&subscriberSem, 1) != 0))
 		{
 			return false;
 		}
 
+		NUMDISPATCHTHREADS = 1;
+		boost::optional<const boost::property_tree::ptree&> eventProperties = gConfigManager.getPtree("events");
+		if (eventProperties)
+		{
+			NUMDISPATCHTHREADS = eventProperties->get<U32>("dispatch threads", 1);
+			if (NUMDISPATCHTHREADS == 0)
+			{
+				NUMDISPATCHTHREADS = 1;
+			}
+		}
+
 		return true;
 	}
 
@@ -903,8 +919,20 @@ namespace kaleidoscope
 		Mutex::Mutex_destroy(&creationMutex);
 		Mutex::Mutex_destroy(&tagMutex);
 		Mutex::Mutex_destroy(&childBucketMutex);
+		Semaphore::Semaphore_destroy(&eventQueueSem);
+
+		sEventQueues[0].clear();
+		sEventQueues[1].clear();
+		sEventTimeWheel.clear();
+		sEventFrameWheel.clear();
 
 		kaleidoscope::LuaScriptHandle::ShutDown();
+
+		// Scripts unsubscribe themselves as they are destroyed, only listeners can be left.
+		Semaphore::Semaphore_destroy(&subscriberSem);
+		sEventSubscribers.clear();
+		sPendingSubscriptionChanges.clear();
+		sBroadcastDepth = 0;
 		kaleidoscope::TransformHandle::ShutDown();
 
 
@@ -1053,9 +1081,47 @@ namespace kaleidoscope
    /*
 	* GameObject::SendEvent(GameObjectHandle recipient, const Event& e)
 	* 
-	* Send the provided event to the requested GameObject to be dealt with.
+	* Queue the provided event for the requested GameObject.
+	* It is delivered by the next call to DispatchEvents(), if the recipient is destroyed before then the event is dropped.
 	*/
 	void GameObject::SendEvent(GameObjectHandle recipient, const Event& e)
+	{
+		QueuedEvent qe;
+		qe.mRecipient = recipient;
+		qe.mBroadcast = false;
+		qe.mEvent = e;
+
+		Semaphore::Semaphore_wait(&eventQueueSem);
+		sEventQueues[sEventWriteQueue].push_back(qe);
+		Semaphore::Semaphore_post(&eventQueueSem);
+	}
+
+
+   /*
+	* GameObject::BroadcastEvent(const Event& e)
+	*
+	* Queue the provided event for every GameObject.
+	* It is delivered by the next call to DispatchEvents().
+	*/
+	void GameObject::BroadcastEvent(const Event& e)
+	{
+		QueuedEvent qe;
+		qe.mRecipient = GameObjectHandle::null;
+		qe.mBroadcast = true;
+		qe.mEvent = e;
+
+		Semaphore::Semaphore_wait(&eventQueueSem);
+		sEventQueues[sEventWriteQueue].push_back(qe);
+		Semaphore::Semaphore_post(&eventQueueSem);
+	}
+
+
+   /*
+	* GameObject::SendEventImmediate(GameObjectHandle recipient, const Event& e)
+	* 
+	* Send the provided event to the requested GameObject to be dealt with before returning.
+	*/
+	void GameObject::SendEventImmediate(GameObjectHandle recipient, const Event& e)
 	{
 		GameObject* const rGO = recipient.getObject();
 		if (rGO != NULL)
@@ -1066,19 +1132,573 @@ namespace kaleidoscope
 
 
    /*
-	* GameObject::BroadcastEvent(const Event& e)
+	* GameObject::BroadcastEventImmediate(const Event& e)
 	*
-	* Send the provided event to every GameObject to be dealt with.
+	* Send the provided event to every script and listener subscribed to its type before returning.
+	* Tasks waiting on the events type are woken whether or not their script is subscribed, once each.
 	*/
-	void GameObject::BroadcastEvent(const Event& e)
+	void GameObject::BroadcastEventImmediate(const Event& e)
 	{
-		for (U64 i = 0; i < MAXNUMOBJECTS; ++i)
+		const U64 taskMark = LuaScriptHandle::EventTaskMark();
+
+		// The lists are not changed while any broadcast is in progress, see ChangeSubscription().
+		EventSubscribers* subscribers = NULL;
+		Semaphore::Semaphore_wait(&subscriberSem);
+		++sBroadcastDepth;
+		boost::unordered_map<StringID, EventSubscribers>::iterator found = sEventSubscribers.find(e.getEventType());
+		if (found != sEventSubscribers.end())
 		{
-			if (sGameObjectPool[i].mInitialized)
+			subscribers = &found->second;
+		}
+		Semaphore::Semaphore_post(&subscriberSem);
+
+		if (subscribers != NULL)
+		{
+			for (U32 i = 0; i < subscribers->mScripts.size(); ++i)
+			{
+				if (subscribers->mScripts[i].valid())
+				{
+					subscribers->mScripts[i].onBroadcast(e);
+				}
+			}
+
+			for (U32 i = 0; i < subscribers->mListeners.size(); ++i)
+			{
+				subscribers->mListeners[i].mListener(e, subscribers->mListeners[i].mData);
+			}
+		}
+
+		Semaphore::Semaphore_wait(&subscriberSem);
+		--sBroadcastDepth;
+		if (sBroadcastDepth == 0)
+		{
+			for (std::vector<SubscriptionChange>::const_iterator c = sPendingSubscriptionChanges.begin(); c != sPendingSubscriptionChanges.end(); ++c)
+			{
+				ApplySubscriptionChange(*c);
+			}
+			sPendingSubscriptionChanges.clear();
+		}
+		Semaphore::Semaphore_post(&subscriberSem);
+
+		LuaScriptHandle::WakeEventTasks(e, taskMark);
+	}
+
+
+   /*
+	* GameObject::AddEventListener(StringID eventType, EventListener listener, void* data)
+	*
+	* Call listener with data whenever an event of eventType is broadcast.
+	*/
+	void GameObject::AddEventListener(StringID eventType, EventListener listener, void* data)
+	{
+		SubscriptionChange change;
+		change.mEventType = eventType;
+		change.mSubscribe = true;
+		change.mIsScript = false;
+		change.mListener.mListener = listener;
+		change.mListener.mData = data;
+		ChangeSubscription(change);
+	}
+
+
+   /*
+	* GameObject::RemoveEventListener(StringID eventType, EventListener listener, void* data)
+	*
+	* Remove a listener added with AddEventListener, both listener and data must match.
+	*/
+	void GameObject::RemoveEventListener(StringID eventType, EventListener listener, void* data)
+	{
+		SubscriptionChange change;
+		change.mEventType = eventType;
+		change.mSubscribe = false;
+		change.mIsScript = false;
+		change.mListener.mListener = listener;
+		change.mListener.mData = data;
+		ChangeSubscription(change);
+	}
+
+
+   /*
+	* GameObject::SubscribeScript(StringID eventType, const LuaScriptHandle& script)
+	*
+	* Add the script to the broadcast list of eventType, used by LuaScript::subscribe().
+	*/
+	void GameObject::SubscribeScript(StringID eventType, const LuaScriptHandle& script)
+	{
+		SubscriptionChange change;
+		change.mEventType = eventType;
+		change.mSubscribe = true;
+		change.mIsScript = true;
+		change.mScript = script;
+		ChangeSubscription(change);
+	}
+
+
+   /*
+	* GameObject::UnsubscribeScript(StringID eventType, const LuaScriptHandle& script)
+	*
+	* Remove the script from the broadcast list of eventType, used by LuaScript::unsubscribe().
+	*/
+	void GameObject::UnsubscribeScript(StringID eventType, const LuaScriptHandle& script)
+	{
+		SubscriptionChange change;
+		change.mEventType = eventType;
+		change.mSubscribe = false;
+		change.mIsScript = true;
+		change.mScript = script;
+		ChangeSubscription(change);
+	}
+
+
+   /*
+	* GameObject::ChangeSubscription(const SubscriptionChange& change)
+	*
+	* Applies the change, or holds it until the last broadcast in progress finishes. Held changes keep their order.
+	* A script unsubscribed by a handler stays in the list until then but does not receive the rest of the broadcast,
+	*	LuaScript::onBroadcast() checks the scripts own subscriptions, which change at once.
+	*/
+	void GameObject::ChangeSubscription(const SubscriptionChange& change)
+	{
+		Semaphore::Semaphore_wait(&subscriberSem);
+		if (sBroadcastDepth > 0)
+		{
+			sPendingSubscriptionChanges.push_back(change);
+		}
+		else
+		{
+			ApplySubscriptionChange(change);
+		}
+		Semaphore::Semaphore_post(&subscriberSem);
+	}
+
+
+   /*
+	* GameObject::ApplySubscriptionChange(const SubscriptionChange& change)
+	*
+	* subscriberSem must be held.
+	*/
+	void GameObject::ApplySubscriptionChange(const SubscriptionChange& change)
+	{
+		if (change.mSubscribe)
+		{
+			EventSubscribers& subscribers = sEventSubscribers[change.mEventType];
+			if (change.mIsScript)
+			{
+				if (std::find(subscribers.mScripts.begin(), subscribers.mScripts.end(), change.mScript) == subscribers.mScripts.end())
+				{
+					subscribers.mScripts.push_back(change.mScript);
+				}
+			}
+			else
+			{
+				subscribers.mListeners.push_back(change.mListener);
+			}
+			return;
+		}
+
+		boost::unordered_map<StringID, EventSubscribers>::iterator found = sEventSubscribers.find(change.mEventType);
+		if (found == sEventSubscribers.end())
+		{
+			return;
+		}
+
+		if (change.mIsScript)
+		{
+			std::vector<LuaScriptHandle>& scripts = found->second.mScripts;
+			std::vector<LuaScriptHandle>::iterator s = std::find(scripts.begin(), scripts.end(), change.mScript);
+			if (s != scripts.end())
+			{
+				// Order between subscribers is not guaranteed so swap with the back instead of shifting.
+				*s = scripts.back();
+				scripts.pop_back();
+			}
+		}
+		else
+		{
+			std::vector<EventListenerEntry>& listeners = found->second.mListeners;
+			for (std::vector<EventListenerEntry>::iterator l = listeners.begin(); l != listeners.end(); ++l)
+			{
+				if ((*l).mListener == change.mListener.mListener && (*l).mData == change.mListener.mData)
+				{
+					listeners.erase(l);
+					break;
+				}
+			}
+		}
+
+		if (found->second.mScripts.empty() && found->second.mListeners.empty())
+		{
+			sEventSubscribers.erase(found);
+		}
+	}
+
+
+   /*
+	* GameObject::printSubscribers()
+	*
+	* Print how many scripts and listeners are subscribed to each event type.
+	*/
+	void GameObject::printSubscribers()
+	{
+		Semaphore::Semaphore_wait(&subscriberSem);
+		gLogManager.log("Event subscribers:");
+		for (boost::unordered_map<StringID, EventSubscribers>::iterator s = sEventSubscribers.begin(); s != sEventSubscribers.end(); ++s)
+		{
+			const char * name = getString(s->first);
+			gLogManager.log("	%s (%u): %u scripts, %u listeners", (name != NULL ? name : "?"), s->first,
+							static_cast<U32>(s->second.mScripts.size()), static_cast<U32>(s->second.mListeners.size()));
+		}
+		Semaphore::Semaphore_post(&subscriberSem);
+	}
+
+
+   /*
+	* GameObject::RenderableLoaded(const RenderableHandle& r, StringID path, bool success, void* go)
+	*
+	* Tell the GameObject owning the renderable that one of its assets finished loading.
+	* Sent as an "assetLoaded" event holding the path of the asset and whether it loaded.
+	*/
+	void GameObject::RenderableLoaded(const RenderableHandle& r, StringID path, bool success, void* go)
+	{
+		static_cast<void>(r);
+
+		Event e;
+		e.setEventType("assetLoaded"_sid);
+		e.addStringID(0, path);
+		e.addBool(1, success);
+		SendEvent(GameObjectHandle(static_cast<GameObject*>(go)), e);
+	}
+
+
+   /*
+	* GameObject::QueuedEventOrder(const QueuedEvent& lhs, const QueuedEvent& rhs)
+	*
+	* Orders queued events by recipient pool index so each GameObjects events are handled together.
+	* Broadcasts sort after all direct events.
+	*/
+	bool GameObject::QueuedEventOrder(const QueuedEvent& lhs, const QueuedEvent& rhs)
+	{
+		if (lhs.mBroadcast != rhs.mBroadcast)
+		{
+			return rhs.mBroadcast;
+		}
+		return lhs.mRecipient.mOPTindex < rhs.mRecipient.mOPTindex;
+	}
+
+
+   /*
+	* GameObject::DispatchRangeOfEvents(DispatchRange& range)
+	*
+	* Deliver a run of queued events and record how long each event type took to handle.
+	*/
+	void GameObject::DispatchRangeOfEvents(DispatchRange& range)
+	{
+		for (std::vector<QueuedEvent>::const_iterator qe = range.mBegin; qe != range.mEnd; ++qe)
+		{
+			const U64 start = SDL_GetPerformanceCounter();
+
+			if (qe->mBroadcast)
+			{
+				BroadcastEventImmediate(qe->mEvent);
+			}
+			else
+			{
+				GameObject* const rGO = qe->mRecipient.getObject();
+				if (rGO != NULL)
+				{
+					rGO->onEvent(qe->mEvent);
+				}
+			}
+
+			EventTypeStats& stats = range.mStats[qe->mEvent.getEventType()];
+			++stats.mCount;
+			stats.mTicks += SDL_GetPerformanceCounter() - start;
+		}
+	}
+
+
+   /*
+	* GameObject::TaskDispatch(void* range)
+	*
+	* The thread function used to deliver one DispatchRange of a batch.
+	*
+	* Return Value: 0 - always.
+	*/
+	int GameObject::TaskDispatch(void* range)
+	{
+		DispatchRangeOfEvents(*static_cast<DispatchRange*>(range));
+		return 0;
+	}
+
+
+   /*
+	* GameObject::QueueDueEvent::operator()(const QueuedEvent& qe)
+	*
+	* Moves a delayed event that came due into the write queue, eventQueueSem must be held.
+	*/
+	void GameObject::QueueDueEvent::operator()(const QueuedEvent& qe)
+	{
+		sEventQueues[sEventWriteQueue].push_back(qe);
+	}
+
+
+   /*
+	* DelayedEventTick(F64 now, F32 delay)
+	*
+	* Return Value: The time wheel tick, in milliseconds, delay seconds after now. NaN and negative delays are due
+	*	at once, delays past the last tick are clamped to it so the conversion never overflows.
+	*/
+	static U64 DelayedEventTick(F64 now, F32 delay)
+	{
+		const F64 ms = (now + (delay > 0.0f ? delay : 0.0f)) * 1000.0;
+		return (ms < 18446744073709551616.0 ? static_cast<U64>(ms) : ~static_cast<U64>(0));
+	}
+
+
+   /*
+	* GameObject::SendEventDelayed(GameObjectHandle recipient, const Event& e, F32 delay)
+	*
+	* Queue the provided event for the requested GameObject on the first DispatchEvents() at least delay seconds from now.
+	*/
+	void GameObject::SendEventDelayed(GameObjectHandle recipient, const Event& e, F32 delay)
+	{
+		QueuedEvent qe;
+		qe.mRecipient = recipient;
+		qe.mBroadcast = false;
+		qe.mEvent = e;
+
+		Semaphore::Semaphore_wait(&eventQueueSem);
+		sEventTimeWheel.schedule(DelayedEventTick(sEventTime, delay), qe);
+		Semaphore::Semaphore_post(&eventQueueSem);
+	}
+
+
+   /*
+	* GameObject::BroadcastEventDelayed(const Event& e, F32 delay)
+	*
+	* Queue the provided event for every GameObject on the first DispatchEvents() at least delay seconds from now.
+	*/
+	void GameObject::BroadcastEventDelayed(const Event& e, F32 delay)
+	{
+		QueuedEvent qe;
+		qe.mRecipient = GameObjectHandle::null;
+		qe.mBroadcast = true;
+		qe.mEvent = e;
+
+		Semaphore::Semaphore_wait(&eventQueueSem);
+		sEventTimeWheel.schedule(DelayedEventTick(sEventTime, delay), qe);
+		Semaphore::Semaphore_post(&eventQueueSem);
+	}
+
+
+   /*
+	* GameObject::SendEventAtFrame(GameObjectHandle recipient, const Event& e, U64 frame)
+	*
+	* Queue the provided event for the requested GameObject on the given event frame, see GetEventFrame().
+	* Frames that have already passed deliver on the next DispatchEvents().
+	*/
+	void GameObject::SendEventAtFrame(GameObjectHandle recipient, const Event& e, U64 frame)
+	{
+		QueuedEvent qe;
+		qe.mRecipient = recipient;
+		qe.mBroadcast = false;
+		qe.mEvent = e;
+
+		Semaphore::Semaphore_wait(&eventQueueSem);
+		sEventFrameWheel.schedule(frame, qe);
+		Semaphore::Semaphore_post(&eventQueueSem);
+	}
+
+
+   /*
+	* GameObject::BroadcastEventAtFrame(const Event& e, U64 frame)
+	*
+	* Queue the provided event for every GameObject on the given event frame, see GetEventFrame().
+	*/
+	void GameObject::BroadcastEventAtFrame(const Event& e, U64 frame)
+	{
+		QueuedEvent qe;
+		qe.mRecipient = GameObjectHandle::null;
+		qe.mBroadcast = true;
+		qe.mEvent = e;
+
+		Semaphore::Semaphore_wait(&eventQueueSem);
+		sEventFrameWheel.schedule(frame, qe);
+		Semaphore::Semaphore_post(&eventQueueSem);
+	}
+
+
+   /*
+	* GameObject::GetEventFrame()
+	*
+	* Return Value: The number of times DispatchEvents() has been called.
+	*/
+	U64 GameObject::GetEventFrame()
+	{
+		return sEventFrameWheel.now();
+	}
+
+
+   /*
+	* GameObject::NumDelayedEvents()
+	*
+	* Return Value: The number of delayed events waiting to come due.
+	*/
+	U64 GameObject::NumDelayedEvents()
+	{
+		Semaphore::Semaphore_wait(&eventQueueSem);
+		U64 n = sEventTimeWheel.size() + sEventFrameWheel.size();
+		Semaphore::Semaphore_post(&eventQueueSem);
+		return n;
+	}
+
+
+   /*
+	* GameObject::DispatchEvents(F32 dt)
+	*
+	* Deliver every event queued since the last call in one batch.
+	* Delayed events are advanced by dt seconds and one frame first and those that came due join the batch.
+	* The queues are swapped first, so events sent by handlers are queued for the next call.
+	* The batch is sorted by recipient and split into runs that never share a recipient, the runs are handed to
+	*	"dispatch threads" threads (set in the events config section, default 1). Scripts are only ever touched by
+	*	the thread handling their GameObject. Broadcasts are delivered on the calling thread after the direct events.
+	*/
+	void GameObject::DispatchEvents(F32 dt)
+	{
+		QueueDueEvent queueDue;
+
+		Semaphore::Semaphore_wait(&eventQueueSem);
+		sEventTime += dt;
+		sEventTimeWheel.advance(static_cast<U64>(sEventTime * 1000.0), queueDue);
+		sEventFrameWheel.advance(sEventFrameWheel.now() + 1, queueDue);
+
+		std::vector<QueuedEvent>& batch = sEventQueues[sEventWriteQueue];
+		sEventWriteQueue = 1 - sEventWriteQueue;
+		Semaphore::Semaphore_post(&eventQueueSem);
+
+		if (batch.empty())
+		{
+			return;
+		}
+
+		std::stable_sort(batch.begin(), batch.end(), QueuedEventOrder);
+
+		std::vector<QueuedEvent>::const_iterator batchBegin = batch.begin();
+		std::vector<QueuedEvent>::const_iterator batchEnd = batch.end();
+		std::vector<QueuedEvent>::const_iterator firstBroadcast = batchBegin;
+		while (firstBroadcast != batchEnd && !firstBroadcast->mBroadcast)
+		{
+			++firstBroadcast;
+		}
+
+		// Split the direct events into runs of roughly equal size, extending each run to the end of its recipients events.
+		const U64 numDirect = firstBroadcast - batchBegin;
+		const U64 numThreads = (numDirect < NUMDISPATCHTHREADS ? (numDirect > 0 ? numDirect : 1) : NUMDISPATCHTHREADS);
+		std::vector<DispatchRange> ranges(static_cast<size_t>(numThreads));
+		std::vector<QueuedEvent>::const_iterator runStart = batchBegin;
+		for (U64 t = 0; t < numThreads; ++t)
+		{
+			std::vector<QueuedEvent>::const_iterator runEnd = firstBroadcast;
+			if (t + 1 < numThreads)
 			{
-				sGameObjectPool[i].onEvent(e);
+				const U64 target = (numDirect * (t + 1)) / numThreads;
+				runEnd = batchBegin + static_cast<size_t>(target);
+				if (runEnd < runStart)
+				{
+					runEnd = runStart;
+				}
+				while (runEnd != firstBroadcast && runEnd != batchBegin && (runEnd - 1)->mRecipient.mOPTindex == runEnd->mRecipient.mOPTindex)
+				{
+					++runEnd;
+				}
 			}
+			ranges[static_cast<size_t>(t)].mBegin = runStart;
+			ranges[static_cast<size_t>(t)].mEnd = runEnd;
+			runStart = runEnd;
 		}
+
+		if (numThreads == 1)
+		{
+			DispatchRangeOfEvents(ranges[0]);
+		}
+		else
+		{
+			// Ranges whose thread could not be created are dispatched on this thread instead of dropped.
+			std::vector<Thread> threads(static_cast<size_t>(numThreads - 1));
+			std::vector<size_t> inlineRanges;
+			for (size_t t = 0; t < threads.size(); ++t)
+			{
+				if (Thread::Thread_create(&threads[t], NULL, TaskDispatch, &ranges[t + 1]) != 0)
+				{
+					inlineRanges.push_back(t + 1);
+				}
+			}
+
+			DispatchRangeOfEvents(ranges[0]);
+			for (std::vector<size_t>::iterator r = inlineRanges.begin(); r != inlineRanges.end(); ++r)
+			{
+				DispatchRangeOfEvents(ranges[*r]);
+			}
+
+			I32 status = 0;
+			for (size_t t = 0; t < threads.size(); ++t)
+			{
+				Thread::Thread_waitFor(&threads[t], &status);
+			}
+		}
+
+		DispatchRange broadcasts;
+		broadcasts.mBegin = firstBroadcast;
+		broadcasts.mEnd = batchEnd;
+		DispatchRangeOfEvents(broadcasts);
+		ranges.push_back(broadcasts);
+
+		for (std::vector<DispatchRange>::iterator r = ranges.begin(); r != ranges.end(); ++r)
+		{
+			for (EventStatsMap::iterator s = r->mStats.begin(); s != r->mStats.end(); ++s)
+			{
+				EventTypeStats& total = sEventStats[s->first];
+				total.mCount += s->second.mCount;
+				total.mTicks += s->second.mTicks;
+			}
+		}
+
+		++sEventBatches;
+		batch.clear();
+	}
+
+
+   /*
+	* GameObject::printEventStats()
+	*
+	* Print how many events of each type have been dispatched and how long their handlers took.
+	*/
+	void GameObject::printEventStats()
+	{
+		const F64 ticksPerMS = static_cast<F64>(SDL_GetPerformanceFrequency()) / 1000.0;
+
+		gLogManager.log("Event stats over %llu batches.", sEventBatches);
+		for (EventStatsMap::iterator s = sEventStats.begin(); s != sEventStats.end(); ++s)
+		{
+			const F64 totalMS = static_cast<F64>(s->second.mTicks) / ticksPerMS;
+			const char * name = getString(s->first);
+			gLogManager.log("	%s (%u): %llu events, %.3f ms total, %.4f ms per event, %.2f events per batch",
+							(name != NULL ? name : "?"), s->first, s->second.mCount, totalMS,
+							totalMS / static_cast<F64>(s->second.mCount),
+							static_cast<F64>(s->second.mCount) / static_cast<F64>(sEventBatches));
+		}
+	}
+
+
+   /*
+	* GameObject::resetEventStats()
+	*
+	* Clear the event stats gathered by DispatchEvents().
+	*/
+	void GameObject::resetEventStats()
+	{
+		sEventStats.clear();
+		sEventBatches = 0;
 	}
 
 
@@ -1169,9 +1789,9 @@ namespace kaleidoscope
 	}
 
 
-	static const StringID GameObjectID = hashCRC32("gameobject");
-	static const StringID TagID = hashCRC32("tag");
-	static const StringID NameID = hashCRC32("name");
+	static const StringID GameObjectID = "gameobject"_sid;
+	static const StringID TagID = "tag"_sid;
+	static const StringID NameID = "name"_sid;
 
    /*
 	* isParent(boost::propert_tree::ptree goI)
@@ -1188,7 +1808,7 @@ namespace kaleidoscope
 		StringID goName;
 		BOOST_FOREACH(boost::property_tree::ptree::value_type const & go, goI)
 		{
-			goName = lowerize(go.first.c_str());
+			goName = hashCRC32Lower(go.first.c_str());
 			if (goName == NameID)
 			{
 				if (go.second.data().compare(parentName) == 0)
@@ -1289,7 +1909,7 @@ namespace kaleidoscope
 			StringID goName;
 			BOOST_FOREACH(ptree::value_type const & go, *gameWorld)
 			{
-				goName = lowerize(go.first.c_str());
+				goName = hashCRC32Lower(go.first.c_str());
 
 				// Get the subtrees for each of the GameObjects. 
 				//	for later processing.
@@ -1325,7 +1945,7 @@ namespace kaleidoscope
 					BOOST_FOREACH(ptree::value_type const & goField, *go)
 					{
 						// Account for capitalization preferences.
-						StringID fieldID = lowerize(goField.first.c_str());
+						StringID fieldID = hashCRC32Lower(goField.first.c_str());
 						if (fieldID == parentID)
 						{
 							parentName = goField.second.data();
@@ -1378,6 +1998,9 @@ namespace kaleidoscope
 			{
 				(*goh).enable();
 			}
+
+			// Loading is the one place a full collection stall goes unnoticed.
+			LuaScriptHandle::FullCollect();
 		}
 	}
 
@@ -1420,7 +2043,7 @@ namespace kaleidoscope
 			StringID goName;
 			BOOST_FOREACH(ptree::value_type const & go, *gameWorld)
 			{
-				goName = lowerize(go.first.c_str());
+				goName = hashCRC32Lower(go.first.c_str());
 
 				// Get the subtrees for each of the GameObjects. 
 				//	for later processing.
@@ -1456,7 +2079,7 @@ namespace kaleidoscope
 					BOOST_FOREACH(ptree::value_type const & goField, *go)
 					{
 						// Account for capitalization preferences.
-						StringID fieldID = lowerize(goField.first.c_str());
+						StringID fieldID = hashCRC32Lower(goField.first.c_str());
 						if (fieldID == parentID)
 						{
 							parentName = goField.second.data();
@@ -1504,6 +2127,9 @@ namespace kaleidoscope
 				(*goh).enable();
 			}
 
+			// Loading is the one place a full collection stall goes unnoticed.
+			LuaScriptHandle::FullCollect();
+
 		}
 	}
 
@@ -1697,7 +2323,7 @@ namespace kaleidoscope
 	}
 
 
-	StringID GameObject::NAME = hashCRC32("gameobject");
+	StringID GameObject::NAME = "gameobject"_sid;
 	U32 GameObject::MAXNUMOBJECTS;
 	U32 GameObject::NUMBUCKETS;
 
@@ -1707,4 +2333,18 @@ namespace kaleidoscope
 	GameObject* GameObject::sGameObjectPool = NULL;
 
 	boost::unordered_map<StringID, GameObjectHandle> GameObject::sNameMap;
+
+	std::vector<GameObject::QueuedEvent> GameObject::sEventQueues[2];
+	U32 GameObject::sEventWriteQueue = 0;
+	U32 GameObject::NUMDISPATCHTHREADS = 1;
+	GameObject::EventStatsMap GameObject::sEventStats;
+	U64 GameObject::sEventBatches = 0;
+
+	TimerWheel<GameObject::QueuedEvent> GameObject::sEventTimeWheel;
+	TimerWheel<GameObject::QueuedEvent> GameObject::sEventFrameWheel;
+	F64 GameObject::sEventTime = 0.0;
+
+	boost::unordered_map<StringID, GameObject::EventSubscribers> GameObject::sEventSubscribers;
+	std::vector<GameObject::SubscriptionChange> GameObject::sPendingSubscriptionChanges;
+	U32 GameObject::sBroadcastDepth = 0;
 }
@@ -6,10 +6,12 @@
 #include <boost/property_tree/ptree.hpp>
 #include <boost/unordered_map.hpp>
 #include <list>
+#include <vector>
 #include <bitset>
 #include <GameObject/TagPool.h>
 
 #include <Event/Event.h>
+#include <Event/TimerWheel.h>
 
 #include <GameObject/GameObjectHandle.h>
 
@@ -123,8 +125,32 @@ namespace kaleidoscope
 		static void Destroy(GameObjectHandle gameObjectToDestroy);
 		static void DestroyImmediate(GameObjectHandle gameObjectToDestroy);
 
-		static void SendEvent(GameObjectHandle recipient, const Event& e);
+		static void SendEvent(GameObjectHandle recipient, const Event& e);		// Queued, delivered by the next DispatchEvents().
 		static void BroadcastEvent(const Event& e);
+		static void SendEventImmediate(GameObjectHandle recipient, const Event& e);	// Delivered before returning.
+		static void BroadcastEventImmediate(const Event& e);
+		static void DispatchEvents(F32 dt = 0.0f);		// dt advances the delayed events.
+
+		// Delayed events are held in timer wheels and queued on the DispatchEvents() they come due on.
+		static void SendEventDelayed(GameObjectHandle recipient, const Event& e, F32 delay);	// delay is in seconds.
+		static void BroadcastEventDelayed(const Event& e, F32 delay);
+		static void SendEventAtFrame(GameObjectHandle recipient, const Event& e, U64 frame);	// frame counts DispatchEvents() calls.
+		static void BroadcastEventAtFrame(const Event& e, U64 frame);
+		static U64 GetEventFrame();
+		static U64 NumDelayedEvents();
+		static void printEventStats();
+		static void resetEventStats();
+
+		// Subscriptions.
+		// Broadcasts only reach the scripts and listeners subscribed to the events type.
+		// Scripts subscribe themselves to the handlers they declare, see LuaScript::subscribeHandlers().
+		// Listeners only receive broadcasts, events sent to a GameObject go to its scripts.
+		typedef void (*EventListener)(const Event& e, void* data);
+		static void AddEventListener(StringID eventType, EventListener listener, void* data);
+		static void RemoveEventListener(StringID eventType, EventListener listener, void* data);
+		static void SubscribeScript(StringID eventType, const LuaScriptHandle& script);
+		static void UnsubscribeScript(StringID eventType, const LuaScriptHandle& script);
+		static void printSubscribers();
 
 		static GameObjectHandle FindByName(const StringID name);
 		static GameObjectHandle FindByTag(const StringID tag);
@@ -144,6 +170,7 @@ namespace kaleidoscope
 		static void rmvP(GameObjectHandle go);
 		static void addP(GameObjectHandle go, GameObjectHandle p);
 		static void ppBucket(GameObjectHandle go, I32 v);
+		static void RenderableLoaded(const RenderableHandle& r, StringID path, bool success, void* go);
 
 		static TagPool sTags;
 
@@ -151,5 +178,71 @@ namespace kaleidoscope
 		static GameObject* sGameObjectPool;
 
 		static boost::unordered_map<StringID, GameObjectHandle> sNameMap; // Acceleration structure for find by name. 
+
+		// Event queue.
+		// Events are written into one buffer while the other is being dispatched, so handlers that send events
+		//	queue them for the next DispatchEvents() instead of re-entering the dispatcher.
+		struct QueuedEvent
+		{
+			GameObjectHandle mRecipient;
+			bool mBroadcast;
+			Event mEvent;
+		};
+		struct EventTypeStats
+		{
+			U64 mCount;
+			U64 mTicks;		// SDL performance counter ticks spent in handlers.
+		};
+		typedef boost::unordered_map<StringID, EventTypeStats> EventStatsMap;
+		struct DispatchRange
+		{
+			std::vector<QueuedEvent>::const_iterator mBegin;
+			std::vector<QueuedEvent>::const_iterator mEnd;
+			EventStatsMap mStats;
+		};
+		static bool QueuedEventOrder(const QueuedEvent& lhs, const QueuedEvent& rhs);
+		static void DispatchRangeOfEvents(DispatchRange& range);
+		static int TaskDispatch(void* range);
+
+		static std::vector<QueuedEvent> sEventQueues[2];
+		static U32 sEventWriteQueue;
+		static U32 NUMDISPATCHTHREADS;
+		static EventStatsMap sEventStats;
+		static U64 sEventBatches;
+
+		struct QueueDueEvent
+		{
+			void operator()(const QueuedEvent& qe);
+		};
+		static TimerWheel<QueuedEvent> sEventTimeWheel;		// Ticks are milliseconds.
+		static TimerWheel<QueuedEvent> sEventFrameWheel;	// Ticks are DispatchEvents() calls.
+		static F64 sEventTime;								// Seconds.
+
+		struct EventListenerEntry
+		{
+			EventListener mListener;
+			void* mData;
+		};
+		struct EventSubscribers
+		{
+			std::vector<LuaScriptHandle> mScripts;
+			std::vector<EventListenerEntry> mListeners;
+		};
+		static boost::unordered_map<StringID, EventSubscribers> sEventSubscribers;
+
+		// Subscription changes made while a broadcast is being delivered wait until no broadcast is, so the
+		//	subscriber lists can be walked in place instead of copied for every broadcast.
+		struct SubscriptionChange
+		{
+			StringID mEventType;
+			bool mSubscribe;
+			bool mIsScript;
+			LuaScriptHandle mScript;
+			EventListenerEntry mListener;
+		};
+		static void ChangeSubscription(const SubscriptionChange& change);
+		static void ApplySubscriptionChange(const SubscriptionChange& change);
+		static std::vector<SubscriptionChange> sPendingSubscriptionChanges;
+		static U32 sBroadcastDepth;
 	};
 }
\ No newline at end of file
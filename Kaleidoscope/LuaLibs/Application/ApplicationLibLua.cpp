@@ -2,12 +2,7 @@
 
 extern bool gRunning;
 
-extern "C"
-{
-#include <lua.h>
-#include <lualib.h>
-#include <lauxlib.h>
-}
+#include <LuaLibs/Utility/lua_compat.h>
 
 static int lua_quit(lua_State* L)
 {
@@ -2,19 +2,26 @@
 
 #include <Event/Event.h>
 
+#include <Components/LuaScript/LuaScriptHandle.h>
+#include <GameObject/GameObject.h>
+#include <GameObject/GameObjectHandle.h>
+#include <LuaLibs/Task/TaskLibLua.h>
+
 #include <Utility/StringID/StringId.h>
 
-extern "C"
-{
-#include <lua.h>
-#include <lualib.h>
-#include <lauxlib.h>
-}
+#include <LuaLibs/Utility/lua_compat.h>
+#include <LuaLibs/Utility/lua_getters.h>
+
+#include <cfloat>
+#include <cmath>
+#include <new>
 
 static const char * eventTypeName = "kaleidoscope.event";
+static const char * eventProxyTypeName = "kaleidoscope.eventproxy";
 static const char * vec3TypeName = "kaleidoscope.vec3";
 static const char * vec4TypeName = "kaleidoscope.vec4";
 static const char * quatTypeName = "kaleidoscope.quat";
+static const char * gameObjectHandleTypeName = "kaleidoscope.GameObjectHandle";
 
 using kaleidoscope::Event;
 using kaleidoscope::math::vec3;
@@ -23,40 +30,126 @@ using kaleidoscope::math::quat;
 
 static Event* newevent(lua_State* L)
 {
-	Event* n = static_cast<Event*>(lua_newuserdata(L, sizeof(Event)));
-	luaL_getmetatable(L, eventTypeName);
-	lua_setmetatable(L, -2);
-	return n;
+	return kaleidoscope::luapush_event(L, Event());
 }
 
-static vec3* newvec3(lua_State* L)
+// Accepts an event or the event proxy handed to handlers.
+static const Event* checkevent(lua_State* L, int arg)
 {
-	vec3* n = static_cast<vec3*>(lua_newuserdata(L, sizeof(vec3)));
-	luaL_getmetatable(L, vec3TypeName);
-	lua_setmetatable(L, -2);
-	return n;
+	Event* e = static_cast<Event*>(luaL_testudata(L, arg, eventTypeName));
+	if (e != NULL)
+	{
+		return e;
+	}
+
+	const Event** proxy = static_cast<const Event**>(luaL_testudata(L, arg, eventProxyTypeName));
+	luaL_argcheck(L, proxy != NULL, arg, "event expected");
+	luaL_argcheck(L, *proxy != NULL, arg, "event used after its handler returned, keep a copy with event:copy()");
+	return *proxy;
 }
 
-static vec4* newvec4(lua_State* L)
+static int lua_eventnew(lua_State* L)
 {
-	vec4* n = static_cast<vec4*>(lua_newuserdata(L, sizeof(vec4)));
-	luaL_getmetatable(L, vec4TypeName);
-	lua_setmetatable(L, -2);
-	return n;
+	newevent(L);
+	return 1;
 }
 
-static quat* newquat(lua_State* L)
+static int lua_eventgc(lua_State* L)
 {
-	quat* n = static_cast<quat*>(lua_newuserdata(L, sizeof(quat)));
-	luaL_getmetatable(L, quatTypeName);
-	lua_setmetatable(L, -2);
-	return n;
+	Event* e = static_cast<Event*>(luaL_checkudata(L, 1, eventTypeName));
+	e->~Event();
+	return 0;
 }
 
-static int lua_eventnew(lua_State* L)
+static int lua_eventcopy(lua_State* L)
+{
+	const Event* e = checkevent(L, 1);
+	kaleidoscope::luapush_event(L, *e);
+	return 1;
+}
+
+static int lua_eventnumargs(lua_State* L)
 {
-	Event* e = newevent(L);
-	*e = Event();
+	const Event* e = checkevent(L, 1);
+	lua_pushnumber(L, e->numArgs());
+	return 1;
+}
+
+static kaleidoscope::StringID checkeventtype(lua_State* L, int arg)
+{
+	if (lua_type(L, arg) == LUA_TSTRING)
+	{
+		return kaleidoscope::internString(lua_tostring(L, arg));
+	}
+	return static_cast<kaleidoscope::StringID>(luaL_checkunsigned(L, arg));
+}
+
+// kEvent.subscribe(string or StringID), broadcasts of the type are handed to the global function with its name.
+static int lua_eventsubscribe(lua_State* L)
+{
+	kaleidoscope::LuaScriptHandle* owner = kaleidoscope::luaget_taskowner(L);
+	luaL_argcheck(L, owner != NULL, 1, "no script owns this lua state");
+	owner->subscribe(checkeventtype(L, 1), (lua_type(L, 1) == LUA_TSTRING ? lua_tostring(L, 1) : NULL));
+	return 0;
+}
+
+// kEvent.unsubscribe(string or StringID)
+static int lua_eventunsubscribe(lua_State* L)
+{
+	kaleidoscope::LuaScriptHandle* owner = kaleidoscope::luaget_taskowner(L);
+	luaL_argcheck(L, owner != NULL, 1, "no script owns this lua state");
+	owner->unsubscribe(checkeventtype(L, 1));
+	return 0;
+}
+
+// kEvent.sendDelayed(GameObjectHandle, event, seconds)
+static int lua_eventsenddelayed(lua_State* L)
+{
+	kaleidoscope::GameObjectHandle* goh = static_cast<kaleidoscope::GameObjectHandle*>(luaL_checkudata(L, 1, gameObjectHandleTypeName));
+	const Event* e = checkevent(L, 2);
+	lua_Number delay = luaL_checknumber(L, 3);
+	luaL_argcheck(L, delay >= 0 && delay < HUGE_VAL, 3, "delay must be a finite non-negative number");
+	kaleidoscope::GameObject::SendEventDelayed(*goh, *e, static_cast<F32>(delay < FLT_MAX ? delay : FLT_MAX));
+	return 0;
+}
+
+// kEvent.broadcastDelayed(event, seconds)
+static int lua_eventbroadcastdelayed(lua_State* L)
+{
+	const Event* e = checkevent(L, 1);
+	lua_Number delay = luaL_checknumber(L, 2);
+	luaL_argcheck(L, delay >= 0 && delay < HUGE_VAL, 2, "delay must be a finite non-negative number");
+	kaleidoscope::GameObject::BroadcastEventDelayed(*e, static_cast<F32>(delay < FLT_MAX ? delay : FLT_MAX));
+	return 0;
+}
+
+// kEvent.sendAtFrame(GameObjectHandle, event, frame)
+static int lua_eventsendatframe(lua_State* L)
+{
+	kaleidoscope::GameObjectHandle* goh = static_cast<kaleidoscope::GameObjectHandle*>(luaL_checkudata(L, 1, gameObjectHandleTypeName));
+	const Event* e = checkevent(L, 2);
+	lua_Number n = luaL_checknumber(L, 3);
+	luaL_argcheck(L, n >= 0 && n < 18446744073709551616.0, 3, "frame must be a non-negative number");
+	U64 frame = static_cast<U64>(n);
+	kaleidoscope::GameObject::SendEventAtFrame(*goh, *e, frame);
+	return 0;
+}
+
+// kEvent.broadcastAtFrame(event, frame)
+static int lua_eventbroadcastatframe(lua_State* L)
+{
+	const Event* e = checkevent(L, 1);
+	lua_Number n = luaL_checknumber(L, 2);
+	luaL_argcheck(L, n >= 0 && n < 18446744073709551616.0, 2, "frame must be a non-negative number");
+	U64 frame = static_cast<U64>(n);
+	kaleidoscope::GameObject::BroadcastEventAtFrame(*e, frame);
+	return 0;
+}
+
+// kEvent.frame(), the frame sendAtFrame and broadcastAtFrame count in.
+static int lua_eventframe(lua_State* L)
+{
+	lua_pushnumber(L, static_cast<lua_Number>(kaleidoscope::GameObject::GetEventFrame()));
 	return 1;
 }
 
@@ -71,14 +164,14 @@ static int lua_eventseteventtype(lua_State* L)
 
 static int lua_eventgeteventtype(lua_State* L)
 {
-	Event* e = static_cast<Event*>(luaL_checkudata(L, 1, eventTypeName));
+	const Event* e = checkevent(L, 1);
 	lua_pushnumber(L, e->getEventType());
 	return 1;
 }
 
 static int lua_eventmaxsize(lua_State* L)
 {
-	Event* e = static_cast<Event*>(luaL_checkudata(L, 1, eventTypeName));
+	const Event* e = checkevent(L, 1);
 	lua_pushnumber(L, e->maxSize());
 	return 1;
 }
@@ -125,7 +218,7 @@ static int lua_eventaddquat(lua_State* L)
 
 static int lua_eventgetnumber(lua_State* L)
 {
-	Event* e = static_cast<Event*>(luaL_checkudata(L, 1, eventTypeName));
+	const Event* e = checkevent(L, 1);
 	U32 i = static_cast<U32>(luaL_checkunsigned(L, 2));
 	luaL_argcheck(L, (i < e->maxSize() && i >= 0), 1, "index is out of range");
 
@@ -136,11 +229,11 @@ static int lua_eventgetnumber(lua_State* L)
 
 static int lua_eventgetvec3(lua_State* L)
 {
-	Event* e = static_cast<Event*>(luaL_checkudata(L, 1, eventTypeName));
+	const Event* e = checkevent(L, 1);
 	U32 i = static_cast<U32>(luaL_checkunsigned(L, 2));
 	luaL_argcheck(L, (i < e->maxSize() && i >= 0), 1, "index is out of range");
 
-	vec3* v = newvec3(L);
+	vec3* v = outudata<vec3>(L, vec3TypeName, 3);
 	*v = e->getVec3(i);
 
 	return 1;
@@ -148,11 +241,11 @@ static int lua_eventgetvec3(lua_State* L)
 
 static int lua_eventgetvec4(lua_State* L)
 {
-	Event* e = static_cast<Event*>(luaL_checkudata(L, 1, eventTypeName));
+	const Event* e = checkevent(L, 1);
 	U32 i = static_cast<U32>(luaL_checkunsigned(L, 2));
 	luaL_argcheck(L, (i < e->maxSize() && i >= 0), 1, "index is out of range");
 
-	vec4* v = newvec4(L);
+	vec4* v = outudata<vec4>(L, vec4TypeName, 3);
 	*v = e->getVec4(i);
 
 	return 1;
@@ -160,11 +253,11 @@ static int lua_eventgetvec4(lua_State* L)
 
 static int lua_eventgetquat(lua_State* L)
 {
-	Event* e = static_cast<Event*>(luaL_checkudata(L, 1, eventTypeName));
+	const Event* e = checkevent(L, 1);
 	U32 i = static_cast<U32>(luaL_checkunsigned(L, 2));
 	luaL_argcheck(L, (i < e->maxSize() && i >= 0), 1, "index is out of range");
 
-	quat* v = newquat(L);
+	quat* v = outudata<quat>(L, quatTypeName, 3);
 	*v = e->getQuat(i);
 
 	return 1;
@@ -174,6 +267,13 @@ static int lua_eventgetquat(lua_State* L)
 static const struct luaL_Reg event_sf[] =
 {
 	{ "new", lua_eventnew },
+	{ "subscribe", lua_eventsubscribe },
+	{ "unsubscribe", lua_eventunsubscribe },
+	{ "sendDelayed", lua_eventsenddelayed },
+	{ "broadcastDelayed", lua_eventbroadcastdelayed },
+	{ "sendAtFrame", lua_eventsendatframe },
+	{ "broadcastAtFrame", lua_eventbroadcastatframe },
+	{ "frame", lua_eventframe },
 	{ NULL, NULL }
 };
 
@@ -182,6 +282,7 @@ static const struct luaL_Reg event_mf[] =
 	{ "setEventType", lua_eventseteventtype },
 	{ "getEventType", lua_eventgeteventtype },
 	{ "maxSize", lua_eventmaxsize },
+	{ "numArgs", lua_eventnumargs },
 
 	{ "addNumber", lua_eventaddnumber },
 	{ "addVec3", lua_eventaddvec3 },
@@ -193,6 +294,25 @@ static const struct luaL_Reg event_mf[] =
 	{ "getVec4", lua_eventgetvec4 },
 	{ "getQuat", lua_eventgetquat },
 
+	{ "copy", lua_eventcopy },
+
+	{ NULL, NULL }
+};
+
+// The proxy is read only.
+static const struct luaL_Reg eventproxy_mf[] =
+{
+	{ "getEventType", lua_eventgeteventtype },
+	{ "maxSize", lua_eventmaxsize },
+	{ "numArgs", lua_eventnumargs },
+
+	{ "getNumber", lua_eventgetnumber },
+	{ "getVec3", lua_eventgetvec3 },
+	{ "getVec4", lua_eventgetvec4 },
+	{ "getQuat", lua_eventgetquat },
+
+	{ "copy", lua_eventcopy },
+
 	{ NULL, NULL }
 };
 
@@ -203,10 +323,61 @@ int kaleidoscope::luaopen_event(lua_State* L)
 	lua_pushvalue(L, -1);
 	lua_setfield(L, -2, "__index");
 	luaL_setfuncs(L, event_mf, 0);
+	lua_pushcfunction(L, lua_eventgc);
+	lua_setfield(L, -2, "__gc");
 
 	luaL_newlib(L, event_sf);
 	lua_setglobal(L, "kEvent");
 
 	lua_pop(L, 1); // pop the metatable.
+
+	luaL_newmetatable(L, eventProxyTypeName);
+	lua_pushvalue(L, -1);
+	lua_setfield(L, -2, "__index");
+	luaL_setfuncs(L, eventproxy_mf, 0);
+	lua_pop(L, 1);
+
 	return 0;
+}
+
+
+kaleidoscope::Event* kaleidoscope::luapush_event(lua_State* L, const Event& e)
+{
+	Event* n = new (lua_newuserdata(L, sizeof(Event))) Event(e);
+	luaL_getmetatable(L, eventTypeName);
+	lua_setmetatable(L, -2);
+	return n;
+}
+
+
+// The proxy is anchored in the registry under its own address until it is released, the handler may drop its
+//	argument and the proxy must not be collected before it is cleared.
+const kaleidoscope::Event** kaleidoscope::luapush_eventproxy(lua_State* L, const Event& e)
+{
+	const Event** proxy = static_cast<const Event**>(lua_newuserdata(L, sizeof(const Event*)));
+	*proxy = &e;
+	luaL_getmetatable(L, eventProxyTypeName);
+	lua_setmetatable(L, -2);
+
+	lua_pushlightuserdata(L, proxy);
+	lua_pushvalue(L, -2);
+	lua_rawset(L, LUA_REGISTRYINDEX);
+	return proxy;
+}
+
+
+// A proxy is never reused, one kept past its handler stays cleared and raises an error on any later access.
+void kaleidoscope::luarelease_eventproxy(lua_State* L, const Event** proxy)
+{
+	*proxy = NULL;
+
+	lua_pushlightuserdata(L, proxy);
+	lua_pushnil(L);
+	lua_rawset(L, LUA_REGISTRYINDEX);
+}
+
+
+const kaleidoscope::Event* kaleidoscope::luacheck_event(lua_State* L, int arg)
+{
+	return checkevent(L, arg);
 }
\ No newline at end of file
@@ -4,5 +4,20 @@ struct lua_State;
 
 namespace kaleidoscope
 {
+	class Event;
+
 	extern int luaopen_event(lua_State* L);
+
+	// Events own heap memory once they outgrow their inline buffer, so event userdata must be created here
+	//	to be copy constructed in place and freed by __gc.
+	extern Event* luapush_event(lua_State* L, const Event& e);
+
+	// Handlers are passed a read only proxy that points at the event being dispatched instead of a copy.
+	// luapush_eventproxy pushes a new proxy pointed at e, hand it to luarelease_eventproxy once the handler returns.
+	//	Released proxies point at nothing, so one kept by the script raises an error rather than reading a later event.
+	extern const Event** luapush_eventproxy(lua_State* L, const Event& e);
+	extern void luarelease_eventproxy(lua_State* L, const Event** proxy);
+
+	// Returns the event at arg, which may be an event or the proxy.
+	extern const Event* luacheck_event(lua_State* L, int arg);
 }
\ No newline at end of file
@@ -8,6 +8,7 @@
 #include <GameObject/GameObjectHandle.h>
 #include <Components/LuaScript/LuaScriptHandle.h>
 #include <Event/Event.h>
+#include <LuaLibs/Event/EventLibLua.h>
 #include <Components/Transform/TransformHandle.h>
 #include <GameObject/GameObject.h>
 #include <Components/Renderable/Renderable.h>
@@ -20,12 +21,7 @@
 #include <Debug/Logging/SDLLogManager.h>
 extern kaleidoscope::SDLLogManager gLogManager;
 
-extern "C"
-{
-#include <lua.h>
-#include <lualib.h>
-#include <lauxlib.h>
-}
+#include <LuaLibs/Utility/lua_compat.h>
 
 static const char * transformHandleTypeName = "kaleidoscope.transformHandle";
 static const char * luaScriptHandleTypeName = "kaleidoscope.LUAScriptHandle";
@@ -79,15 +75,12 @@ static GameObjectHandle* getGameObjectHandle(lua_State* L, U32 index)
 
 static Event* newEvent(lua_State* L)
 {
-	Event* n = static_cast<Event*>(lua_newuserdata(L, sizeof(Event)));
-	luaL_getmetatable(L, eventTypeName);
-	lua_setmetatable(L, -2);
-	return n;
+	return kaleidoscope::luapush_event(L, Event());
 }
 
-static Event* getEvent(lua_State* L, U32 index)
+static const Event* getEvent(lua_State* L, U32 index)
 {
-	return static_cast<Event*>(luaL_checkudata(L, index, eventTypeName));
+	return kaleidoscope::luacheck_event(L, index);
 }
 
 static kaleidoscope::StringID getstringid(lua_State* L, U32 index)
@@ -134,14 +127,14 @@ static int lua_godestroy(lua_State* L)
 static int lua_gosendevent(lua_State* L)
 {
 	GameObjectHandle* goh = getGameObjectHandle(L, 1);
-	Event* e = getEvent(L, 2);
+	const Event* e = getEvent(L, 2);
 	kaleidoscope::GameObject::SendEvent(*goh, *e);
 	return 0;
 }
 
 static int lua_gobroadcastevent(lua_State* L)
 {
-	Event* e = getEvent(L, 1);
+	const Event* e = getEvent(L, 1);
 	kaleidoscope::GameObject::BroadcastEvent(*e);
 	return 0;
 }
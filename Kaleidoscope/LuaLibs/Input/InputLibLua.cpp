@@ -9,12 +9,7 @@ extern kaleidoscope::HIDManager gHIDManager;
 
 #include <LuaLibs/Utility/stackDumpLua.h>
 
-extern "C"
-{
-#include <lua.h>
-#include <lualib.h>
-#include <lauxlib.h>
-}
+#include <LuaLibs/Utility/lua_compat.h>
 
 static int lua_setMousePosition(lua_State* L)
 {
@@ -5,12 +5,7 @@
 
 #include <Math/Math.h>
 
-extern "C"
-{
-#include <lua.h>
-#include <lualib.h>
-#include <lauxlib.h>
-}
+#include <LuaLibs/Utility/lua_compat.h>
 
 #include <LuaLibs/Utility/lua_getters.h>
 #include <LuaLibs/Utility/lua_old_typenames.h>
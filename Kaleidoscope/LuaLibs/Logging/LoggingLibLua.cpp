@@ -5,12 +5,7 @@
 #include <Utility/Typedefs.h>
 #include <Utility/StringID/StringId.h>
 
-extern "C"
-{
-#include <lua.h>
-#include <lualib.h>
-#include <lauxlib.h>
-}
+#include <LuaLibs/Utility/lua_compat.h>
 
 static int lua_format(lua_State* L)
 {
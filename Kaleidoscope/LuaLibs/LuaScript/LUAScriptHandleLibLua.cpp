@@ -3,6 +3,7 @@
 #include <Components/LuaScript/LuaScriptHandle.h>
 #include <GameObject/GameObjectHandle.h>
 #include <Event/Event.h>
+#include <LuaLibs/Event/EventLibLua.h>
 #include <Components/LuaScript/LuaScript.h>
 
 #include <Utility/Typedefs.h>
@@ -10,12 +11,9 @@
 
 #include <Math/Math.h>
 
-extern "C"
-{
-#include <lua.h>
-#include <lualib.h>
-#include <lauxlib.h>
-}
+#include <LuaLibs/Utility/lua_compat.h>
+
+#include <cmath>
 
 using kaleidoscope::LuaScriptHandle;
 using kaleidoscope::StringID;
@@ -63,15 +61,12 @@ static GameObjectHandle* getGameObjectHandle(lua_State* L, U32 index)
 
 static Event* newEvent(lua_State* L)
 {
-	Event* n = static_cast<Event*>(lua_newuserdata(L, sizeof(Event)));
-	luaL_getmetatable(L, eventTypeName);
-	lua_setmetatable(L, -2);
-	return n;
+	return kaleidoscope::luapush_event(L, Event());
 }
 
-static Event* getEvent(lua_State* L, U32 index)
+static const Event* getEvent(lua_State* L, U32 index)
 {
-	return static_cast<Event*>(luaL_checkudata(L, index, eventTypeName));
+	return kaleidoscope::luacheck_event(L, index);
 }
 
 static vec3* newvec3(lua_State* L)
@@ -160,6 +155,30 @@ static int lua_lhenable(lua_State* L)
 	return 0;
 }
 
+// lh:setUpdateRate(string mode, number value)
+static int lua_lhsetupdaterate(lua_State* L)
+{
+	LuaScriptHandle* lh = getLUAScriptHandle(L, 1);
+	LuaScriptHandle::UpdateRate rate;
+	if (!LuaScriptHandle::UpdateRateFromString(luaL_checkstring(L, 2), rate))
+	{
+		return luaL_argerror(L, 2, "expected \"every frame\", \"frames\", \"hz\", \"event\" or \"distance\"");
+	}
+	lua_Number value = luaL_optnumber(L, 3, 0);
+	luaL_argcheck(L, value >= 0 && value < HUGE_VAL, 3, "the update rate value must be a finite non-negative number");
+	lh->setUpdateRate(rate, static_cast<F32>(value));
+	return 0;
+}
+
+// string mode, number value = lh:getUpdateRate()
+static int lua_lhgetupdaterate(lua_State* L)
+{
+	LuaScriptHandle* lh = getLUAScriptHandle(L, 1);
+	lua_pushstring(L, LuaScriptHandle::UpdateRateToString(lh->getUpdateRate()));
+	lua_pushnumber(L, lh->getUpdateRateValue());
+	return 2;
+}
+
 static int lua_lhdisable(lua_State* L)
 {
 	LuaScriptHandle* lh = getLUAScriptHandle(L, 1);
@@ -375,6 +394,8 @@ static const struct luaL_Reg luascripthandle_mf[] =
 	{ "isEnabled", lua_lhenabled },
 	{ "enable", lua_lhenable },
 	{ "disable", lua_lhdisable },
+	{ "setUpdateRate", lua_lhsetupdaterate },
+	{ "getUpdateRate", lua_lhgetupdaterate },
 	{ "getFileName", lua_lhgetfilename },
 	{ "getGlobalNumber", lua_lhgetglobalnumber },
 	{ "getGlobalBool", lua_lhgetglobalbool },
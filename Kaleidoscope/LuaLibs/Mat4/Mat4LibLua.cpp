@@ -5,12 +5,9 @@
 
 #include <cstring>
 
-extern "C"
-{
-#include <lua.h>
-#include <lualib.h>
-#include <lauxlib.h>
-}
+#include <LuaLibs/Utility/lua_compat.h>
+#include <LuaLibs/Utility/lua_getters.h>
+#include <LuaLibs/Utility/lua_mathops.h>
 
 static const char * mat4TypeName = "kaleidoscope.mat4";
 static const char * vec4TypeName = "kaleidoscope.vec4";
@@ -427,9 +424,181 @@ static int lua_mat4equal(lua_State* L)
 }
 
 
+static int lua_mat4assign(lua_State* L)
+{
+	mat4* m = static_cast<mat4*>(luaL_checkudata(L, 1, mat4TypeName));
+	*m = *static_cast<mat4*>(luaL_checkudata(L, 2, mat4TypeName));
+	lua_settop(L, 1);
+	return 1;
+}
+
+
+static int lua_mat4identity(lua_State* L)
+{
+	mat4* m = static_cast<mat4*>(luaL_checkudata(L, 1, mat4TypeName));
+	*m = mat4();
+	lua_settop(L, 1);
+	return 1;
+}
+
+
+// m:opInPlace(rhs), rhs is a mat4 or a number. Returns m so calls can be chained.
+template <class Op>
+static int lua_mat4opinplace(lua_State* L)
+{
+	mat4* m = static_cast<mat4*>(luaL_checkudata(L, 1, mat4TypeName));
+	if (lua_type(L, 2) == LUA_TNUMBER)
+	{
+		Op::apply(*m, static_cast<F32>(lua_tonumber(L, 2)));
+	}
+	else
+	{
+		Op::apply(*m, *static_cast<mat4*>(luaL_checkudata(L, 2, mat4TypeName)));
+	}
+	lua_settop(L, 1);
+	return 1;
+}
+
+
+static int lua_mat4transposeinplace(lua_State* L)
+{
+	mat4* m = static_cast<mat4*>(luaL_checkudata(L, 1, mat4TypeName));
+	*m = kaleidoscope::math::transpose(*m);
+	lua_settop(L, 1);
+	return 1;
+}
+
+
+static int lua_mat4inverseinplace(lua_State* L)
+{
+	mat4* m = static_cast<mat4*>(luaL_checkudata(L, 1, mat4TypeName));
+	*m = kaleidoscope::math::inverse(*m);
+	lua_settop(L, 1);
+	return 1;
+}
+
+
+// mat4.op(lhs, rhs, out), rhs is a mat4 or a number. The result goes into out, or a new mat4 when out is nil.
+template <class Op>
+static int lua_mat4opout(lua_State* L)
+{
+	mat4 result = *static_cast<mat4*>(luaL_checkudata(L, 1, mat4TypeName));
+	if (lua_type(L, 2) == LUA_TNUMBER)
+	{
+		Op::apply(result, static_cast<F32>(lua_tonumber(L, 2)));
+	}
+	else
+	{
+		Op::apply(result, *static_cast<mat4*>(luaL_checkudata(L, 2, mat4TypeName)));
+	}
+	*outudata<mat4>(L, mat4TypeName, 3) = result;
+	return 1;
+}
+
+
+// mat4.mul(lhs, rhs, out) also takes a vec4 as rhs, the result is then a vec4.
+static int lua_mat4mulout(lua_State* L)
+{
+	if (vec4* v = static_cast<vec4*>(luaL_testudata(L, 2, vec4TypeName)))
+	{
+		mat4* m = static_cast<mat4*>(luaL_checkudata(L, 1, mat4TypeName));
+		vec4 result = (*m) * (*v);
+		*outudata<vec4>(L, vec4TypeName, 3) = result;
+		return 1;
+	}
+	return lua_mat4opout<MulOp>(L);
+}
+
+
+static int lua_mat4transpose(lua_State* L)
+{
+	mat4* m = static_cast<mat4*>(luaL_checkudata(L, 1, mat4TypeName));
+	mat4 result = kaleidoscope::math::transpose(*m);
+	*outudata<mat4>(L, mat4TypeName, 2) = result;
+	return 1;
+}
+
+
+static int lua_mat4inverse(lua_State* L)
+{
+	mat4* m = static_cast<mat4*>(luaL_checkudata(L, 1, mat4TypeName));
+	mat4 result = kaleidoscope::math::inverse(*m);
+	*outudata<mat4>(L, mat4TypeName, 2) = result;
+	return 1;
+}
+
+
+// mat4.batchTransform(m, vs, out), multiplies every vec4 in the array vs by m.
+static int lua_mat4batchtransform(lua_State* L)
+{
+	const mat4 m = *static_cast<mat4*>(luaL_checkudata(L, 1, mat4TypeName));
+	const I32 count = checkbatch(L, 2, 4);
+	const int out = outbatch(L, 3, count * 4);
+
+	for (I32 i = 0; i < count; ++i)
+	{
+		F32 c[4];
+		readbatch(L, 2, i, 4, c);
+		const vec4 v = m * vec4(c[0], c[1], c[2], c[3]);
+		c[0] = v.x;
+		c[1] = v.y;
+		c[2] = v.z;
+		c[3] = v.w;
+		writebatch(L, out, i, 4, c);
+	}
+
+	lua_pushvalue(L, out);
+	return 1;
+}
+
+
+// Transforms an array of vec3s with the given w, 1 for points and 0 for directions. There is no divide by w.
+static int mat4batchtransform3(lua_State* L, F32 w)
+{
+	const mat4 m = *static_cast<mat4*>(luaL_checkudata(L, 1, mat4TypeName));
+	const I32 count = checkbatch(L, 2, 3);
+	const int out = outbatch(L, 3, count * 3);
+
+	for (I32 i = 0; i < count; ++i)
+	{
+		F32 c[3];
+		readbatch(L, 2, i, 3, c);
+		const vec4 v = m * vec4(c[0], c[1], c[2], w);
+		c[0] = v.x;
+		c[1] = v.y;
+		c[2] = v.z;
+		writebatch(L, out, i, 3, c);
+	}
+
+	lua_pushvalue(L, out);
+	return 1;
+}
+
+
+static int lua_mat4batchtransformpoints(lua_State* L)
+{
+	return mat4batchtransform3(L, 1.0f);
+}
+
+
+static int lua_mat4batchtransformdirections(lua_State* L)
+{
+	return mat4batchtransform3(L, 0.0f);
+}
+
+
 static const struct luaL_Reg mat4_sf[] =
 {
 	{ "new", lua_newmat4 },
+	{ "add", lua_mat4opout<AddOp> },
+	{ "sub", lua_mat4opout<SubOp> },
+	{ "mul", lua_mat4mulout },
+	{ "div", lua_mat4opout<DivOp> },
+	{ "transpose", lua_mat4transpose },
+	{ "inverse", lua_mat4inverse },
+	{ "batchTransform", lua_mat4batchtransform },
+	{ "batchTransformPoints", lua_mat4batchtransformpoints },
+	{ "batchTransformDirections", lua_mat4batchtransformdirections },
 	{ NULL, NULL }
 };
 
@@ -444,6 +613,14 @@ static const struct luaL_Reg mat4_mf[] =
 	{ "__div", lua_mat4div },
 	{ "__unm", lua_mat4unm },
 	{ "__eq", lua_mat4equal },
+	{ "assign", lua_mat4assign },
+	{ "identity", lua_mat4identity },
+	{ "addInPlace", lua_mat4opinplace<AddOp> },
+	{ "subInPlace", lua_mat4opinplace<SubOp> },
+	{ "mulInPlace", lua_mat4opinplace<MulOp> },
+	{ "divInPlace", lua_mat4opinplace<DivOp> },
+	{ "transposeInPlace", lua_mat4transposeinplace },
+	{ "inverseInPlace", lua_mat4inverseinplace },
 	{ NULL, NULL }
 };
 
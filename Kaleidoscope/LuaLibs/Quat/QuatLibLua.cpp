@@ -5,25 +5,15 @@
 
 #include <cstring>
 
-extern "C"
-{
-#include <lua.h>
-#include <lualib.h>
-#include <lauxlib.h>
-}
+#include <LuaLibs/Utility/lua_compat.h>
+#include <LuaLibs/Utility/lua_getters.h>
+#include <LuaLibs/Utility/lua_mathops.h>
 
 static const char * quatTypeName = "kaleidoscope.quat";
 static const char * vec3TypeName = "kaleidoscope.vec3";
 static const char * vec4TypeName = "kaleidoscope.vec4";
 
 using kaleidoscope::math::vec3;
-static vec3* newvec3(lua_State* L)
-{
-	vec3* n = static_cast<vec3*>(lua_newuserdata(L, sizeof(vec3)));
-	luaL_getmetatable(L, vec3TypeName);
-	lua_setmetatable(L, -2);
-	return n;
-}
 
 using kaleidoscope::math::vec4;
 static vec4* newvec4(lua_State* L)
@@ -48,7 +38,7 @@ static int lua_quatcrossquatandquat(lua_State* L)
 {
 	kaleidoscope::math::quat* v1 = static_cast<kaleidoscope::math::quat*>(luaL_checkudata(L, 1, "kaleidoscope.quat"));
 	kaleidoscope::math::quat* v2 = static_cast<kaleidoscope::math::quat*>(luaL_checkudata(L, 2, "kaleidoscope.quat"));
-	quat* n = newquat(L);
+	quat* n = outudata<quat>(L, quatTypeName, 3);
 	*n = kaleidoscope::math::cross(*v1, *v2);
 	return 1;
 }
@@ -59,7 +49,7 @@ static int lua_quatcrossquatandvec3(lua_State* L)
 {
 	quat* v1 = static_cast<quat*>(luaL_checkudata(L, 1, "kaleidoscope.quat"));
 	vec3* v2 = static_cast<vec3*>(luaL_checkudata(L, 2, "kaleidoscope.vec3"));
-	vec3* n = newvec3(L);
+	vec3* n = outudata<vec3>(L, vec3TypeName, 3);
 	*n = kaleidoscope::math::cross(*v1, *v2);
 	return 1;
 }
@@ -82,7 +72,7 @@ static int lua_quatcross(lua_State* L)
 static int lua_quatnormalize(lua_State* L)
 {
 	quat* v1 = static_cast<quat*>(luaL_checkudata(L, 1, "kaleidoscope.quat"));
-	quat* n = newquat(L);
+	quat* n = outudata<quat>(L, quatTypeName, 2);
 	*n = kaleidoscope::math::normalize(*v1);
 	return 1;
 }
@@ -93,7 +83,7 @@ static int lua_quatslerp(lua_State* L)
 	quat* v1 = static_cast<quat*>(luaL_checkudata(L, 1, "kaleidoscope.quat"));
 	quat* v2 = static_cast<quat*>(luaL_checkudata(L, 2, "kaleidoscope.quat"));
 	F32 t = static_cast<F32>(luaL_checknumber(L, 3));
-	quat* n = newquat(L);
+	quat* n = outudata<quat>(L, quatTypeName, 4);
 	*n = kaleidoscope::math::slerp(*v1, *v2, t);
 	return 1;
 }
@@ -104,7 +94,7 @@ static int lua_quatlerp(lua_State* L)
 	quat* v1 = static_cast<quat*>(luaL_checkudata(L, 1, "kaleidoscope.quat"));
 	quat* v2 = static_cast<quat*>(luaL_checkudata(L, 2, "kaleidoscope.quat"));
 	F32 t = static_cast<F32>(luaL_checknumber(L, 3));
-	quat* n = newquat(L);
+	quat* n = outudata<quat>(L, quatTypeName, 4);
 	*n = kaleidoscope::math::lerp(*v1, *v2, t);
 	return 1;
 }
@@ -168,6 +158,12 @@ static int lua_quatindex(lua_State* L)
 		return 1;
 	}
 
+	// Methods are kept in the metatable.
+	if (luaL_getmetafield(L, 1, field))
+	{
+		return 1;
+	}
+
 	return luaL_argerror(L, 2, "not a valid argument");
 }
 
@@ -355,6 +351,193 @@ static int lua_quatequal(lua_State* L)
 }
 
 
+static int lua_quatset(lua_State* L)
+{
+	quat* q = static_cast<quat*>(luaL_checkudata(L, 1, quatTypeName));
+	if (lua_gettop(L) == 2)
+	{
+		*q = *static_cast<quat*>(luaL_checkudata(L, 2, quatTypeName));
+	}
+	else
+	{
+		q->w = static_cast<F32>(luaL_checknumber(L, 2));
+		q->x = static_cast<F32>(luaL_checknumber(L, 3));
+		q->y = static_cast<F32>(luaL_checknumber(L, 4));
+		q->z = static_cast<F32>(luaL_checknumber(L, 5));
+	}
+	lua_settop(L, 1);
+	return 1;
+}
+
+
+// q:mulInPlace(rhs), rhs is a quat or a number. Returns q so calls can be chained.
+static int lua_quatmulinplace(lua_State* L)
+{
+	quat* q = static_cast<quat*>(luaL_checkudata(L, 1, quatTypeName));
+	if (lua_type(L, 2) == LUA_TNUMBER)
+	{
+		*q *= static_cast<F32>(lua_tonumber(L, 2));
+	}
+	else
+	{
+		*q *= *static_cast<quat*>(luaL_checkudata(L, 2, quatTypeName));
+	}
+	lua_settop(L, 1);
+	return 1;
+}
+
+
+static int lua_quatnormalizeinplace(lua_State* L)
+{
+	quat* q = static_cast<quat*>(luaL_checkudata(L, 1, quatTypeName));
+	*q = kaleidoscope::math::normalize(*q);
+	lua_settop(L, 1);
+	return 1;
+}
+
+
+static int lua_quatconjugateinplace(lua_State* L)
+{
+	quat* q = static_cast<quat*>(luaL_checkudata(L, 1, quatTypeName));
+	*q = kaleidoscope::math::conjugate(*q);
+	lua_settop(L, 1);
+	return 1;
+}
+
+
+static int lua_quatinverseinplace(lua_State* L)
+{
+	quat* q = static_cast<quat*>(luaL_checkudata(L, 1, quatTypeName));
+	*q = kaleidoscope::math::inverse(*q);
+	lua_settop(L, 1);
+	return 1;
+}
+
+
+static int lua_quatslerpinplace(lua_State* L)
+{
+	quat* q = static_cast<quat*>(luaL_checkudata(L, 1, quatTypeName));
+	quat* to = static_cast<quat*>(luaL_checkudata(L, 2, quatTypeName));
+	F32 t = static_cast<F32>(luaL_checknumber(L, 3));
+	*q = kaleidoscope::math::slerp(*q, *to, t);
+	lua_settop(L, 1);
+	return 1;
+}
+
+
+// quat.mul(lhs, rhs, out). The result goes into out, or a new quat when out is nil.
+static int lua_quatmulout(lua_State* L)
+{
+	quat* lhs = static_cast<quat*>(luaL_checkudata(L, 1, quatTypeName));
+	quat* rhs = static_cast<quat*>(luaL_checkudata(L, 2, quatTypeName));
+	quat result = (*lhs) * (*rhs);
+	*outudata<quat>(L, quatTypeName, 3) = result;
+	return 1;
+}
+
+
+// quat.rotate(q, v, out), rotates the vec3 v by q.
+static int lua_quatrotate(lua_State* L)
+{
+	quat* q = static_cast<quat*>(luaL_checkudata(L, 1, quatTypeName));
+	vec3* v = static_cast<vec3*>(luaL_checkudata(L, 2, vec3TypeName));
+	vec3 result = (*q) * (*v);
+	*outudata<vec3>(L, vec3TypeName, 3) = result;
+	return 1;
+}
+
+
+// Batched quats are stored w, x, y, z like the constructor takes them.
+static quat readquat(lua_State* L, int arg, I32 i)
+{
+	F32 c[4];
+	readbatch(L, arg, i, 4, c);
+	return quat(c[0], c[1], c[2], c[3]);
+}
+
+
+static void writequat(lua_State* L, int arg, I32 i, const quat& q)
+{
+	const F32 c[4] = { q.w, q.x, q.y, q.z };
+	writebatch(L, arg, i, 4, c);
+}
+
+
+// quat.batchRotate(q, vs, out), rotates every vec3 in the array vs by q.
+static int lua_quatbatchrotate(lua_State* L)
+{
+	const quat q = *static_cast<quat*>(luaL_checkudata(L, 1, quatTypeName));
+	const I32 count = checkbatch(L, 2, 3);
+	const int out = outbatch(L, 3, count * 3);
+
+	for (I32 i = 0; i < count; ++i)
+	{
+		F32 c[3];
+		readbatch(L, 2, i, 3, c);
+		const vec3 v = q * vec3(c[0], c[1], c[2]);
+		c[0] = v.x;
+		c[1] = v.y;
+		c[2] = v.z;
+		writebatch(L, out, i, 3, c);
+	}
+
+	lua_pushvalue(L, out);
+	return 1;
+}
+
+
+// quat.batchMul(lhs, rhs, out), lhs is an array of quats and rhs an array of the same length or a quat.
+static int lua_quatbatchmul(lua_State* L)
+{
+	const I32 count = checkbatch(L, 1, 4);
+	const bool rhsArray = lua_istable(L, 2);
+	luaL_argcheck(L, (!rhsArray || checkbatch(L, 2, 4) >= count), 2, "array is shorter than the first");
+	const quat rhs = (rhsArray ? quat() : *static_cast<quat*>(luaL_checkudata(L, 2, quatTypeName)));
+	const int out = outbatch(L, 3, count * 4);
+
+	for (I32 i = 0; i < count; ++i)
+	{
+		writequat(L, out, i, readquat(L, 1, i) * (rhsArray ? readquat(L, 2, i) : rhs));
+	}
+
+	lua_pushvalue(L, out);
+	return 1;
+}
+
+
+static int lua_quatbatchnormalize(lua_State* L)
+{
+	const I32 count = checkbatch(L, 1, 4);
+	const int out = outbatch(L, 2, count * 4);
+
+	for (I32 i = 0; i < count; ++i)
+	{
+		writequat(L, out, i, kaleidoscope::math::normalize(readquat(L, 1, i)));
+	}
+
+	lua_pushvalue(L, out);
+	return 1;
+}
+
+
+// quat.batchSlerp(from, to, t, out), slerps each pair of quats in the arrays from and to by t.
+static int lua_quatbatchslerp(lua_State* L)
+{
+	const I32 count = checkbatch(L, 1, 4);
+	luaL_argcheck(L, checkbatch(L, 2, 4) >= count, 2, "array is shorter than the first");
+	const F32 t = static_cast<F32>(luaL_checknumber(L, 3));
+	const int out = outbatch(L, 4, count * 4);
+
+	for (I32 i = 0; i < count; ++i)
+	{
+		writequat(L, out, i, kaleidoscope::math::slerp(readquat(L, 1, i), readquat(L, 2, i), t));
+	}
+
+	lua_pushvalue(L, out);
+	return 1;
+}
+
+
 static const struct luaL_Reg quat_sf[] =
 {
 	{ "new", lua_newquat },
@@ -362,6 +545,12 @@ static const struct luaL_Reg quat_sf[] =
 	{ "normalize", lua_quatnormalize },
 	{ "slerp", lua_quatslerp },
 	{ "lerp", lua_quatlerp },
+	{ "mul", lua_quatmulout },
+	{ "rotate", lua_quatrotate },
+	{ "batchRotate", lua_quatbatchrotate },
+	{ "batchMul", lua_quatbatchmul },
+	{ "batchNormalize", lua_quatbatchnormalize },
+	{ "batchSlerp", lua_quatbatchslerp },
 	{ NULL, NULL }
 };
 
@@ -376,6 +565,12 @@ static const struct luaL_Reg quat_mf[] =
 	{ "__unm", lua_quatunm },
 	{ "__pow", lua_quatpow },
 	{ "__eq", lua_quatequal },
+	{ "set", lua_quatset },
+	{ "mulInPlace", lua_quatmulinplace },
+	{ "normalizeInPlace", lua_quatnormalizeinplace },
+	{ "conjugateInPlace", lua_quatconjugateinplace },
+	{ "inverseInPlace", lua_quatinverseinplace },
+	{ "slerpInPlace", lua_quatslerpinplace },
 	{ NULL, NULL }
 };
 
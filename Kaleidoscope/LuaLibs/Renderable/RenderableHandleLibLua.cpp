@@ -5,12 +5,7 @@
 
 #include <Math/Math.h>
 
-extern "C"
-{
-#include <lua.h>
-#include <lualib.h>
-#include <lauxlib.h>
-}
+#include <LuaLibs/Utility/lua_compat.h>
 
 #include <LuaLibs/Utility/lua_getters.h>
 #include <LuaLibs/Utility/lua_old_typenames.h>
@@ -83,6 +78,13 @@ static int lua_rh_makeInvisible(lua_State* L)
 	return 0;
 }
 
+static int lua_rh_loading(lua_State* L)
+{
+	RenderableHandle* rh = getudata<RenderableHandle>(L, RenderableHandle::LUA_TYPE_NAME, 1);
+	lua_pushboolean(L, rh->loading());
+	return 1;
+}
+
 static int lua_rh_numMaterials(lua_State* L)
 {
 	RenderableHandle* rh = getudata<RenderableHandle>(L, RenderableHandle::LUA_TYPE_NAME, 1);
@@ -216,6 +218,7 @@ static const struct luaL_Reg renderableHandle_mf[] =
 	{ "isEnabled", lua_rh_visible },
 	{ "enable", lua_rh_makeVisible },
 	{ "disable", lua_rh_makeInvisible },
+	{ "loading", lua_rh_loading },
 	{ "numMaterials", lua_rh_numMaterials },
 	{ "setMaterialShader", lua_rh_setMaterialShader },
 	{ "getMaterialShader", lua_rh_getMaterialShader },
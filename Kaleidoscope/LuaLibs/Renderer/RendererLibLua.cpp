@@ -5,12 +5,7 @@
 
 #include <Math/Math.h>
 
-extern "C"
-{
-#include <lua.h>
-#include <lualib.h>
-#include <lauxlib.h>
-}
+#include <LuaLibs/Utility/lua_compat.h>
 
 // #include "lua_getters.h"
 // #include "lua_old_typenames.h"
@@ -52,6 +47,61 @@ static int lua_kRenderer_getScreenDimensions(lua_State* L)
 	return 2;
 }
 
+static int lua_kRenderer_isHeadless(lua_State* L)
+{
+	lua_pushboolean(L, gRenderManager.isHeadless());
+	return 1;
+}
+
+static int lua_kRenderer_captureFrame(lua_State* L)
+{
+	const char * path = luaL_checkstring(L, 1);
+	lua_pushboolean(L, gRenderManager.captureFrame(path));
+	return 1;
+}
+
+static int lua_kRenderer_getNumFramesDrawn(lua_State* L)
+{
+	lua_pushnumber(L, static_cast<lua_Number>(gRenderManager.getNumFramesDrawn()));
+	return 1;
+}
+
+static int lua_kRenderer_getLastFrameTime(lua_State* L)
+{
+	lua_pushnumber(L, gRenderManager.getLastFrameTime());
+	return 1;
+}
+
+static int lua_kRenderer_getAverageFrameTime(lua_State* L)
+{
+	lua_pushnumber(L, gRenderManager.getAverageFrameTime());
+	return 1;
+}
+
+static int lua_kRenderer_getNumSubmittedNodes(lua_State* L)
+{
+	lua_pushnumber(L, static_cast<lua_Number>(gRenderManager.getNumSubmittedNodes()));
+	return 1;
+}
+
+static int lua_kRenderer_getNumCulledNodes(lua_State* L)
+{
+	lua_pushnumber(L, static_cast<lua_Number>(gRenderManager.getNumCulledNodes()));
+	return 1;
+}
+
+static int lua_kRenderer_resetFrameStats(lua_State* L)
+{
+	gRenderManager.resetFrameStats();
+	return 0;
+}
+
+static int lua_kRenderer_printFrameStats(lua_State* L)
+{
+	gRenderManager.printFrameStats();
+	return 0;
+}
+
 static int lua_kRenderer_enableLighting(lua_State* L)
 {
 	gRenderManager.enableLighting();
@@ -70,14 +120,114 @@ static int lua_kRenderer_isLightingEnabled(lua_State* L)
 	return 1;
 }
 
+static int lua_kRenderer_getResidentMeshBytes(lua_State* L)
+{
+	lua_pushnumber(L, static_cast<lua_Number>(gRenderManager.getResidentMeshBytes()));
+	return 1;
+}
+
+static int lua_kRenderer_printMeshCache(lua_State* L)
+{
+	gRenderManager.printMeshCache();
+	return 0;
+}
+
+static int lua_kRenderer_getNumPendingLoads(lua_State* L)
+{
+	lua_pushnumber(L, static_cast<lua_Number>(gRenderManager.getNumPendingLoads()));
+	return 1;
+}
+
+static int lua_kRenderer_getResidentTextureBytes(lua_State* L)
+{
+	lua_pushnumber(L, static_cast<lua_Number>(gRenderManager.getResidentTextureBytes()));
+	return 1;
+}
+
+static int lua_kRenderer_purgeUnreferencedAssets(lua_State* L)
+{
+	lua_pushnumber(L, static_cast<lua_Number>(gRenderManager.purgeUnreferencedAssets()));
+	return 1;
+}
+
+static int lua_kRenderer_printResidency(lua_State* L)
+{
+	gRenderManager.printResidency();
+	return 0;
+}
+
+static int lua_kRenderer_getNumDrawCalls(lua_State* L)
+{
+	lua_pushnumber(L, static_cast<lua_Number>(gRenderManager.getNumDrawCalls()));
+	return 1;
+}
+
+static int lua_kRenderer_getNumMaterialSwitches(lua_State* L)
+{
+	lua_pushnumber(L, static_cast<lua_Number>(gRenderManager.getNumMaterialSwitches()));
+	return 1;
+}
+
+static int lua_kRenderer_printRenderStats(lua_State* L)
+{
+	gRenderManager.printRenderStats();
+	return 0;
+}
+
+static int lua_kRenderer_getNumInstanceGroups(lua_State* L)
+{
+	lua_pushnumber(L, static_cast<lua_Number>(gRenderManager.getNumInstanceGroups()));
+	return 1;
+}
+
+static int lua_kRenderer_getNumInstancesDrawn(lua_State* L)
+{
+	lua_pushnumber(L, static_cast<lua_Number>(gRenderManager.getNumInstancesDrawn()));
+	return 1;
+}
+
+static int lua_kRenderer_getNumStaticBatches(lua_State* L)
+{
+	lua_pushnumber(L, static_cast<lua_Number>(gRenderManager.getNumStaticBatches()));
+	return 1;
+}
+
+static int lua_kRenderer_getNumStaticBuffers(lua_State* L)
+{
+	lua_pushnumber(L, static_cast<lua_Number>(gRenderManager.getNumStaticBuffers()));
+	return 1;
+}
+
 static const struct luaL_Reg kRenderer_sf[] =
 {
 	{ "setViewCamera", lua_kRenderer_setViewCamera },
 	{ "getViewCamera", lua_kRenderer_getViewCamera },
 	{ "getScreenDimensions", lua_kRenderer_getScreenDimensions },
+	{ "isHeadless", lua_kRenderer_isHeadless },
+	{ "captureFrame", lua_kRenderer_captureFrame },
+	{ "getNumFramesDrawn", lua_kRenderer_getNumFramesDrawn },
+	{ "getLastFrameTime", lua_kRenderer_getLastFrameTime },
+	{ "getAverageFrameTime", lua_kRenderer_getAverageFrameTime },
+	{ "getNumSubmittedNodes", lua_kRenderer_getNumSubmittedNodes },
+	{ "getNumCulledNodes", lua_kRenderer_getNumCulledNodes },
+	{ "resetFrameStats", lua_kRenderer_resetFrameStats },
+	{ "printFrameStats", lua_kRenderer_printFrameStats },
 	{ "enableLighting", lua_kRenderer_enableLighting },
 	{ "disableLighting", lua_kRenderer_disableLighting },
 	{ "isLightingEnabled", lua_kRenderer_isLightingEnabled },
+	{ "getResidentMeshBytes", lua_kRenderer_getResidentMeshBytes },
+	{ "printMeshCache", lua_kRenderer_printMeshCache },
+	{ "getNumPendingLoads", lua_kRenderer_getNumPendingLoads },
+	{ "getResidentTextureBytes", lua_kRenderer_getResidentTextureBytes },
+	{ "purgeUnreferencedAssets", lua_kRenderer_purgeUnreferencedAssets },
+	{ "printResidency", lua_kRenderer_printResidency },
+	{ "getNumDrawCalls", lua_kRenderer_getNumDrawCalls },
+	{ "getNumMaterialSwitches", lua_kRenderer_getNumMaterialSwitches },
+	{ "printRenderStats", lua_kRenderer_printRenderStats },
+	{ "getNumInstanceGroups", lua_kRenderer_getNumInstanceGroups },
+	{ "getNumInstancesDrawn", lua_kRenderer_getNumInstancesDrawn },
+	{ "getNumStaticBatches", lua_kRenderer_getNumStaticBatches },
+	{ "getNumStaticBuffers", lua_kRenderer_getNumStaticBuffers },
 	{ NULL, NULL }
 };
 
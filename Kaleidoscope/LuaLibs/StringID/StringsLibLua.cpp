@@ -4,12 +4,7 @@
 
 #include <LuaLibs/Utility/stackDumpLua.h>
 
-extern "C"
-{
-#include <lua.h>
-#include <lualib.h>
-#include <lauxlib.h>
-}
+#include <LuaLibs/Utility/lua_compat.h>
 
 static int lua_getString(lua_State* L)
 {
@@ -0,0 +1,126 @@
+#include <LuaLibs/Task/TaskLibLua.h>
+
+#include <Components/LuaScript/LuaScriptHandle.h>
+
+#include <Utility/Typedefs.h>
+#include <Utility/StringID/StringId.h>
+
+#include <LuaLibs/Utility/lua_compat.h>
+
+#include <cmath>
+
+using kaleidoscope::LuaScriptHandle;
+using kaleidoscope::StringID;
+
+static const char * taskOwnerKey = "kaleidoscope.taskowner";
+
+// Yielded first by every kTask wait so user yields of two numbers are not taken for waits.
+static const char taskWaitKey = 0;
+
+static LuaScriptHandle* getTaskOwner(lua_State* L)
+{
+	lua_getfield(L, LUA_REGISTRYINDEX, taskOwnerKey);
+	LuaScriptHandle* owner = static_cast<LuaScriptHandle*>(lua_touserdata(L, -1));
+	lua_pop(L, 1);
+	return owner;
+}
+
+// Hands the wait to the scheduler in LuaScript::resumeTask() as (key, kind, value).
+static int yieldWait(lua_State* L, I32 kind, lua_Number value)
+{
+	if (lua_pushthread(L) == 1)
+	{
+		lua_pop(L, 1);
+		return luaL_error(L, "kTask waits can only be used inside a task started with kTask.start");
+	}
+	lua_pop(L, 1);
+
+	lua_settop(L, 0);
+	lua_pushlightuserdata(L, const_cast<char*>(&taskWaitKey));
+	lua_pushnumber(L, kind);
+	lua_pushnumber(L, value);
+	return lua_yield(L, 3);
+}
+
+// kTask.start(function, ...)
+static int lua_taskstart(lua_State* L)
+{
+	luaL_checktype(L, 1, LUA_TFUNCTION);
+
+	LuaScriptHandle* owner = getTaskOwner(L);
+	if (owner == NULL || !owner->valid())
+	{
+		return luaL_error(L, "kTask.start: the task has no owning script");
+	}
+
+	owner->startTask(L, lua_gettop(L) - 1);
+	return 0;
+}
+
+// kTask.waitSeconds(number)
+static int lua_taskwaitseconds(lua_State* L)
+{
+	lua_Number s = luaL_checknumber(L, 1);
+	luaL_argcheck(L, s >= 0 && s < HUGE_VAL, 1, "seconds must be a finite non-negative number");
+	return yieldWait(L, LuaScriptHandle::TASK_WAIT_SECONDS, s);
+}
+
+// kTask.waitFrames(number)
+static int lua_taskwaitframes(lua_State* L)
+{
+	lua_Number f = luaL_checknumber(L, 1);
+	luaL_argcheck(L, f >= 0 && f < 18446744073709551616.0, 1, "frame count must be a non-negative number");
+	return yieldWait(L, LuaScriptHandle::TASK_WAIT_FRAMES, f);
+}
+
+// event = kTask.waitForEvent(string or StringID)
+static int lua_taskwaitforevent(lua_State* L)
+{
+	StringID type;
+	if (lua_type(L, 1) == LUA_TSTRING)
+	{
+		type = kaleidoscope::internString(lua_tostring(L, 1));
+	}
+	else
+	{
+		type = luaL_checkunsigned(L, 1);
+	}
+	return yieldWait(L, LuaScriptHandle::TASK_WAIT_EVENT, type);
+}
+
+static const struct luaL_Reg ktask[] =
+{
+	{ "start", lua_taskstart },
+	{ "waitSeconds", lua_taskwaitseconds },
+	{ "waitFrames", lua_taskwaitframes },
+	{ "waitForEvent", lua_taskwaitforevent },
+	{ NULL, NULL }
+};
+
+
+int kaleidoscope::luaopen_kTask(lua_State* L)
+{
+	luaL_newlib(L, ktask);
+	lua_setglobal(L, "kTask");
+	return 0;
+}
+
+
+void kaleidoscope::luaset_taskowner(lua_State* L, const LuaScriptHandle& owner)
+{
+	LuaScriptHandle* o = static_cast<LuaScriptHandle*>(lua_newuserdata(L, sizeof(LuaScriptHandle)));
+	*o = owner;
+	lua_setfield(L, LUA_REGISTRYINDEX, taskOwnerKey);
+}
+
+
+LuaScriptHandle* kaleidoscope::luaget_taskowner(lua_State* L)
+{
+	return getTaskOwner(L);
+}
+
+
+bool kaleidoscope::luais_taskwait(lua_State* co)
+{
+	return (lua_gettop(co) == 3 && lua_touserdata(co, 1) == &taskWaitKey && lua_type(co, 2) == LUA_TNUMBER && lua_type(co, 3) == LUA_TNUMBER);
+}
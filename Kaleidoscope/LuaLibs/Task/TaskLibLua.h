@@ -0,0 +1,13 @@
+#pragma once
+
+struct lua_State;
+
+namespace kaleidoscope
+{
+	class LuaScriptHandle;
+
+	extern int luaopen_kTask(lua_State* L);
+	extern void luaset_taskowner(lua_State* L, const LuaScriptHandle& owner);
+	extern LuaScriptHandle* luaget_taskowner(lua_State* L); // The script that owns the lua state, NULL if none was set.
+	extern bool luais_taskwait(lua_State* co); // true if the coroutine yielded (key, kind, value) from a kTask wait.
+}
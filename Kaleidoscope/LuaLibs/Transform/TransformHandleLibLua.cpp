@@ -8,12 +8,7 @@
 
 #include <Math/Math.h>
 
-extern "C"
-{
-#include <lua.h>
-#include <lualib.h>
-#include <lauxlib.h>
-}
+#include <LuaLibs/Utility/lua_compat.h>
 
 static const char * transformHandleTypeName = "kaleidoscope.transformHandle";
 static const char * vec3TypeName = "kaleidoscope.vec3";
@@ -0,0 +1,101 @@
+#pragma once
+
+// Include this instead of the lua headers directly.
+//
+// The bindings are written against the Lua 5.2 C API. Defining KALEIDOSCOPE_LUAJIT builds them against LuaJIT
+//	(link lua51 instead of lua52) and fills in the 5.2 functions and macros LuaJIT does not provide.
+// The shims follow the 5.2 implementations so scripts see the same values on both runtimes.
+
+extern "C"
+{
+#include <lua.h>
+#include <lualib.h>
+#include <lauxlib.h>
+#ifdef KALEIDOSCOPE_LUAJIT
+#include <luajit.h>
+#endif
+}
+
+#ifdef KALEIDOSCOPE_LUAJIT
+
+#include <cmath>
+
+typedef unsigned int lua_Unsigned;
+
+#ifndef LUA_OK
+#define LUA_OK 0
+#endif
+
+inline int lua_absindex(lua_State* L, int idx)
+{
+	return (idx > 0 || idx <= LUA_REGISTRYINDEX) ? idx : lua_gettop(L) + idx + 1;
+}
+
+// Lua 5.2 rounds to nearest and wraps modulo 2^32 when converting numbers to unsigned.
+// Numbers the wrap can not be computed for, NaN and magnitudes of 2^63 and up, are argument errors.
+inline lua_Unsigned luaL_checkunsigned(lua_State* L, int arg)
+{
+	const lua_Number n = std::nearbyint(luaL_checknumber(L, arg));
+	luaL_argcheck(L, n >= -9223372036854775808.0 && n < 9223372036854775808.0, arg, "number has no integer representation");
+	return static_cast<lua_Unsigned>(static_cast<long long>(n));
+}
+
+inline size_t lua_rawlen(lua_State* L, int idx)
+{
+	return lua_objlen(L, idx);
+}
+
+inline void lua_pushunsigned(lua_State* L, lua_Unsigned n)
+{
+	lua_pushnumber(L, static_cast<lua_Number>(n));
+}
+
+// LuaJIT 2.1 already ships these two.
+#if !defined(LUAJIT_VERSION_NUM) || LUAJIT_VERSION_NUM < 20100
+inline void luaL_setfuncs(lua_State* L, const luaL_Reg* l, int nup)
+{
+	luaL_checkstack(L, nup, "too many upvalues");
+	for (; l->name != NULL; ++l)
+	{
+		for (int i = 0; i < nup; ++i)
+		{
+			lua_pushvalue(L, -nup);
+		}
+		lua_pushcclosure(L, l->func, nup);
+		lua_setfield(L, -(nup + 2), l->name);
+	}
+	lua_pop(L, nup);
+}
+
+inline void* luaL_testudata(lua_State* L, int ud, const char* tname)
+{
+	void* p = lua_touserdata(L, ud);
+	if (p != NULL && lua_getmetatable(L, ud))
+	{
+		luaL_getmetatable(L, tname);
+		if (!lua_rawequal(L, -1, -2))
+		{
+			p = NULL;
+		}
+		lua_pop(L, 2);
+		return p;
+	}
+	return NULL;
+}
+#endif
+
+#define luaL_newlibtable(L, l) lua_createtable(L, 0, sizeof(l) / sizeof((l)[0]) - 1)
+#define luaL_newlib(L, l) (luaL_newlibtable(L, l), luaL_setfuncs(L, l, 0))
+
+#endif
+
+// lua_resume takes the resuming thread in 5.2 but not in LuaJIT.
+inline int lua_compat_resume(lua_State* L, lua_State* from, int nargs)
+{
+#ifdef KALEIDOSCOPE_LUAJIT
+	static_cast<void>(from);
+	return lua_resume(L, nargs);
+#else
+	return lua_resume(L, from, nargs);
+#endif
+}
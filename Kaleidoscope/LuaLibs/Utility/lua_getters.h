@@ -1,11 +1,6 @@
 #pragma once
 
-extern "C"
-{
-#include <lua.h>
-#include <lualib.h>
-#include <lauxlib.h>
-}
+#include <LuaLibs/Utility/lua_compat.h>
 
 template <class T>
 inline T* newudata(lua_State* L, const char * udataName)
@@ -16,6 +11,20 @@ inline T* newudata(lua_State* L, const char * udataName)
 	return n;
 }
 
+// Returns the userdata at arg for a result to be written into, or a new one when arg is nil.
+// Either way the result is left on top of the stack to be returned.
+template <class T>
+inline T* outudata(lua_State* L, const char * udataName, int arg)
+{
+	if (lua_isnoneornil(L, arg))
+	{
+		return newudata<T>(L, udataName);
+	}
+	T* out = static_cast<T*>(luaL_checkudata(L, arg, udataName));
+	lua_pushvalue(L, arg);
+	return out;
+}
+
 template <class T>
 inline T* getudata(lua_State* L, const char * udataName, U32 index)
 {
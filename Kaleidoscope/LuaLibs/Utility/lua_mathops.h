@@ -0,0 +1,80 @@
+#pragma once
+
+#include <Utility/Typedefs.h>
+
+#include <LuaLibs/Utility/lua_compat.h>
+
+// Helpers shared by the vec3, vec4, quat and mat4 libraries for math that does not allocate a userdata per result.
+//
+// Batch functions work on lua arrays of numbers holding the components of consecutive values,
+//	{ x1, y1, z1, x2, y2, z2, ... } for vec3s, so a whole set of values costs one table instead of a userdata each.
+// The out array is always the last argument, it may be one of the inputs, and a new array is made when it is nil.
+
+struct AddOp
+{
+	template <class T, class U>
+	static void apply(T& lhs, const U& rhs) { lhs += rhs; }
+};
+
+struct SubOp
+{
+	template <class T, class U>
+	static void apply(T& lhs, const U& rhs) { lhs -= rhs; }
+};
+
+struct MulOp
+{
+	template <class T, class U>
+	static void apply(T& lhs, const U& rhs) { lhs *= rhs; }
+};
+
+struct DivOp
+{
+	template <class T, class U>
+	static void apply(T& lhs, const U& rhs) { lhs /= rhs; }
+};
+
+
+// Returns the number of whole values of the given number of components in the array at arg.
+inline I32 checkbatch(lua_State* L, int arg, I32 components)
+{
+	luaL_checktype(L, arg, LUA_TTABLE);
+	return static_cast<I32>(lua_rawlen(L, arg)) / components;
+}
+
+// Returns the index of the out array, making a new array of size numbers when arg is nil.
+inline int outbatch(lua_State* L, int arg, I32 size)
+{
+	if (lua_isnoneornil(L, arg))
+	{
+		lua_settop(L, arg);
+		lua_createtable(L, size, 0);
+		lua_replace(L, arg);
+	}
+	else
+	{
+		luaL_checktype(L, arg, LUA_TTABLE);
+	}
+	return arg;
+}
+
+// Reads the components of value i (0 based) of the array at arg.
+inline void readbatch(lua_State* L, int arg, I32 i, I32 components, F32* values)
+{
+	for (I32 c = 0; c < components; ++c)
+	{
+		lua_rawgeti(L, arg, i * components + c + 1);
+		values[c] = static_cast<F32>(lua_tonumber(L, -1));
+		lua_pop(L, 1);
+	}
+}
+
+// Writes the components of value i (0 based) of the array at arg.
+inline void writebatch(lua_State* L, int arg, I32 i, I32 components, const F32* values)
+{
+	for (I32 c = 0; c < components; ++c)
+	{
+		lua_pushnumber(L, values[c]);
+		lua_rawseti(L, arg, i * components + c + 1);
+	}
+}
@@ -1,11 +1,6 @@
 #pragma once
 
-extern "C"
-{
-#include <lua.h>
-#include <lualib.h>
-#include <lauxlib.h>
-}
+#include <LuaLibs/Utility/lua_compat.h>
 
 
 #include <Debug/Logging/SDLLogManager.h>
@@ -9,12 +9,9 @@
 #include <Debug/Logging/SDLLogManager.h>
 extern kaleidoscope::SDLLogManager gLogManager;
 
-extern "C"
-{
-#include <lua.h>
-#include <lualib.h>
-#include <lauxlib.h>
-}
+#include <LuaLibs/Utility/lua_compat.h>
+#include <LuaLibs/Utility/lua_getters.h>
+#include <LuaLibs/Utility/lua_mathops.h>
 
 static const char * typeName = "kaleidoscope.vec3";
 
@@ -32,7 +29,7 @@ static int lua_vec3crossvec3andvec3(lua_State* L)
 {
 	kaleidoscope::math::vec3* v1 = static_cast<kaleidoscope::math::vec3*>(luaL_checkudata(L, 1, "kaleidoscope.vec3"));
 	kaleidoscope::math::vec3* v2 = static_cast<kaleidoscope::math::vec3*>(luaL_checkudata(L, 2, "kaleidoscope.vec3"));
-	vec3* n = newvec3(L);
+	vec3* n = outudata<vec3>(L, typeName, 3);
 	*n = kaleidoscope::math::cross(*v1, *v2);
 	return 1;
 }
@@ -42,7 +39,7 @@ static int lua_vec3crossvec3andquat(lua_State* L)
 {
 	vec3* v1 = static_cast<vec3*>(luaL_checkudata(L, 1, "kaleidoscope.vec3"));
 	quat* v2 = static_cast<quat*>(luaL_checkudata(L, 2, "kaleidoscope.quat"));
-	vec3* n = newvec3(L);
+	vec3* n = outudata<vec3>(L, typeName, 3);
 	*n = kaleidoscope::math::cross(*v1, *v2);
 	return 1;
 }
@@ -74,7 +71,7 @@ static int lua_vec3dotvec3andvec3(lua_State* L)
 static int lua_vec3normalize(lua_State* L)
 {
 	vec3* v1 = static_cast<vec3*>(luaL_checkudata(L, 1, "kaleidoscope.vec3"));
-	vec3* n = newvec3(L);
+	vec3* n = outudata<vec3>(L, typeName, 2);
 
 	//gLogManager.log("v1 = (%f, %f, %f)", v1->x, v1->y, v1->z);
 
@@ -86,7 +83,7 @@ static int lua_vec3normalize(lua_State* L)
 static int lua_vec3abs(lua_State* L)
 {
 	vec3* v1 = static_cast<vec3*>(luaL_checkudata(L, 1, "kaleidoscope.vec3"));
-	vec3* n = newvec3(L);
+	vec3* n = outudata<vec3>(L, typeName, 2);
 	*n = kaleidoscope::math::abs(*v1);
 	return 1;
 }
@@ -165,6 +162,12 @@ static int lua_vec3index(lua_State* L)
 		return 1;
 	}
 
+	// Methods are kept in the metatable.
+	if (luaL_getmetafield(L, 1, field))
+	{
+		return 1;
+	}
+
 	return luaL_argerror(L, 2, "not a valid argument");
 }
 
@@ -453,6 +456,182 @@ static int lua_vec3equal(lua_State* L)
 }
 
 
+// Numbers stand in for a vec3 with the number in every component.
+static vec3 checkvec3ornumber(lua_State* L, int arg)
+{
+	if (lua_type(L, arg) == LUA_TNUMBER)
+	{
+		return vec3(static_cast<F32>(lua_tonumber(L, arg)));
+	}
+	return *static_cast<vec3*>(luaL_checkudata(L, arg, typeName));
+}
+
+
+static int lua_vec3set(lua_State* L)
+{
+	vec3* v = static_cast<vec3*>(luaL_checkudata(L, 1, typeName));
+	if (lua_gettop(L) == 2)
+	{
+		*v = *static_cast<vec3*>(luaL_checkudata(L, 2, typeName));
+	}
+	else
+	{
+		v->x = static_cast<F32>(luaL_checknumber(L, 2));
+		v->y = static_cast<F32>(luaL_checknumber(L, 3));
+		v->z = static_cast<F32>(luaL_checknumber(L, 4));
+	}
+	lua_settop(L, 1);
+	return 1;
+}
+
+
+// v:opInPlace(rhs), rhs is a vec3 or a number. Returns v so calls can be chained.
+template <class Op>
+static int lua_vec3opinplace(lua_State* L)
+{
+	vec3* v = static_cast<vec3*>(luaL_checkudata(L, 1, typeName));
+	Op::apply(*v, checkvec3ornumber(L, 2));
+	lua_settop(L, 1);
+	return 1;
+}
+
+
+static int lua_vec3negateinplace(lua_State* L)
+{
+	vec3* v = static_cast<vec3*>(luaL_checkudata(L, 1, typeName));
+	*v = -(*v);
+	lua_settop(L, 1);
+	return 1;
+}
+
+
+static int lua_vec3normalizeinplace(lua_State* L)
+{
+	vec3* v = static_cast<vec3*>(luaL_checkudata(L, 1, typeName));
+	*v = kaleidoscope::math::normalize(*v);
+	lua_settop(L, 1);
+	return 1;
+}
+
+
+static int lua_vec3crossinplace(lua_State* L)
+{
+	vec3* v = static_cast<vec3*>(luaL_checkudata(L, 1, typeName));
+	vec3* rhs = static_cast<vec3*>(luaL_checkudata(L, 2, typeName));
+	*v = kaleidoscope::math::cross(*v, *rhs);
+	lua_settop(L, 1);
+	return 1;
+}
+
+
+static int lua_vec3lerpinplace(lua_State* L)
+{
+	vec3* v = static_cast<vec3*>(luaL_checkudata(L, 1, typeName));
+	vec3* to = static_cast<vec3*>(luaL_checkudata(L, 2, typeName));
+	F32 t = static_cast<F32>(luaL_checknumber(L, 3));
+	*v = kaleidoscope::math::mix(*v, *to, t);
+	lua_settop(L, 1);
+	return 1;
+}
+
+
+// vec3.op(lhs, rhs, out), either side may be a number. The result goes into out, or a new vec3 when out is nil.
+template <class Op>
+static int lua_vec3opout(lua_State* L)
+{
+	vec3 result = checkvec3ornumber(L, 1);
+	Op::apply(result, checkvec3ornumber(L, 2));
+	*outudata<vec3>(L, typeName, 3) = result;
+	return 1;
+}
+
+
+static vec3 readvec3(lua_State* L, int arg, I32 i)
+{
+	F32 c[3];
+	readbatch(L, arg, i, 3, c);
+	return vec3(c[0], c[1], c[2]);
+}
+
+
+static void writevec3(lua_State* L, int arg, I32 i, const vec3& v)
+{
+	const F32 c[3] = { v.x, v.y, v.z };
+	writebatch(L, arg, i, 3, c);
+}
+
+
+// vec3.batchOp(lhs, rhs, out), lhs is an array of vec3s and rhs an array of the same length, a vec3 or a number.
+template <class Op>
+static int lua_vec3batchop(lua_State* L)
+{
+	const I32 count = checkbatch(L, 1, 3);
+	const bool rhsArray = lua_istable(L, 2);
+	luaL_argcheck(L, (!rhsArray || checkbatch(L, 2, 3) >= count), 2, "array is shorter than the first");
+	const vec3 rhs = (rhsArray ? vec3() : checkvec3ornumber(L, 2));
+	const int out = outbatch(L, 3, count * 3);
+
+	for (I32 i = 0; i < count; ++i)
+	{
+		vec3 v = readvec3(L, 1, i);
+		Op::apply(v, (rhsArray ? readvec3(L, 2, i) : rhs));
+		writevec3(L, out, i, v);
+	}
+
+	lua_pushvalue(L, out);
+	return 1;
+}
+
+
+static int lua_vec3batchnormalize(lua_State* L)
+{
+	const I32 count = checkbatch(L, 1, 3);
+	const int out = outbatch(L, 2, count * 3);
+
+	for (I32 i = 0; i < count; ++i)
+	{
+		writevec3(L, out, i, kaleidoscope::math::normalize(readvec3(L, 1, i)));
+	}
+
+	lua_pushvalue(L, out);
+	return 1;
+}
+
+
+static int lua_vec3batchcross(lua_State* L)
+{
+	const I32 count = checkbatch(L, 1, 3);
+	luaL_argcheck(L, checkbatch(L, 2, 3) >= count, 2, "array is shorter than the first");
+	const int out = outbatch(L, 3, count * 3);
+
+	for (I32 i = 0; i < count; ++i)
+	{
+		writevec3(L, out, i, kaleidoscope::math::cross(readvec3(L, 1, i), readvec3(L, 2, i)));
+	}
+
+	lua_pushvalue(L, out);
+	return 1;
+}
+
+
+// The out array of batchDot holds one number per vec3.
+static int lua_vec3batchdot(lua_State* L)
+{
+	const I32 count = checkbatch(L, 1, 3);
+	luaL_argcheck(L, checkbatch(L, 2, 3) >= count, 2, "array is shorter than the first");
+	const int out = outbatch(L, 3, count);
+
+	for (I32 i = 0; i < count; ++i)
+	{
+		lua_pushnumber(L, kaleidoscope::math::dot(readvec3(L, 1, i), readvec3(L, 2, i)));
+		lua_rawseti(L, out, i + 1);
+	}
+
+	lua_pushvalue(L, out);
+	return 1;
+}
+
+
 static const struct luaL_Reg vec3_sf[] =
 {
 	{ "new", lua_newvec3 },
@@ -460,6 +639,17 @@ static const struct luaL_Reg vec3_sf[] =
 	{ "dot", lua_vec3dotvec3andvec3 },
 	{ "normalize", lua_vec3normalize },
 	{ "abs", lua_vec3abs },
+	{ "add", lua_vec3opout<AddOp> },
+	{ "sub", lua_vec3opout<SubOp> },
+	{ "mul", lua_vec3opout<MulOp> },
+	{ "div", lua_vec3opout<DivOp> },
+	{ "batchAdd", lua_vec3batchop<AddOp> },
+	{ "batchSub", lua_vec3batchop<SubOp> },
+	{ "batchMul", lua_vec3batchop<MulOp> },
+	{ "batchDiv", lua_vec3batchop<DivOp> },
+	{ "batchNormalize", lua_vec3batchnormalize },
+	{ "batchCross", lua_vec3batchcross },
+	{ "batchDot", lua_vec3batchdot },
 	{ NULL, NULL }
 };
 
@@ -475,6 +665,15 @@ static const struct luaL_Reg vec3_mf[] =
 	{ "__unm", lua_vec3unm },
 	{ "__pow", lua_vec3pow },
 	{ "__eq", lua_vec3equal },
+	{ "set", lua_vec3set },
+	{ "addInPlace", lua_vec3opinplace<AddOp> },
+	{ "subInPlace", lua_vec3opinplace<SubOp> },
+	{ "mulInPlace", lua_vec3opinplace<MulOp> },
+	{ "divInPlace", lua_vec3opinplace<DivOp> },
+	{ "negateInPlace", lua_vec3negateinplace },
+	{ "normalizeInPlace", lua_vec3normalizeinplace },
+	{ "crossInPlace", lua_vec3crossinplace },
+	{ "lerpInPlace", lua_vec3lerpinplace },
 	{ NULL, NULL }
 };
 
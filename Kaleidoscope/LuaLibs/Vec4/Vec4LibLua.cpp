@@ -5,12 +5,9 @@
 
 #include <cstring>
 
-extern "C"
-{
-#include <lua.h>
-#include <lualib.h>
-#include <lauxlib.h>
-}
+#include <LuaLibs/Utility/lua_compat.h>
+#include <LuaLibs/Utility/lua_getters.h>
+#include <LuaLibs/Utility/lua_mathops.h>
 
 static const char * typeName = "kaleidoscope.vec4";
 static const char * mat4TypeName = "kaleidoscope.mat4";
@@ -58,7 +55,7 @@ static int lua_vec4dotvec4andvec4(lua_State* L)
 static int lua_vec4normalize(lua_State* L)
 {
 	vec4* v1 = static_cast<vec4*>(luaL_checkudata(L, 1, "kaleidoscope.vec4"));
-	vec4* n = newvec4(L);
+	vec4* n = outudata<vec4>(L, typeName, 2);
 	*n = kaleidoscope::math::normalize(*v1);
 	return 1;
 }
@@ -67,7 +64,7 @@ static int lua_vec4normalize(lua_State* L)
 static int lua_vec4abs(lua_State* L)
 {
 	vec4* v1 = static_cast<vec4*>(luaL_checkudata(L, 1, "kaleidoscope.vec4"));
-	vec4* n = newvec4(L);
+	vec4* n = outudata<vec4>(L, typeName, 2);
 	*n = kaleidoscope::math::abs(*v1);
 	return 1;
 }
@@ -199,6 +196,12 @@ static int lua_vec4index(lua_State* L)
 		return 1;
 	}
 
+	// Methods are kept in the metatable.
+	if (luaL_getmetafield(L, 1, field))
+	{
+		return 1;
+	}
+
 	return luaL_argerror(L, 2, "not a valid argument");
 }
 
@@ -523,12 +526,194 @@ static int lua_vec4equal(lua_State* L)
 }
 
 
+// Numbers stand in for a vec4 with the number in every component.
+static vec4 checkvec4ornumber(lua_State* L, int arg)
+{
+	if (lua_type(L, arg) == LUA_TNUMBER)
+	{
+		return vec4(static_cast<F32>(lua_tonumber(L, arg)));
+	}
+	return *static_cast<vec4*>(luaL_checkudata(L, arg, typeName));
+}
+
+
+static int lua_vec4set(lua_State* L)
+{
+	vec4* v = static_cast<vec4*>(luaL_checkudata(L, 1, typeName));
+	if (lua_gettop(L) == 2)
+	{
+		*v = *static_cast<vec4*>(luaL_checkudata(L, 2, typeName));
+	}
+	else
+	{
+		v->x = static_cast<F32>(luaL_checknumber(L, 2));
+		v->y = static_cast<F32>(luaL_checknumber(L, 3));
+		v->z = static_cast<F32>(luaL_checknumber(L, 4));
+		v->w = static_cast<F32>(luaL_checknumber(L, 5));
+	}
+	lua_settop(L, 1);
+	return 1;
+}
+
+
+// v:opInPlace(rhs), rhs is a vec4 or a number. Returns v so calls can be chained.
+template <class Op>
+static int lua_vec4opinplace(lua_State* L)
+{
+	vec4* v = static_cast<vec4*>(luaL_checkudata(L, 1, typeName));
+	Op::apply(*v, checkvec4ornumber(L, 2));
+	lua_settop(L, 1);
+	return 1;
+}
+
+
+// Multiplying also takes a mat4 or a quat, matching __mul.
+static int lua_vec4mulinplace(lua_State* L)
+{
+	vec4* v = static_cast<vec4*>(luaL_checkudata(L, 1, typeName));
+	if (mat4* m = static_cast<mat4*>(luaL_testudata(L, 2, mat4TypeName)))
+	{
+		*v = (*v) * (*m);
+	}
+	else if (quat* q = static_cast<quat*>(luaL_testudata(L, 2, quatTypeName)))
+	{
+		*v = (*v) * (*q);
+	}
+	else
+	{
+		*v *= checkvec4ornumber(L, 2);
+	}
+	lua_settop(L, 1);
+	return 1;
+}
+
+
+static int lua_vec4negateinplace(lua_State* L)
+{
+	vec4* v = static_cast<vec4*>(luaL_checkudata(L, 1, typeName));
+	*v = -(*v);
+	lua_settop(L, 1);
+	return 1;
+}
+
+
+static int lua_vec4normalizeinplace(lua_State* L)
+{
+	vec4* v = static_cast<vec4*>(luaL_checkudata(L, 1, typeName));
+	*v = kaleidoscope::math::normalize(*v);
+	lua_settop(L, 1);
+	return 1;
+}
+
+
+static int lua_vec4lerpinplace(lua_State* L)
+{
+	vec4* v = static_cast<vec4*>(luaL_checkudata(L, 1, typeName));
+	vec4* to = static_cast<vec4*>(luaL_checkudata(L, 2, typeName));
+	F32 t = static_cast<F32>(luaL_checknumber(L, 3));
+	*v = kaleidoscope::math::mix(*v, *to, t);
+	lua_settop(L, 1);
+	return 1;
+}
+
+
+// vec4.op(lhs, rhs, out), either side may be a number. The result goes into out, or a new vec4 when out is nil.
+template <class Op>
+static int lua_vec4opout(lua_State* L)
+{
+	vec4 result = checkvec4ornumber(L, 1);
+	Op::apply(result, checkvec4ornumber(L, 2));
+	*outudata<vec4>(L, typeName, 3) = result;
+	return 1;
+}
+
+
+static vec4 readvec4(lua_State* L, int arg, I32 i)
+{
+	F32 c[4];
+	readbatch(L, arg, i, 4, c);
+	return vec4(c[0], c[1], c[2], c[3]);
+}
+
+
+static void writevec4(lua_State* L, int arg, I32 i, const vec4& v)
+{
+	const F32 c[4] = { v.x, v.y, v.z, v.w };
+	writebatch(L, arg, i, 4, c);
+}
+
+
+// vec4.batchOp(lhs, rhs, out), lhs is an array of vec4s and rhs an array of the same length, a vec4 or a number.
+template <class Op>
+static int lua_vec4batchop(lua_State* L)
+{
+	const I32 count = checkbatch(L, 1, 4);
+	const bool rhsArray = lua_istable(L, 2);
+	luaL_argcheck(L, (!rhsArray || checkbatch(L, 2, 4) >= count), 2, "array is shorter than the first");
+	const vec4 rhs = (rhsArray ? vec4() : checkvec4ornumber(L, 2));
+	const int out = outbatch(L, 3, count * 4);
+
+	for (I32 i = 0; i < count; ++i)
+	{
+		vec4 v = readvec4(L, 1, i);
+		Op::apply(v, (rhsArray ? readvec4(L, 2, i) : rhs));
+		writevec4(L, out, i, v);
+	}
+
+	lua_pushvalue(L, out);
+	return 1;
+}
+
+
+static int lua_vec4batchnormalize(lua_State* L)
+{
+	const I32 count = checkbatch(L, 1, 4);
+	const int out = outbatch(L, 2, count * 4);
+
+	for (I32 i = 0; i < count; ++i)
+	{
+		writevec4(L, out, i, kaleidoscope::math::normalize(readvec4(L, 1, i)));
+	}
+
+	lua_pushvalue(L, out);
+	return 1;
+}
+
+
+// The out array of batchDot holds one number per vec4.
+static int lua_vec4batchdot(lua_State* L)
+{
+	const I32 count = checkbatch(L, 1, 4);
+	luaL_argcheck(L, checkbatch(L, 2, 4) >= count, 2, "array is shorter than the first");
+	const int out = outbatch(L, 3, count);
+
+	for (I32 i = 0; i < count; ++i)
+	{
+		lua_pushnumber(L, kaleidoscope::math::dot(readvec4(L, 1, i), readvec4(L, 2, i)));
+		lua_rawseti(L, out, i + 1);
+	}
+
+	lua_pushvalue(L, out);
+	return 1;
+}
+
+
 static const struct luaL_Reg vec4_sf[] = 
 {
 	{ "new", lua_newvec4 },
 	{ "dot", lua_vec4dotvec4andvec4 },
 	{ "normalize", lua_vec4normalize },
 	{ "abs", lua_vec4abs },
+	{ "add", lua_vec4opout<AddOp> },
+	{ "sub", lua_vec4opout<SubOp> },
+	{ "mul", lua_vec4opout<MulOp> },
+	{ "div", lua_vec4opout<DivOp> },
+	{ "batchAdd", lua_vec4batchop<AddOp> },
+	{ "batchSub", lua_vec4batchop<SubOp> },
+	{ "batchMul", lua_vec4batchop<MulOp> },
+	{ "batchDiv", lua_vec4batchop<DivOp> },
+	{ "batchNormalize", lua_vec4batchnormalize },
+	{ "batchDot", lua_vec4batchdot },
 	{ NULL, NULL }
 };
 
@@ -544,6 +729,14 @@ static const struct luaL_Reg vec4_mf[] =
 	{ "__unm", lua_vec4unm },
 	{ "__pow", lua_vec4pow },
 	{ "__eq", lua_vec4equal },
+	{ "set", lua_vec4set },
+	{ "addInPlace", lua_vec4opinplace<AddOp> },
+	{ "subInPlace", lua_vec4opinplace<SubOp> },
+	{ "mulInPlace", lua_vec4mulinplace },
+	{ "divInPlace", lua_vec4opinplace<DivOp> },
+	{ "negateInPlace", lua_vec4negateinplace },
+	{ "normalizeInPlace", lua_vec4normalizeinplace },
+	{ "lerpInPlace", lua_vec4lerpinplace },
 	{ NULL, NULL }
 };
 
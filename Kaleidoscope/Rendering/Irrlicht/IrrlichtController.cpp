@@ -1,258 +1,2027 @@
 #include <Rendering/Irrlicht/IrrlichtController.h>
 
+#include <Utility/StringID/StringId.h>
+
+#include <Debug/Logging/SDLLogManager.h>
+extern kaleidoscope::SDLLogManager gLogManager;
+
+#include <SDL_timer.h>
+
 #include <algorithm>
+#include <cmath>
+#include <cstdio>
+
+namespace kaleidoscope
+{
+
+	/*
+	* kaleidoscope::IrrlichtController::RenderQueueNode
+	*
+	* An empty node the scene manager renders in its solid pass. By then the camera pass has updated the active
+	*	camera for the frame and the light pass has set the lights, so the queue is culled and sorted against
+	*	this frame's view. The opaque items draw there, before anything transparent. The node renders again in
+	*	the transparent pass to draw the transparent items over the finished opaque scene.
+	*/
+	class IrrlichtController::RenderQueueNode : public irr::scene::ISceneNode
+	{
+	public:
+		RenderQueueNode(IrrlichtController* controller, irr::scene::ISceneManager* smgr)
+			: irr::scene::ISceneNode(smgr->getRootSceneNode(), smgr, -1), mController(controller)
+		{
+			setAutomaticCulling(irr::scene::EAC_OFF);
+		}
+
+		virtual void OnRegisterSceneNode()
+		{
+			if (IsVisible)
+			{
+				SceneManager->registerNodeForRendering(this, irr::scene::ESNRP_SOLID);
+				SceneManager->registerNodeForRendering(this, irr::scene::ESNRP_TRANSPARENT);
+			}
+			irr::scene::ISceneNode::OnRegisterSceneNode();
+		}
+
+		virtual void render()
+		{
+			if (SceneManager->getSceneNodeRenderPass() == irr::scene::ESNRP_SOLID)
+			{
+				mController->buildRenderQueue();
+				mController->drawRenderQueue(false);
+			}
+			else
+			{
+				mController->drawRenderQueue(true);
+			}
+		}
+
+		virtual const irr::core::aabbox3d<irr::f32>& getBoundingBox() const { return mBox; }
+
+	private:
+		IrrlichtController* mController;
+		irr::core::aabbox3d<irr::f32> mBox;
+	};
+
+
+	/*
+	* kaleidoscope::IrrlichtController::IrrlichtController()
+	*
+	* Set the defaults for the Irrlicht Controller.
+	*/
+	IrrlichtController::IrrlichtController()
+	{
+		mDevice = NULL;
+		mSmgr = NULL;
+		mDevice = NULL;
+
+		mOpenMeshNodeBlock = 0;
+		mResidentMeshBytes = 0;
+		mResidentTextureBytes = 0;
+		mResidencyBudget = 0;
+		mResidencyFrame = 0;
+		mNumEvictions = 0;
+		mEvictedBytes = 0;
+		mOverBudget = false;
+		mNumInstanceGroups = 0;
+		mNumInstancesDrawn = 0;
+		mStaticChunkSize = 64.0f;
+		mNumStaticBuffers = 0;
+		useRenderQueue = true;
+		mNumDrawCalls = 0;
+		mNumMaterialSwitches = 0;
+		mNumShaderSwitches = 0;
+		mNumTextureSwitches = 0;
+		mNumBufferSwitches = 0;
+		mNextTicket = 0;
+		mOffscreenTarget = NULL;
+		mFixedTimeStep = 0;
+		mNumFramesDrawn = 0;
+		mLastFrameTime = 0.0f;
+		mTotalFrameTime = 0.0;
+		mNumSubmittedNodes = 0;
+		mNumCulledNodes = 0;
+		mCulledThisFrame = 0;
+		mPlaceholderMesh = NULL;
+		mPlaceholderTexture = NULL;
+
+		useMipMaps = DEFAULTMIPMAPS;
+		normalizeNormals = DEFAULTNORMALIZENORMALS;
+		backfaceCulling = DEFAULTBACKFACECULLING;
+		frontfaceCulling = DEFAULTFRONTFACECULLING;
+		antiAliasingMode = DEFAULTANTIALIASING;
+		isFogEnabled = DEFAULTFOG;
+		lighting = DEFAULTLIGHTING;
+		zWriteEnabled = DEFAULTZWRITE;
+	}
+
+
+	IrrlichtController::~IrrlichtController()
+	{
+
+	}
+
+
+	/*
+	* bool kaleidoscope::IrrlichtController::createDevice(irr::SIrrlichtCreationParameters& params)
+	*
+	* In: SIrrlichtCreationParameters& params : parameters to initialize Irrlicht with.
+	* Out: bool : true on success.
+	*			  false on failure.
+	*
+	* Create and initialize all of the state Irrlicht needs.
+	* Should be called on every IrrlichtController created.
+	*/
+	bool IrrlichtController::createDevice(irr::SIrrlichtCreationParameters& params)
+	{
+		mDevice = irr::createDeviceEx(params);
+		if (mDevice == NULL)
+		{
+			return false;
+		}
+		mSmgr = mDevice->getSceneManager();
+		mDriver = mDevice->getVideoDriver();
+
+		mDriver->setTextureCreationFlag(irr::video::ETCF_ALWAYS_32_BIT, true);
+
+		if (Semaphore::Semaphore_init(&useSem, 1) != 0)
+		{
+			return false;
+		}
+
+		if (Semaphore::Semaphore_init(&loadSem, 1) != 0)
+		{
+			return false;
+		}
+
+		if (Semaphore::Semaphore_init(&readSignal, 0) != 0)
+		{
+			return false;
+		}
+
+		// Shown while the real assets load.
+		irr::scene::IMesh* cube = mSmgr->getGeometryCreator()->createCubeMesh();
+		mPlaceholderMesh = mSmgr->getMeshManipulator()->createMeshWithTangents(cube);
+		cube->drop();
+
+		mPlaceholderTexture = mDriver->addTexture(irr::core::dimension2d<irr::u32>(1, 1), "kaleidoscope.placeholder", irr::video::ECF_A8R8G8B8);
+		if (mPlaceholderTexture != NULL)
+		{
+			U32* texel = static_cast<U32*>(mPlaceholderTexture->lock());
+			if (texel != NULL)
+			{
+				*texel = 0xFFFFFFFF;
+				mPlaceholderTexture->unlock();
+			}
+		}
+
+
+		mSmgr->addSkyBoxSceneNode(
+			mDriver->getTexture("media/irrlicht2_up.jpg"),
+			mDriver->getTexture("media/irrlicht2_dn.jpg"),
+			mDriver->getTexture("media/irrlicht2_lf.jpg"),
+			mDriver->getTexture("media/irrlicht2_rt.jpg"),
+			mDriver->getTexture("media/irrlicht2_ft.jpg"),
+			mDriver->getTexture("media/irrlicht2_bk.jpg"));
+
+		mSmgr->addLightSceneNode(NULL, irr::core::vector3df(0, 2, 0));
+
+		// The root node keeps it alive.
+		RenderQueueNode* queueNode = new RenderQueueNode(this, mSmgr);
+		queueNode->drop();
+
+		return true;
+	}
+
+
+	/*
+	* void kaleidoscope::IrrlichtController::closeDevice()
+	*
+	* Release all Irrlicht State.
+	* Must be called before the destructor is called.
+	*/
+	void IrrlichtController::closeDevice()
+	{
+		stopLoader();
+		clearMeshCache();
+
+		// The driver owns the textures and frees them with the device.
+		mTextureCache.clear();
+		mResidentTextureBytes = 0;
+
+		if (mPlaceholderMesh != NULL)
+		{
+			mPlaceholderMesh->drop();
+			mPlaceholderMesh = NULL;
+		}
+		mOffscreenTarget = NULL;
+
+		// The blocks go with the scene.
+		mMeshNodeBlocks.clear();
+		mOpenMeshNodeBlock = 0;
+
+		mDevice->closeDevice();
+		mDevice->drop();
+
+		Semaphore::Semaphore_destroy(&useSem);
+		Semaphore::Semaphore_destroy(&loadSem);
+		Semaphore::Semaphore_destroy(&readSignal);
+	}
+
+	/*
+	* irr::video::ITexture* kaleidoscope::IrrlichtController::getTexture(const irr::io::path& p)
+	*
+	* In: irr::io::path& : The path to the texture file.
+	* Out: irr::video::ITexture* : A pointer to the loaded texture data if the file existed.
+	*							   NULL pointer if the file doesn't exist.
+	*
+	* Textures kept past the call must be held with acquireTexture() or they may be evicted.
+	*/
+	irr::video::ITexture* IrrlichtController::getTexture(const irr::io::path& p)
+	{
+		Semaphore::Semaphore_wait(&useSem);
+		irr::video::ITexture* tex = mDriver->findTexture(p);
+		if (tex == NULL)
+		{
+			tex = mDriver->getTexture(p);
+			trackTexture(tex, p);
+		}
+		Semaphore::Semaphore_post(&useSem);
+		return tex;
+	}
+
+
+	/*
+	* U64 kaleidoscope::textureBytes(irr::video::ITexture* texture)
+	*
+	* In: ITexture* : The texture to measure.
+	* Out: U64 : The size of the texture data including its mip maps.
+	*/
+	static U64 textureBytes(irr::video::ITexture* texture)
+	{
+		U64 bytes = static_cast<U64>(texture->getPitch()) * texture->getSize().Height;
+		if (texture->hasMipMaps())
+		{
+			bytes += bytes / 3;
+		}
+		return bytes;
+	}
+
+
+	/*
+	* U64 kaleidoscope::meshBytes(irr::scene::IMesh* mesh)
+	*
+	* In: IMesh* : The mesh to measure.
+	* Out: U64 : The size of the vertex and index data of every mesh buffer.
+	*/
+	static U64 meshBytes(irr::scene::IMesh* mesh)
+	{
+		U64 bytes = 0;
+		for (U32 i = 0; i < mesh->getMeshBufferCount(); ++i)
+		{
+			irr::scene::IMeshBuffer* mb = mesh->getMeshBuffer(i);
+			bytes += mb->getVertexCount() * irr::video::getVertexPitchFromType(mb->getVertexType());
+			bytes += mb->getIndexCount() * (mb->getIndexType() == irr::video::EIT_16BIT ? sizeof(irr::u16) : sizeof(irr::u32));
+		}
+		return bytes;
+	}
+
+
+	/*
+	* irr::scene::IMesh* kaleidoscope::IrrlichtController::getMesh(const irr::io::path& p)
+	*
+	* In: irr::io::path& : The path to the mesh file.
+	* Out: irr::scene::IMesh* : A pointer to the loaded mesh data if the file existed.
+	*							NULL pointer if the file doesn't exist.
+	*
+	* Meshes are loaded with tangents and the default material flags, then cached and shared by every caller asking
+	*	for the same path. Each mesh returned must be handed back with releaseMesh().
+	*/
+	irr::scene::IMesh* IrrlichtController::getMesh(const irr::io::path& p)
+	{
+		Semaphore::Semaphore_wait(&useSem);
+
+		const U32 options = MESHLOAD;
+		const U64 key = (static_cast<U64>(hashCRC32(p.c_str())) << 32) | options;
+
+		boost::unordered_map<U64, CachedMesh>::iterator cached = mMeshCache.find(key);
+		if (cached != mMeshCache.end())
+		{
+			++cached->second.mRefCount;
+			Semaphore::Semaphore_post(&useSem);
+			return cached->second.mMesh;
+		}
+
+		irr::scene::IAnimatedMesh* mesh = mSmgr->getMesh(p);
+
+		if (mesh == NULL)
+		{
+			Semaphore::Semaphore_post(&useSem);
+			return NULL;
+		}
+
+		irr::scene::IMesh* tanMesh = cacheMesh(mesh, p, key, options, 1);
+
+		Semaphore::Semaphore_post(&useSem);
+		return tanMesh;
+	}
+
+
+	/*
+	* irr::scene::IMesh* kaleidoscope::IrrlichtController::cacheMesh(irr::scene::IAnimatedMesh* mesh, const irr::io::path& p, U64 key, U32 options, U32 refCount)
+	*
+	* In: IAnimatedMesh* : The mesh as loaded from the file.
+	* In: irr::io::path& : The path the mesh was loaded from.
+	* In: U64 : The mesh cache key.
+	* In: U32 : The options the key was made with.
+	* In: U32 : The number of users the mesh starts with.
+	* Out: IMesh* : The processed mesh.
+	*
+	* Builds the tangent mesh with the default material flags and adds it to the mesh cache.
+	* useSem must be held.
+	*/
+	irr::scene::IMesh* IrrlichtController::cacheMesh(irr::scene::IAnimatedMesh* mesh, const irr::io::path& p, U64 key, U32 options, U32 refCount)
+	{
+		irr::scene::IMesh* tanMesh = mSmgr->getMeshManipulator()->createMeshWithTangents(mesh->getMesh(0));
+
+		// The tangent mesh is a full copy, so the source does not need to stay in Irrlicht's cache.
+		mSmgr->getMeshCache()->removeMesh(mesh);
+
+
+		// The toggles that differ from the defaults apply through the override material.
+		tanMesh->setMaterialFlag(irr::video::EMF_USE_MIP_MAPS, DEFAULTMIPMAPS);
+		tanMesh->setMaterialFlag(irr::video::EMF_NORMALIZE_NORMALS, DEFAULTNORMALIZENORMALS);
+		tanMesh->setMaterialFlag(irr::video::EMF_BACK_FACE_CULLING, DEFAULTBACKFACECULLING);
+		tanMesh->setMaterialFlag(irr::video::EMF_FRONT_FACE_CULLING, DEFAULTFRONTFACECULLING);
+		tanMesh->setMaterialFlag(irr::video::EMF_ANTI_ALIASING, static_cast<bool>(DEFAULTANTIALIASING));
+		tanMesh->setMaterialFlag(irr::video::EMF_FOG_ENABLE, DEFAULTFOG);
+		tanMesh->setMaterialFlag(irr::video::EMF_LIGHTING, DEFAULTLIGHTING);
+		tanMesh->setMaterialFlag(irr::video::EMF_ZWRITE_ENABLE, DEFAULTZWRITE);
+		tanMesh->setMaterialFlag(irr::video::EMF_ANISOTROPIC_FILTER, true);
+		tanMesh->setMaterialFlag(irr::video::EMF_TRILINEAR_FILTER, true);
+
+		addToMeshCache(tanMesh, p, key, options, refCount);
+
+		return tanMesh;
+	}
+
+
+	/*
+	* void kaleidoscope::IrrlichtController::addToMeshCache(irr::scene::IMesh* mesh, const irr::io::path& p, U64 key, U32 options, U32 refCount)
+	*
+	* In: IMesh* : The mesh to cache, the cache takes over its reference.
+	* In: irr::io::path& : The path the mesh came from.
+	* In: U64 : The mesh cache key.
+	* In: U32 : The options the key was made with.
+	* In: U32 : The number of users the mesh starts with.
+	* Out: void :
+	*
+	* useSem must be held.
+	*/
+	void IrrlichtController::addToMeshCache(irr::scene::IMesh* mesh, const irr::io::path& p, U64 key, U32 options, U32 refCount)
+	{
+		CachedMesh entry;
+		entry.mMesh = mesh;
+		entry.mPath = p;
+		entry.mOptions = options;
+		entry.mRefCount = refCount;
+		entry.mBytes = meshBytes(mesh);
+		entry.mLastUsed = mResidencyFrame;
+		mMeshCache[key] = entry;
+		mMeshKeys[mesh] = key;
+		mResidentMeshBytes += entry.mBytes;
+	}
+
+
+	/*
+	* irr::scene::IMesh* kaleidoscope::simplifyMesh(irr::scene::IMesh* source, U32 level)
+	*
+	* In: IMesh* : A mesh made of tangent mesh buffers.
+	* In: U32 : The level of simplification, 1 to 3.
+	* Out: IMesh* : The simplified mesh.
+	*				NULL if the mesh has buffers of other vertex types.
+	*
+	* Vertex clustering: the bounding box is cut into 32, 16 or 8 cells per axis and the vertices of every buffer in
+	*	a cell are merged into their average. Triangles that collapse are dropped. Texture seams are not preserved,
+	*	which is fine at the distances the coarser levels are shown from.
+	*/
+	static irr::scene::IMesh* simplifyMesh(irr::scene::IMesh* source, U32 level)
+	{
+		for (U32 b = 0; b < source->getMeshBufferCount(); ++b)
+		{
+			if (source->getMeshBuffer(b)->getVertexType() != irr::video::EVT_TANGENTS || source->getMeshBuffer(b)->getIndexType() != irr::video::EIT_16BIT)
+			{
+				return NULL;
+			}
+		}
+
+		const irr::core::aabbox3df& box = source->getBoundingBox();
+		const F32 cellsPerAxis = static_cast<F32>(64 >> level);
+		irr::core::vector3df cell = box.getExtent() / cellsPerAxis;
+		cell.X = (cell.X > 0.0001f ? cell.X : 0.0001f);
+		cell.Y = (cell.Y > 0.0001f ? cell.Y : 0.0001f);
+		cell.Z = (cell.Z > 0.0001f ? cell.Z : 0.0001f);
+
+		irr::scene::SMesh* mesh = new irr::scene::SMesh();
+		for (U32 b = 0; b < source->getMeshBufferCount(); ++b)
+		{
+			irr::scene::IMeshBuffer* src = source->getMeshBuffer(b);
+			const irr::video::S3DVertexTangents* vertices = static_cast<const irr::video::S3DVertexTangents*>(src->getVertices());
+
+			irr::scene::SMeshBufferTangents* dst = new irr::scene::SMeshBufferTangents();
+			dst->Material = src->getMaterial();
+
+			boost::unordered_map<U32, irr::u16> cells;
+			std::vector<irr::u16> remap(src->getVertexCount());
+			std::vector<U32> counts;
+			for (U32 v = 0; v < src->getVertexCount(); ++v)
+			{
+				const irr::core::vector3df c = (vertices[v].Pos - box.MinEdge) / cell;
+				const U32 x = irr::core::clamp(static_cast<U32>(c.X), 0u, 1023u);
+				const U32 y = irr::core::clamp(static_cast<U32>(c.Y), 0u, 1023u);
+				const U32 z = irr::core::clamp(static_cast<U32>(c.Z), 0u, 1023u);
+				const U32 key = x | (y << 10) | (z << 20);
+
+				boost::unordered_map<U32, irr::u16>::iterator found = cells.find(key);
+				if (found == cells.end())
+				{
+					const irr::u16 index = static_cast<irr::u16>(dst->Vertices.size());
+					dst->Vertices.push_back(vertices[v]);
+					counts.push_back(1);
+					cells[key] = index;
+					remap[v] = index;
+				}
+				else
+				{
+					irr::video::S3DVertexTangents& merged = dst->Vertices[found->second];
+					merged.Pos += vertices[v].Pos;
+					merged.Normal += vertices[v].Normal;
+					merged.TCoords += vertices[v].TCoords;
+					++counts[found->second];
+					remap[v] = found->second;
+				}
+			}
+
+			for (U32 v = 0; v < dst->Vertices.size(); ++v)
+			{
+				const F32 n = static_cast<F32>(counts[v]);
+				dst->Vertices[v].Pos /= n;
+				dst->Vertices[v].TCoords /= n;
+				dst->Vertices[v].Normal.normalize();
+			}
+
+			const irr::u16* indices = src->getIndices();
+			for (U32 i = 0; i + 2 < src->getIndexCount(); i += 3)
+			{
+				const irr::u16 a = remap[indices[i]];
+				const irr::u16 c = remap[indices[i + 1]];
+				const irr::u16 d = remap[indices[i + 2]];
+				if (a != c && c != d && a != d)
+				{
+					dst->Indices.push_back(a);
+					dst->Indices.push_back(c);
+					dst->Indices.push_back(d);
+				}
+			}
+
+			dst->recalculateBoundingBox();
+			dst->setHardwareMappingHint(irr::scene::EHM_STATIC);
+			mesh->addMeshBuffer(dst);
+			dst->drop();
+		}
+		mesh->recalculateBoundingBox();
+
+		return mesh;
+	}
+
+
+	/*
+	* irr::scene::IMesh* kaleidoscope::IrrlichtController::getSimplifiedMesh(irr::scene::IMesh* source, U32 level)
+	*
+	* In: IMesh* : A mesh returned by getMesh().
+	* In: U32 : The level of detail, 1 to 3, each level has about a quarter of the triangles of the one before.
+	* Out: IMesh* : The simplified mesh, it must be handed back with releaseMesh().
+	*				NULL if the source is not in the mesh cache or can not be simplified.
+	*
+	* Simplified meshes are cached next to their source and shared the same way.
+	*/
+	irr::scene::IMesh* IrrlichtController::getSimplifiedMesh(irr::scene::IMesh* source, U32 level)
+	{
+		if (source == NULL || level == 0 || level > MAXLODLEVEL)
+		{
+			return NULL;
+		}
+
+		Semaphore::Semaphore_wait(&useSem);
+
+		boost::unordered_map<irr::scene::IMesh*, U64>::iterator sourceKey = mMeshKeys.find(source);
+		if (sourceKey == mMeshKeys.end())
+		{
+			Semaphore::Semaphore_post(&useSem);
+			return NULL;
+		}
+
+		const U64 key = sourceKey->second | (static_cast<U64>(level) << LODSHIFT);
+		boost::unordered_map<U64, CachedMesh>::iterator cached = mMeshCache.find(key);
+		if (cached != mMeshCache.end())
+		{
+			++cached->second.mRefCount;
+			Semaphore::Semaphore_post(&useSem);
+			return cached->second.mMesh;
+		}
+
+		irr::scene::IMesh* simplified = simplifyMesh(source, level);
+		if (simplified != NULL)
+		{
+			// Copied, adding to the cache may move the source entry.
+			const irr::io::path p = mMeshCache[sourceKey->second].mPath;
+			const U32 options = mMeshCache[sourceKey->second].mOptions | (level << LODSHIFT);
+			addToMeshCache(simplified, p, key, options, 1);
+		}
+
+		Semaphore::Semaphore_post(&useSem);
+		return simplified;
+	}
+
+
+	/*
+	* void kaleidoscope::IrrlichtController::releaseMesh(irr::scene::IMesh* mesh)
+	*
+	* In: IMesh* : A mesh returned by getMesh().
+	* Out: void :
+	*
+	* The mesh may be evicted once its last user releases it, scene nodes still displaying it keep their own reference.
+	*/
+	void IrrlichtController::releaseMesh(irr::scene::IMesh* mesh)
+	{
+		if (mesh == NULL)
+		{
+			return;
+		}
+
+		Semaphore::Semaphore_wait(&useSem);
+
+		boost::unordered_map<irr::scene::IMesh*, U64>::iterator key = mMeshKeys.find(mesh);
+		if (key != mMeshKeys.end())
+		{
+			boost::unordered_map<U64, CachedMesh>::iterator cached = mMeshCache.find(key->second);
+			// Unused meshes stay cached until updateResidency() needs the memory.
+			if (--cached->second.mRefCount == 0)
+			{
+				cached->second.mLastUsed = mResidencyFrame;
+			}
+		}
+
+		Semaphore::Semaphore_post(&useSem);
+	}
+
+
+	/*
+	* bool kaleidoscope::IrrlichtController::startLoader(U32 numThreads)
+	*
+	* In: U32 : The number of threads reading asset files.
+	* Out: bool : true on success.
+	*			  false if a thread could not be created.
+	*
+	* With no loader threads the asynchronous loads read their files on the render thread in processLoads().
+	*/
+	bool IrrlichtController::startLoader(U32 numThreads)
+	{
+		mLoaderThreads.resize(numThreads);
+		for (U32 i = 0; i < numThreads; ++i)
+		{
+			if (Thread::Thread_create(&mLoaderThreads[i], "AssetLoader", LoaderThread, this) != 0)
+			{
+				mLoaderThreads.resize(i);
+				return false;
+			}
+		}
+		return true;
+	}
+
+
+	/*
+	* void kaleidoscope::IrrlichtController::stopLoader()
+	*
+	* In: void :
+	* Out: void :
+	*
+	* Stops the loader threads and drops every unfinished load without calling its callbacks.
+	*/
+	void IrrlichtController::stopLoader()
+	{
+		Semaphore::Semaphore_wait(&loadSem);
+		mReadQueue.clear();
+		Semaphore::Semaphore_post(&loadSem);
+
+		// A loader thread that wakes to an empty read queue exits.
+		for (U32 i = 0; i < mLoaderThreads.size(); ++i)
+		{
+			Semaphore::Semaphore_post(&readSignal);
+		}
+		for (std::vector<Thread>::iterator t = mLoaderThreads.begin(); t != mLoaderThreads.end(); ++t)
+		{
+			Thread::Thread_waitFor(&(*t), NULL);
+		}
+		mLoaderThreads.clear();
+
+		Semaphore::Semaphore_wait(&loadSem);
+		for (boost::unordered_map<U64, AssetLoad*>::iterator l = mPendingLoads.begin(); l != mPendingLoads.end(); ++l)
+		{
+			delete l->second;
+		}
+		mPendingLoads.clear();
+		mReadyQueue.clear();
+		Semaphore::Semaphore_post(&loadSem);
+	}
+
+
+	/*
+	* U32 kaleidoscope::IrrlichtController::loadMeshAsync(const irr::io::path& p, MeshLoadedCallback callback, void* userData)
+	*
+	* In: irr::io::path& : The path to the mesh file.
+	* In: MeshLoadedCallback : Called from processLoads() once the mesh is ready.
+	* In: void* : Handed back to the callback.
+	* Out: U32 : The ticket the callback is called with, never 0.
+	*
+	* The mesh is the same shared mesh getMesh() would return.
+	*/
+	U32 IrrlichtController::loadMeshAsync(const irr::io::path& p, MeshLoadedCallback callback, void* userData)
+	{
+		LoadWaiter w;
+		w.mMeshCallback = callback;
+		w.mTextureCallback = NULL;
+		w.mUserData = userData;
+		return queueLoad(true, p, w);
+	}
+
+
+	/*
+	* U32 kaleidoscope::IrrlichtController::loadTextureAsync(const irr::io::path& p, TextureLoadedCallback callback, void* userData)
+	*
+	* In: irr::io::path& : The path to the texture file.
+	* In: TextureLoadedCallback : Called from processLoads() once the texture is ready.
+	* In: void* : Handed back to the callback.
+	* Out: U32 : The ticket the callback is called with, never 0.
+	*/
+	U32 IrrlichtController::loadTextureAsync(const irr::io::path& p, TextureLoadedCallback callback, void* userData)
+	{
+		LoadWaiter w;
+		w.mMeshCallback = NULL;
+		w.mTextureCallback = callback;
+		w.mUserData = userData;
+		return queueLoad(false, p, w);
+	}
+
+
+	/*
+	* U32 kaleidoscope::IrrlichtController::queueLoad(bool isMesh, const irr::io::path& p, const LoadWaiter& waiter)
+	*
+	* In: bool : true for a mesh, false for a texture.
+	* In: irr::io::path& : The path to the file.
+	* In: LoadWaiter : The callback to add to the load.
+	* Out: U32 : The ticket handed to the callback.
+	*
+	* Joins the load of the asset already in flight or starts a new one. Assets that are already loaded skip the
+	*	loader threads and are handed out by the next processLoads().
+	*/
+	U32 IrrlichtController::queueLoad(bool isMesh, const irr::io::path& p, const LoadWaiter& waiter)
+	{
+		// Textures are told apart from meshes by an option bit meshes never use.
+		const U32 options = (isMesh ? MESHLOAD : TEXTURELOAD);
+		const U64 key = (static_cast<U64>(hashCRC32(p.c_str())) << 32) | options;
+
+		bool resident = false;
+		if (mLoaderThreads.empty() == false)
+		{
+			Semaphore::Semaphore_wait(&useSem);
+			resident = (isMesh ? mMeshCache.find(key) != mMeshCache.end() : mDriver->findTexture(p) != NULL);
+			Semaphore::Semaphore_post(&useSem);
+		}
+
+		Semaphore::Semaphore_wait(&loadSem);
+
+		LoadWaiter w = waiter;
+		w.mTicket = ++mNextTicket;
+		if (w.mTicket == 0)
+		{
+			w.mTicket = ++mNextTicket;
+		}
+
+		boost::unordered_map<U64, AssetLoad*>::iterator pending = mPendingLoads.find(key);
+		if (pending != mPendingLoads.end())
+		{
+			pending->second->mWaiters.push_back(w);
+			Semaphore::Semaphore_post(&loadSem);
+			return w.mTicket;
+		}
+
+		AssetLoad* load = new AssetLoad();
+		load->mIsMesh = isMesh;
+		load->mPath = p;
+		load->mKey = key;
+		load->mOptions = options;
+		load->mRead = false;
+		load->mWaiters.push_back(w);
+		mPendingLoads[key] = load;
+
+		if (resident || mLoaderThreads.empty())
+		{
+			mReadyQueue.push_back(load);
+			Semaphore::Semaphore_post(&loadSem);
+		}
+		else
+		{
+			mReadQueue.push_back(load);
+			Semaphore::Semaphore_post(&loadSem);
+			Semaphore::Semaphore_post(&readSignal);
+		}
+
+		return w.mTicket;
+	}
+
+
+	/*
+	* int kaleidoscope::IrrlichtController::LoaderThread(void* controller)
+	*
+	* In: void* : The IrrlichtController the thread reads files for.
+	* Out: int : Always 0.
+	*
+	* Reads the files of queued loads into memory until it wakes to an empty queue.
+	*/
+	int IrrlichtController::LoaderThread(void* controller)
+	{
+		IrrlichtController* c = static_cast<IrrlichtController*>(controller);
+
+		for (;;)
+		{
+			Semaphore::Semaphore_wait(&c->readSignal);
+
+			Semaphore::Semaphore_wait(&c->loadSem);
+			if (c->mReadQueue.empty())
+			{
+				Semaphore::Semaphore_post(&c->loadSem);
+				return 0;
+			}
+			AssetLoad* load = c->mReadQueue.front();
+			c->mReadQueue.pop_front();
+			Semaphore::Semaphore_post(&c->loadSem);
+
+			FILE* file = std::fopen(load->mPath.c_str(), "rb");
+			if (file != NULL)
+			{
+				std::fseek(file, 0, SEEK_END);
+				const long size = std::ftell(file);
+				std::fseek(file, 0, SEEK_SET);
+				if (size > 0)
+				{
+					load->mData.resize(size);
+					load->mRead = (std::fread(&load->mData[0], 1, size, file) == static_cast<size_t>(size));
+				}
+				std::fclose(file);
+			}
+
+			// Unreadable files are left for the render thread, which reports them the same way getMesh() does.
+			Semaphore::Semaphore_wait(&c->loadSem);
+			c->mReadyQueue.push_back(load);
+			Semaphore::Semaphore_post(&c->loadSem);
+		}
+	}
+
+
+	/*
+	* void kaleidoscope::IrrlichtController::processLoads(F32 budgetMS)
+	*
+	* In: F32 : ms, The time finishing loads may take this frame, at least one load is finished regardless.
+	* Out: void :
+	*
+	* Decodes the files read by the loader threads, builds their meshes and textures and calls the waiting callbacks.
+	* Irrlicht's loaders and driver are not thread safe so this runs on the render thread, spread over frames.
+	*/
+	void IrrlichtController::processLoads(F32 budgetMS)
+	{
+		const U64 start = SDL_GetPerformanceCounter();
+		const F64 ticksPerMS = static_cast<F64>(SDL_GetPerformanceFrequency()) / 1000.0;
+
+		do
+		{
+			Semaphore::Semaphore_wait(&loadSem);
+			if (mReadyQueue.empty())
+			{
+				Semaphore::Semaphore_post(&loadSem);
+				return;
+			}
+			AssetLoad* load = mReadyQueue.front();
+			mReadyQueue.pop_front();
+			Semaphore::Semaphore_post(&loadSem);
+
+			finishLoad(load);
+		} while (static_cast<F64>(SDL_GetPerformanceCounter() - start) / ticksPerMS < budgetMS);
+	}
+
+
+	/*
+	* void kaleidoscope::IrrlichtController::finishLoad(AssetLoad* load)
+	*
+	* In: AssetLoad* : A load taken off the ready queue.
+	* Out: void :
+	*
+	* Builds the asset, gives every waiter its reference and calls the callbacks outside of the locks so they may
+	*	use the controller.
+	*/
+	void IrrlichtController::finishLoad(AssetLoad* load)
+	{
+		// No more waiters can join once the load leaves the pending set.
+		Semaphore::Semaphore_wait(&loadSem);
+		mPendingLoads.erase(load->mKey);
+		Semaphore::Semaphore_post(&loadSem);
+
+		const U32 numWaiters = static_cast<U32>(load->mWaiters.size());
+		irr::scene::IMesh* mesh = NULL;
+		irr::video::ITexture* texture = NULL;
+
+		Semaphore::Semaphore_wait(&useSem);
+		if (load->mIsMesh)
+		{
+			boost::unordered_map<U64, CachedMesh>::iterator cached = mMeshCache.find(load->mKey);
+			if (cached != mMeshCache.end())
+			{
+				cached->second.mRefCount += numWaiters;
+				mesh = cached->second.mMesh;
+			}
+			else
+			{
+				irr::scene::IAnimatedMesh* source = NULL;
+				if (load->mRead)
+				{
+					irr::io::IReadFile* file = mDevice->getFileSystem()->createMemoryReadFile(&load->mData[0], load->mData.size(), load->mPath, false);
+					source = mSmgr->getMesh(file);
+					file->drop();
+				}
+				else
+				{
+					source = mSmgr->getMesh(load->mPath);
+				}
+
+				if (source != NULL)
+				{
+					mesh = cacheMesh(source, load->mPath, load->mKey, load->mOptions, numWaiters);
+				}
+			}
+		}
+		else
+		{
+			texture = mDriver->findTexture(load->mPath);
+			if (texture == NULL)
+			{
+				if (load->mRead)
+				{
+					irr::io::IReadFile* file = mDevice->getFileSystem()->createMemoryReadFile(&load->mData[0], load->mData.size(), load->mPath, false);
+					texture = mDriver->getTexture(file);
+					file->drop();
+				}
+				else
+				{
+					texture = mDriver->getTexture(load->mPath);
+				}
+				trackTexture(texture, load->mPath);
+			}
+		}
+		Semaphore::Semaphore_post(&useSem);
+
+		for (std::vector<LoadWaiter>::iterator w = load->mWaiters.begin(); w != load->mWaiters.end(); ++w)
+		{
+			if (load->mIsMesh)
+			{
+				w->mMeshCallback(w->mUserData, w->mTicket, mesh);
+			}
+			else
+			{
+				w->mTextureCallback(w->mUserData, w->mTicket, texture);
+			}
+		}
+
+		delete load;
+	}
+
+
+	/*
+	* U32 kaleidoscope::IrrlichtController::getNumPendingLoads()
+	*
+	* In: void :
+	* Out: U32 : The number of assets requested that have not been finished yet.
+	*/
+	U32 IrrlichtController::getNumPendingLoads()
+	{
+		Semaphore::Semaphore_wait(&loadSem);
+		U32 n = static_cast<U32>(mPendingLoads.size());
+		Semaphore::Semaphore_post(&loadSem);
+		return n;
+	}
+
+
+	/*
+	* U32 kaleidoscope::IrrlichtController::getNumCachedMeshes() const
+	*
+	* In: void :
+	* Out: U32 : The number of distinct meshes held by the mesh cache.
+	*/
+	U32 IrrlichtController::getNumCachedMeshes() const
+	{
+		return static_cast<U32>(mMeshCache.size());
+	}
+
+
+	/*
+	* U64 kaleidoscope::IrrlichtController::getResidentMeshBytes() const
+	*
+	* In: void :
+	* Out: U64 : The vertex and index bytes of every mesh held by the mesh cache.
+	*/
+	U64 IrrlichtController::getResidentMeshBytes() const
+	{
+		return mResidentMeshBytes;
+	}
+
+
+	/*
+	* void kaleidoscope::IrrlichtController::printMeshCache()
+	*
+	* In: void :
+	* Out: void :
+	*
+	* Print every cached mesh with its users and size, followed by the total.
+	*/
+	void IrrlichtController::printMeshCache()
+	{
+		Semaphore::Semaphore_wait(&useSem);
+
+		gLogManager.log("Mesh cache:");
+		for (boost::unordered_map<U64, CachedMesh>::const_iterator m = mMeshCache.begin(); m != mMeshCache.end(); ++m)
+		{
+			gLogManager.log("	%s (options 0x%x) users = %u, %llu KB", m->second.mPath.c_str(), m->second.mOptions, m->second.mRefCount, m->second.mBytes / 1024);
+		}
+		gLogManager.log("	%u meshes, %llu KB resident", static_cast<U32>(mMeshCache.size()), mResidentMeshBytes / 1024);
+
+		Semaphore::Semaphore_post(&useSem);
+	}
+
+
+	/*
+	* void kaleidoscope::IrrlichtController::trackTexture(irr::video::ITexture* texture, const irr::io::path& p)
+	*
+	* In: ITexture* : A texture the controller just loaded, may be NULL.
+	* In: irr::io::path& : The path it was loaded from.
+	* Out: void :
+	*
+	* Adds the texture to the residency cache with no users.
+	* useSem must be held.
+	*/
+	void IrrlichtController::trackTexture(irr::video::ITexture* texture, const irr::io::path& p)
+	{
+		if (texture == NULL || mTextureCache.find(texture) != mTextureCache.end())
+		{
+			return;
+		}
+
+		ResidentTexture entry;
+		entry.mPath = p;
+		entry.mRefCount = 0;
+		entry.mBytes = textureBytes(texture);
+		entry.mLastUsed = mResidencyFrame;
+		mTextureCache[texture] = entry;
+		mResidentTextureBytes += entry.mBytes;
+	}
+
+
+	/*
+	* void kaleidoscope::IrrlichtController::acquireTexture(irr::video::ITexture* texture)
+	*
+	* In: ITexture* : A texture returned by getTexture() or a texture load, NULL and untracked textures are ignored.
+	* Out: void :
+	*
+	* Adds a user to the texture, it is not evicted until every user has released it.
+	*/
+	void IrrlichtController::acquireTexture(irr::video::ITexture* texture)
+	{
+		if (texture == NULL)
+		{
+			return;
+		}
+
+		Semaphore::Semaphore_wait(&useSem);
+		boost::unordered_map<irr::video::ITexture*, ResidentTexture>::iterator t = mTextureCache.find(texture);
+		if (t != mTextureCache.end())
+		{
+			++t->second.mRefCount;
+		}
+		Semaphore::Semaphore_post(&useSem);
+	}
+
+
+	/*
+	* void kaleidoscope::IrrlichtController::releaseTexture(irr::video::ITexture* texture)
+	*
+	* In: ITexture* : A texture passed to acquireTexture().
+	* Out: void :
+	*/
+	void IrrlichtController::releaseTexture(irr::video::ITexture* texture)
+	{
+		if (texture == NULL)
+		{
+			return;
+		}
+
+		Semaphore::Semaphore_wait(&useSem);
+		boost::unordered_map<irr::video::ITexture*, ResidentTexture>::iterator t = mTextureCache.find(texture);
+		if (t != mTextureCache.end() && t->second.mRefCount > 0)
+		{
+			if (--t->second.mRefCount == 0)
+			{
+				t->second.mLastUsed = mResidencyFrame;
+			}
+		}
+		Semaphore::Semaphore_post(&useSem);
+	}
+
+
+	/*
+	* void kaleidoscope::IrrlichtController::setResidencyBudget(U64 bytes)
+	*
+	* In: U64 : The memory meshes and textures may hold before unused ones are evicted.
+	*			0 evicts every unused asset on the next updateResidency().
+	* Out: void :
+	*/
+	void IrrlichtController::setResidencyBudget(U64 bytes)
+	{
+		mResidencyBudget = bytes;
+	}
+
+	U64 IrrlichtController::getResidencyBudget() const { return mResidencyBudget; }
+
+	U64 IrrlichtController::getResidentTextureBytes() const { return mResidentTextureBytes; }
+
+
+	/*
+	* void kaleidoscope::IrrlichtController::updateResidency()
+	*
+	* In: void :
+	* Out: void :
+	*
+	* Called once a frame. Evicts the least recently used unreferenced assets until the resident memory fits the
+	*	budget, and warns once if the assets still in use do not fit.
+	*/
+	void IrrlichtController::updateResidency()
+	{
+		Semaphore::Semaphore_wait(&useSem);
+
+		++mResidencyFrame;
+
+		bool over = false;
+		if (mResidentMeshBytes + mResidentTextureBytes > mResidencyBudget)
+		{
+			evictUnreferenced(mResidencyBudget);
+			over = (mResidentMeshBytes + mResidentTextureBytes > mResidencyBudget);
+		}
+
+		if (over && !mOverBudget)
+		{
+			gLogManager.log("Assets in use (%llu KB) exceed the residency budget (%llu KB)", (mResidentMeshBytes + mResidentTextureBytes) / 1024, mResidencyBudget / 1024);
+		}
+		mOverBudget = over;
+
+		Semaphore::Semaphore_post(&useSem);
+	}
+
+
+	/*
+	* U32 kaleidoscope::IrrlichtController::purgeUnreferenced()
+	*
+	* In: void :
+	* Out: U32 : The number of assets evicted.
+	*
+	* Evicts every asset nobody uses regardless of the budget, for after a world is unloaded.
+	*/
+	U32 IrrlichtController::purgeUnreferenced()
+	{
+		Semaphore::Semaphore_wait(&useSem);
+		U32 n = evictUnreferenced(0);
+		Semaphore::Semaphore_post(&useSem);
+		return n;
+	}
+
+
+	// An asset nobody uses, meshes are identified by their cache key and textures by the texture.
+	struct EvictionCandidate
+	{
+		U64 mLastUsed;
+		U64 mMeshKey;
+		irr::video::ITexture* mTexture;
+	};
+
+	static bool LeastRecentlyUsed(const EvictionCandidate& lhs, const EvictionCandidate& rhs)
+	{
+		return lhs.mLastUsed < rhs.mLastUsed;
+	}
+
+
+	// Adds delta to the use count of every texture on the meshes materials. SMaterial does not grab its textures, so
+	//	these uses are not in the texture caches ref counts.
+	static void CountMaterialTextures(irr::scene::IMesh* mesh, I32 delta, boost::unordered_map<irr::video::ITexture*, I32>& uses)
+	{
+		for (U32 b = 0; b < mesh->getMeshBufferCount(); ++b)
+		{
+			const irr::video::SMaterial& material = mesh->getMeshBuffer(b)->getMaterial();
+			for (U32 l = 0; l < irr::video::MATERIAL_MAX_TEXTURES; ++l)
+			{
+				irr::video::ITexture* texture = material.getTexture(l);
+				if (texture != NULL)
+				{
+					uses[texture] += delta;
+				}
+			}
+		}
+	}
+
+
+	/*
+	* U32 kaleidoscope::IrrlichtController::evictUnreferenced(U64 targetBytes)
+	*
+	* In: U64 : The resident memory to get down to.
+	* Out: U32 : The number of assets evicted.
+	*
+	* Evicts unreferenced meshes and textures, least recently used first, until the resident memory is at or under
+	*	the target or nothing unreferenced is left.
+	* Textures on the materials of a cached mesh are in use even with no references of their own, they are only
+	*	evicted once those meshes have been.
+	* useSem must be held.
+	*/
+	U32 IrrlichtController::evictUnreferenced(U64 targetBytes)
+	{
+		std::vector<EvictionCandidate> candidates;
+		boost::unordered_map<irr::video::ITexture*, I32> materialUses;
+		for (boost::unordered_map<U64, CachedMesh>::const_iterator m = mMeshCache.begin(); m != mMeshCache.end(); ++m)
+		{
+			CountMaterialTextures(m->second.mMesh, 1, materialUses);
+			if (m->second.mRefCount == 0)
+			{
+				EvictionCandidate c = { m->second.mLastUsed, m->first, NULL };
+				candidates.push_back(c);
+			}
+		}
+		for (boost::unordered_map<irr::video::ITexture*, ResidentTexture>::const_iterator t = mTextureCache.begin(); t != mTextureCache.end(); ++t)
+		{
+			if (t->second.mRefCount == 0)
+			{
+				EvictionCandidate c = { t->second.mLastUsed, 0, t->first };
+				candidates.push_back(c);
+			}
+		}
+		std::sort(candidates.begin(), candidates.end(), LeastRecentlyUsed);
+
+		U32 evicted = 0;
+		for (std::vector<EvictionCandidate>::const_iterator c = candidates.begin(); c != candidates.end(); ++c)
+		{
+			if (mResidentMeshBytes + mResidentTextureBytes <= targetBytes)
+			{
+				break;
+			}
+
+			U64 bytes = 0;
+			if (c->mTexture != NULL)
+			{
+				boost::unordered_map<irr::video::ITexture*, I32>::const_iterator uses = materialUses.find(c->mTexture);
+				if (uses != materialUses.end() && uses->second > 0)
+				{
+					continue;
+				}
+
+				boost::unordered_map<irr::video::ITexture*, ResidentTexture>::iterator t = mTextureCache.find(c->mTexture);
+				bytes = t->second.mBytes;
+				mResidentTextureBytes -= bytes;
+				mTextureCache.erase(t);
+				mDriver->removeTexture(c->mTexture);
+			}
+			else
+			{
+				boost::unordered_map<U64, CachedMesh>::iterator m = mMeshCache.find(c->mMeshKey);
+				bytes = m->second.mBytes;
+				mResidentMeshBytes -= bytes;
+				mMeshKeys.erase(m->second.mMesh);
+				CountMaterialTextures(m->second.mMesh, -1, materialUses);
+				m->second.mMesh->drop();
+				mMeshCache.erase(m);
+			}
+
+			++evicted;
+			++mNumEvictions;
+			mEvictedBytes += bytes;
+		}
+
+		return evicted;
+	}
+
+
+	/*
+	* void kaleidoscope::IrrlichtController::printResidency()
+	*
+	* In: void :
+	* Out: void :
+	*
+	* Print every resident mesh and texture with its users, size and the frames since it was last used, followed by
+	*	the totals against the budget.
+	*/
+	void IrrlichtController::printResidency()
+	{
+		Semaphore::Semaphore_wait(&useSem);
+
+		gLogManager.log("Resident meshes:");
+		for (boost::unordered_map<U64, CachedMesh>::const_iterator m = mMeshCache.begin(); m != mMeshCache.end(); ++m)
+		{
+			if (m->second.mRefCount > 0)
+			{
+				gLogManager.log("	%s users = %u, %llu KB", m->second.mPath.c_str(), m->second.mRefCount, m->second.mBytes / 1024);
+			}
+			else
+			{
+				gLogManager.log("	%s unused for %llu frames, %llu KB", m->second.mPath.c_str(), mResidencyFrame - m->second.mLastUsed, m->second.mBytes / 1024);
+			}
+		}
+
+		gLogManager.log("Resident textures:");
+		for (boost::unordered_map<irr::video::ITexture*, ResidentTexture>::const_iterator t = mTextureCache.begin(); t != mTextureCache.end(); ++t)
+		{
+			if (t->second.mRefCount > 0)
+			{
+				gLogManager.log("	%s users = %u, %llu KB", t->second.mPath.c_str(), t->second.mRefCount, t->second.mBytes / 1024);
+			}
+			else
+			{
+				gLogManager.log("	%s unused for %llu frames, %llu KB", t->second.mPath.c_str(), mResidencyFrame - t->second.mLastUsed, t->second.mBytes / 1024);
+			}
+		}
+
+		gLogManager.log("	meshes %llu KB + textures %llu KB of a %llu KB budget", mResidentMeshBytes / 1024, mResidentTextureBytes / 1024, mResidencyBudget / 1024);
+		gLogManager.log("	%llu assets evicted, %llu KB", mNumEvictions, mEvictedBytes / 1024);
+
+		Semaphore::Semaphore_post(&useSem);
+	}
+
+
+	/*
+	* void kaleidoscope::IrrlichtController::clearMeshCache()
+	*
+	* In: void :
+	* Out: void :
+	*
+	* Drops every cached mesh regardless of its users, used when the device closes.
+	*/
+	void IrrlichtController::clearMeshCache()
+	{
+		for (boost::unordered_map<U64, CachedMesh>::iterator m = mMeshCache.begin(); m != mMeshCache.end(); ++m)
+		{
+			m->second.mMesh->drop();
+		}
+		mMeshCache.clear();
+		mMeshKeys.clear();
+		mResidentMeshBytes = 0;
+	}
+
+
+	/*
+	* irr::scene::ISceneNode* kaleidoscope::IrrlichtController::addSceneNode()
+	*
+	* In: void :
+	* Out: ISceneNode* : A pointer to an Irrlicht Scene Node.
+	*
+	* Adds a scene node to the Irrlicht scene.
+	*/
+	irr::scene::ISceneNode* IrrlichtController::addSceneNode()
+	{
+		Semaphore::Semaphore_wait(&useSem);
+		irr::scene::ISceneNode* s = mSmgr->addEmptySceneNode();
+		Semaphore::Semaphore_post(&useSem);
+		return s;
+	}
+
+
+	/*
+	* irr::scene::IMeshSceneNode* kaleidoscope::IrrlichtController::addMeshSceneNode()
+	*
+	* In: void :
+	* Out: IMeshSceneNode* : A pointer to an Irrlicht Mesh Scene Node.
+	*
+	* Adds a mesh scene node to the Irrlicht scene, under one of the mesh node blocks so removing it stays cheap.
+	*/
+	irr::scene::IMeshSceneNode*   IrrlichtController::addMeshSceneNode()
+	{
+		Semaphore::Semaphore_wait(&useSem);
+		irr::scene::IMeshSceneNode* m = mSmgr->addMeshSceneNode(NULL, meshNodeBlock(), -1, irr::core::vector3df(0.0f, 0.0f, 0.0f), irr::core::vector3df(0.0f, 0.0f, 0.0f), irr::core::vector3df(1.0f, 1.0f, 1.0f), true);
+		Semaphore::Semaphore_post(&useSem);
+		return m;
+	}
+
+
+	/*
+	* irr::scene::ISceneNode* kaleidoscope::IrrlichtController::meshNodeBlock()
+	*
+	* In: void :
+	* Out: ISceneNode* : An empty scene node at the origin with room for another mesh scene node.
+	*
+	* The open block is used until it fills, then the first block with room, and a new block when all are full.
+	*	Blocks are never removed, they cost nothing to draw once empty.
+	* useSem must be held.
+	*/
+	irr::scene::ISceneNode* IrrlichtController::meshNodeBlock()
+	{
+		if (mOpenMeshNodeBlock < mMeshNodeBlocks.size() && mMeshNodeBlocks[mOpenMeshNodeBlock]->getChildren().size() < MESHNODESPERBLOCK)
+		{
+			return mMeshNodeBlocks[mOpenMeshNodeBlock];
+		}
+
+		for (U32 i = 0; i < mMeshNodeBlocks.size(); ++i)
+		{
+			if (mMeshNodeBlocks[i]->getChildren().size() < MESHNODESPERBLOCK)
+			{
+				mOpenMeshNodeBlock = i;
+				return mMeshNodeBlocks[i];
+			}
+		}
+
+		mOpenMeshNodeBlock = static_cast<U32>(mMeshNodeBlocks.size());
+		mMeshNodeBlocks.push_back(mSmgr->addEmptySceneNode());
+		return mMeshNodeBlocks.back();
+	}
+
+
+	/*
+	* irr::scene::ICameraSceneNode* kaleidoscope::IrrlichtController::addCameraSceneNode()
+	*
+	* In: void :
+	* Out: ICameraSceneNode* : A pointer to an Irrlicht Camera Scene Node.
+	*
+	* Adds a camera scene node to the Irrlicht scene.
+	*/
+	irr::scene::ICameraSceneNode* IrrlichtController::addCameraSceneNode()
+	{
+		Semaphore::Semaphore_wait(&useSem);
+		irr::scene::ICameraSceneNode* c = mSmgr->addCameraSceneNode();
+		Semaphore::Semaphore_post(&useSem);
+		return c;
+	}
+
+
+	/*
+	* irr::scene::ILightSceneNode* kaleidoscope::IrrlichtController::addLightSceneNode()
+	*
+	* In: void :
+	* Out: ILightSceneNode* : A pointer to an Irrlicht Light Scene Node.
+	*
+	* Adds a light scene node to the Irrlicht scene.
+	*/
+	irr::scene::ILightSceneNode*  IrrlichtController::addLightSceneNode()
+	{
+		Semaphore::Semaphore_wait(&useSem);
+		irr::scene::ILightSceneNode* l = mSmgr->addLightSceneNode();
+		Semaphore::Semaphore_post(&useSem);
+		return l;
+	}
+
+
+	/*
+	* void kaleidoscope::IrrlichtController::removeSceneNode(irr::scene::ISceneNode* node)
+	*
+	* In: ISceneNode* : A pointer to the scene node to remove.
+	* Out: void :
+	* 
+	* Removes the specified scene node from the Irrlicht Scene.
+	* The removal searches the parents children, mesh scene nodes are kept in blocks to bound that, see meshNodeBlock().
+	*/
+	void IrrlichtController::removeSceneNode(irr::scene::ISceneNode* node)
+	{
+		if (node != NULL)
+		{
+			Semaphore::Semaphore_wait(&useSem);
+			node->remove();
+			Semaphore::Semaphore_post(&useSem);
+		}
+	}
+
+
+	/*
+	* Render queue settings.
+	*/
+	void IrrlichtController::enableRenderQueue(bool value) { useRenderQueue = value; }
+	bool IrrlichtController::renderQueueEnabled() const { return useRenderQueue; }
+
+
+	/*
+	* U32 kaleidoscope::sortID(const void* p)
+	*
+	* In: void* : A texture or mesh buffer.
+	* Out: U32 : 16 bits telling it apart from most others, collisions only cost sorting quality.
+	*/
+	static U32 sortID(const void* p)
+	{
+		const size_t h = reinterpret_cast<size_t>(p) >> 4;
+		return static_cast<U32>((h ^ (h >> 16)) & 0xFFFF);
+	}
+
+
+	/*
+	* void kaleidoscope::IrrlichtController::submitRenderable(irr::scene::IMeshSceneNode* node)
+	*
+	* In: IMeshSceneNode* : A node whose transform is up to date for this frame.
+	* Out: void :
+	*
+	* Hides the node from the scene manager for the next drawAll(), which draws it through the render queue.
+	* Submissions are cleared by drawAll().
+	*/
+	void IrrlichtController::submitRenderable(irr::scene::IMeshSceneNode* node)
+	{
+		if (!useRenderQueue || node->getMesh() == NULL || !node->isVisible())
+		{
+			return;
+		}
+
+		mQueuedNodes.push_back(node);
+	}
+
+
+	/*
+	* void kaleidoscope::IrrlichtController::buildRenderQueue()
+	*
+	* In: void :
+	* Out: void :
+	*
+	* Queues every mesh buffer of the submitted nodes with its sort key and sorts the queue, culled nodes are left out.
+	* Called in the scene managers solid pass, after the camera pass, so culling and depth use this frame's camera.
+	*
+	* Opaque key:      pass (2) | shader (8) | texture (16) | mesh buffer (16) | depth (22)
+	* Transparent key: pass (2) | inverted depth (22) | shader (8) | texture (16) | mesh buffer (16)
+	*/
+	void IrrlichtController::buildRenderQueue()
+	{
+		mRenderQueue.clear();
+		mCulledThisFrame = 0;
+		mNumDrawCalls = 0;
+		mNumMaterialSwitches = 0;
+		mNumShaderSwitches = 0;
+		mNumTextureSwitches = 0;
+		mNumBufferSwitches = 0;
+		mNumInstanceGroups = 0;
+		mNumInstancesDrawn = 0;
+
+		irr::scene::ICameraSceneNode* camera = mSmgr->getActiveCamera();
+		for (std::vector<irr::scene::IMeshSceneNode*>::iterator n = mQueuedNodes.begin(); n != mQueuedNodes.end(); ++n)
+		{
+			irr::scene::IMeshSceneNode* node = *n;
+			irr::scene::IMesh* mesh = node->getMesh();
+			if (mSmgr->isCulled(node))
+			{
+				++mCulledThisFrame;
+				continue;
+			}
+
+			// Depth in 1/16ths of a unit from the camera, clamped to 22 bits.
+			U64 depth = 0;
+			if (camera != NULL)
+			{
+				const F32 d = camera->getAbsolutePosition().getDistanceFrom(node->getTransformedBoundingBox().getCenter()) * 16.0f;
+				depth = (d >= 4194303.0f ? 4194303 : static_cast<U64>(d));
+			}
+
+			const U32 numBuffers = (mesh->getMeshBufferCount() < node->getMaterialCount() ? mesh->getMeshBufferCount() : node->getMaterialCount());
+			for (U32 b = 0; b < numBuffers; ++b)
+			{
+				const irr::video::SMaterial& material = node->getMaterial(b);
+				const U64 shader = static_cast<U64>(material.MaterialType) & 0xFF;
+				const U64 texture = sortID(material.getTexture(0));
+				const U64 buffer = sortID(mesh->getMeshBuffer(b));
+
+				RenderItem item;
+				item.mNode = node;
+				item.mBuffer = b;
+				if (material.isTransparent())
+				{
+					item.mKey = (static_cast<U64>(1) << 62) | ((4194303 - depth) << 40) | (shader << 32) | (texture << 16) | buffer;
+				}
+				else
+				{
+					item.mKey = (shader << 54) | (texture << 38) | (buffer << 22) | depth;
+				}
+				mRenderQueue.push_back(item);
+			}
+		}
+
+		std::sort(mRenderQueue.begin(), mRenderQueue.end(), RenderItemOrder);
+	}
 
-namespace kaleidoscope
-{
 
 	/*
-	* kaleidoscope::IrrlichtController::IrrlichtController()
-	*
-	* Set the defaults for the Irrlicht Controller.
+	* Statistics of the last frame drawn.
 	*/
-	IrrlichtController::IrrlichtController()
-	{
-		mDevice = NULL;
-		mSmgr = NULL;
-		mDevice = NULL;
+	U32 IrrlichtController::getNumDrawCalls() const { return mNumDrawCalls; }
+	U32 IrrlichtController::getNumMaterialSwitches() const { return mNumMaterialSwitches; }
+	U32 IrrlichtController::getNumShaderSwitches() const { return mNumShaderSwitches; }
+	U32 IrrlichtController::getNumTextureSwitches() const { return mNumTextureSwitches; }
+	U32 IrrlichtController::getNumBufferSwitches() const { return mNumBufferSwitches; }
+	U32 IrrlichtController::getNumInstanceGroups() const { return mNumInstanceGroups; }
+	U32 IrrlichtController::getNumInstancesDrawn() const { return mNumInstancesDrawn; }
 
-		mAllSceneNodes = std::list<irr::scene::ISceneNode*>();
 
-		useMipMaps = true;
-		normalizeNormals = true;
-		backfaceCulling = true;
-		frontfaceCulling = false;
-		antiAliasingMode = irr::video::EAAM_SIMPLE | irr::video::EAAM_LINE_SMOOTH;
-		isFogEnabled = false;
-		lighting = false;
-		zWriteEnabled = true;
+	/*
+	* void kaleidoscope::IrrlichtController::printRenderStats() const
+	*
+	* In: void :
+	* Out: void :
+	*
+	* Print the draw calls and state switches of the last frame drawn through the render queue.
+	*/
+	void IrrlichtController::printRenderStats() const
+	{
+		gLogManager.log("Render queue:");
+		gLogManager.log("	draw calls = %u", mNumDrawCalls);
+		gLogManager.log("	material switches = %u (shader %u, texture %u)", mNumMaterialSwitches, mNumShaderSwitches, mNumTextureSwitches);
+		gLogManager.log("	mesh buffer switches = %u", mNumBufferSwitches);
+		gLogManager.log("	instance groups = %u, %u instances", mNumInstanceGroups, mNumInstancesDrawn);
 	}
 
 
-	IrrlichtController::~IrrlichtController()
+	/*
+	* void kaleidoscope::IrrlichtController::setStaticChunkSize(F32 chunkSize)
+	*
+	* In: F32 : The edge length of the cubes of space each batch covers.
+	* Out: void :
+	*
+	* Changing the size removes every static batch, the chunks they were built for no longer exist.
+	*/
+	void IrrlichtController::setStaticChunkSize(F32 chunkSize)
 	{
-
+		chunkSize = (chunkSize > 0.0f ? chunkSize : 64.0f);
+		if (chunkSize != mStaticChunkSize)
+		{
+			clearStaticBatches();
+			mStaticChunkSize = chunkSize;
+		}
 	}
 
 
 	/*
-	* bool kaleidoscope::IrrlichtController::createDevice(irr::SIrrlichtCreationParameters& params)
+	* bool kaleidoscope::IrrlichtController::addToStaticBatch(irr::scene::IMeshSceneNode* node)
 	*
-	* In: SIrrlichtCreationParameters& params : parameters to initialize Irrlicht with.
-	* Out: bool : true on success.
-	*			  false on failure.
+	* In: IMeshSceneNode* : A node with an up to date transform.
+	* Out: bool : true if the nodes mesh was merged into the batches, the node should then be hidden.
+	*			  false if the mesh can not be batched, it is left to draw on its own.
 	*
-	* Create and initialize all of the state Irrlicht needs.
-	* Should be called on every IrrlichtController created.
+	* The mesh is transformed into world space with the node's materials and added to the chunk the node sits in.
+	* Only the tangent meshes made by getMesh() with 16 bit indices and opaque materials are batched.
 	*/
-	bool IrrlichtController::createDevice(irr::SIrrlichtCreationParameters& params)
+	bool IrrlichtController::addToStaticBatch(irr::scene::IMeshSceneNode* node)
 	{
-		mDevice = irr::createDeviceEx(params);
-		if (mDevice == NULL)
+		irr::scene::IMesh* mesh = node->getMesh();
+		if (mesh == NULL || mesh->getMeshBufferCount() > node->getMaterialCount())
 		{
 			return false;
 		}
-		mSmgr = mDevice->getSceneManager();
-		mDriver = mDevice->getVideoDriver();
-
-		mDriver->setTextureCreationFlag(irr::video::ETCF_ALWAYS_32_BIT, true);
 
-		if (Semaphore::Semaphore_init(&useSem, 1) != 0)
+		for (U32 b = 0; b < mesh->getMeshBufferCount(); ++b)
 		{
-			return false;
+			irr::scene::IMeshBuffer* mb = mesh->getMeshBuffer(b);
+			if (mb->getVertexType() != irr::video::EVT_TANGENTS || mb->getIndexType() != irr::video::EIT_16BIT ||
+				mb->getVertexCount() > MAXBATCHVERTICES || node->getMaterial(b).isTransparent())
+			{
+				return false;
+			}
 		}
 
+		const irr::core::matrix4& world = node->getAbsoluteTransformation();
 
-		mSmgr->addSkyBoxSceneNode(
-			mDriver->getTexture("media/irrlicht2_up.jpg"),
-			mDriver->getTexture("media/irrlicht2_dn.jpg"),
-			mDriver->getTexture("media/irrlicht2_lf.jpg"),
-			mDriver->getTexture("media/irrlicht2_rt.jpg"),
-			mDriver->getTexture("media/irrlicht2_ft.jpg"),
-			mDriver->getTexture("media/irrlicht2_bk.jpg"));
+		// Normals keep facing away from the surface under non-uniform scale only through the inverse transpose.
+		//	Tangents and binormals lie in the surface and go through the world matrix like the positions.
+		irr::core::matrix4 normalMatrix;
+		if (world.getInverse(normalMatrix))
+		{
+			normalMatrix = normalMatrix.getTransposed();
+		}
+		else
+		{
+			normalMatrix = world;
+		}
 
-		mSmgr->addLightSceneNode(NULL, irr::core::vector3df(0, 2, 0));
+		StaticChunk& chunk = mStaticChunks[staticChunkKey(node->getAbsolutePosition())];
 
+		for (U32 b = 0; b < mesh->getMeshBufferCount(); ++b)
+		{
+			irr::scene::IMeshBuffer* mb = mesh->getMeshBuffer(b);
+			const irr::video::SMaterial& material = node->getMaterial(b);
+
+			// Fill the latest buffer of the material until it runs out of 16 bit indices.
+			irr::scene::SMeshBufferTangents* dst = NULL;
+			for (std::vector<irr::scene::SMeshBufferTangents*>::reverse_iterator buf = chunk.mBuffers.rbegin(); buf != chunk.mBuffers.rend(); ++buf)
+			{
+				if ((*buf)->Material == material)
+				{
+					if ((*buf)->Vertices.size() + mb->getVertexCount() <= MAXBATCHVERTICES)
+					{
+						dst = *buf;
+					}
+					break;
+				}
+			}
+			if (dst == NULL)
+			{
+				dst = new irr::scene::SMeshBufferTangents();
+				dst->Material = material;
+				chunk.mBuffers.push_back(dst);
+			}
+
+			const U32 base = dst->Vertices.size();
+			const irr::video::S3DVertexTangents* vertices = static_cast<const irr::video::S3DVertexTangents*>(mb->getVertices());
+			for (U32 v = 0; v < mb->getVertexCount(); ++v)
+			{
+				irr::video::S3DVertexTangents vertex = vertices[v];
+				world.transformVect(vertex.Pos);
+				normalMatrix.rotateVect(vertex.Normal);
+				world.rotateVect(vertex.Tangent);
+				world.rotateVect(vertex.Binormal);
+				vertex.Normal.normalize();
+				vertex.Tangent.normalize();
+				vertex.Binormal.normalize();
+				dst->Vertices.push_back(vertex);
+			}
+
+			const irr::u16* indices = mb->getIndices();
+			for (U32 i = 0; i < mb->getIndexCount(); ++i)
+			{
+				dst->Indices.push_back(static_cast<irr::u16>(base + indices[i]));
+			}
+		}
 
 		return true;
 	}
 
 
 	/*
-	* void kaleidoscope::IrrlichtController::closeDevice()
+	* void kaleidoscope::IrrlichtController::endStaticBatches()
 	*
-	* Release all Irrlicht State.
-	* Must be called before the destructor is called.
+	* In: void :
+	* Out: void :
+	*
+	* Adds a scene node for every chunk built since the last call, replacing the batch the chunk had before.
+	* The buffers are marked static so the driver keeps them in video memory.
 	*/
-	void IrrlichtController::closeDevice()
+	void IrrlichtController::endStaticBatches()
 	{
-		mDevice->closeDevice();
-		mDevice->drop();
+		for (boost::unordered_map<U64, StaticChunk>::iterator c = mStaticChunks.begin(); c != mStaticChunks.end(); ++c)
+		{
+			clearStaticBatch(c->first);
+		}
 
-		Semaphore::Semaphore_destroy(&useSem);
+		Semaphore::Semaphore_wait(&useSem);
+		for (boost::unordered_map<U64, StaticChunk>::iterator c = mStaticChunks.begin(); c != mStaticChunks.end(); ++c)
+		{
+			irr::scene::SMesh* mesh = new irr::scene::SMesh();
+			for (std::vector<irr::scene::SMeshBufferTangents*>::iterator buf = c->second.mBuffers.begin(); buf != c->second.mBuffers.end(); ++buf)
+			{
+				(*buf)->recalculateBoundingBox();
+				(*buf)->setHardwareMappingHint(irr::scene::EHM_STATIC);
+				mesh->addMeshBuffer(*buf);
+				(*buf)->drop();
+			}
+			mesh->recalculateBoundingBox();
+			mNumStaticBuffers += static_cast<U32>(c->second.mBuffers.size());
+
+			irr::scene::IMeshSceneNode* node = mSmgr->addMeshSceneNode(mesh);
+			mesh->drop();
+			mStaticBatchNodes[c->first] = node;
+		}
+		mStaticChunks.clear();
+		Semaphore::Semaphore_post(&useSem);
 	}
 
+
 	/*
-	* irr::video::ITexture* kaleidoscope::IrrlichtController::getTexture(const irr::io::path& p)
+	* void kaleidoscope::IrrlichtController::clearStaticBatch(U64 chunk)
 	*
-	* In: irr::io::path& : The path to the texture file.
-	* Out: irr::video::ITexture* : A pointer to the loaded texture data if the file existed.
-	*							   NULL pointer if the file doesn't exist.
+	* In: U64 : The key of the chunk, from staticChunkKey().
+	* Out: void :
+	*
+	* Removes the static batch of one chunk from the scene, if it has one.
 	*/
-	irr::video::ITexture* IrrlichtController::getTexture(const irr::io::path& p)
+	void IrrlichtController::clearStaticBatch(U64 chunk)
 	{
-		Semaphore::Semaphore_wait(&useSem);
-		irr::video::ITexture* tex = mDriver->getTexture(p);
-		Semaphore::Semaphore_post(&useSem);
-		return tex;
+		boost::unordered_map<U64, irr::scene::IMeshSceneNode*>::iterator node = mStaticBatchNodes.find(chunk);
+		if (node == mStaticBatchNodes.end())
+		{
+			return;
+		}
+
+		mNumStaticBuffers -= node->second->getMesh()->getMeshBufferCount();
+		removeSceneNode(node->second);
+		mStaticBatchNodes.erase(node);
 	}
 
 
 	/*
-	* irr::video::ITexture* kaleidoscope::IrrlichtController::getMesh(const irr::io::path& p)
+	* void kaleidoscope::IrrlichtController::clearStaticBatches()
 	*
-	* In: irr::io::path& : The path to the mesh file.
-	* Out: irr::video::ITexture* : A pointer to the loaded mesh data if the file existed.
-	*							   NULL pointer if the file doesn't exist.
+	* In: void :
+	* Out: void :
+	*
+	* Removes every static batch from the scene.
 	*/
-	irr::scene::IMesh* IrrlichtController::getMesh(const irr::io::path& p)
+	void IrrlichtController::clearStaticBatches()
 	{
-		Semaphore::Semaphore_wait(&useSem);
-		irr::scene::IAnimatedMesh* mesh = mSmgr->getMesh(p);
-
-		if (mesh == NULL)
+		for (boost::unordered_map<U64, irr::scene::IMeshSceneNode*>::iterator node = mStaticBatchNodes.begin(); node != mStaticBatchNodes.end(); ++node)
 		{
-			return NULL;
+			removeSceneNode(node->second);
 		}
+		mStaticBatchNodes.clear();
+		mNumStaticBuffers = 0;
+	}
 
-		irr::scene::IMesh* tanMesh = mSmgr->getMeshManipulator()->createMeshWithTangents(mesh->getMesh(0));
 
+	U32 IrrlichtController::getNumStaticBatches() const { return static_cast<U32>(mStaticBatchNodes.size()); }
+	U32 IrrlichtController::getNumStaticBuffers() const { return mNumStaticBuffers; }
 
-		tanMesh->setMaterialFlag(irr::video::EMF_USE_MIP_MAPS, useMipMaps);
-		tanMesh->setMaterialFlag(irr::video::EMF_NORMALIZE_NORMALS, normalizeNormals);
-		tanMesh->setMaterialFlag(irr::video::EMF_BACK_FACE_CULLING, backfaceCulling);
-		tanMesh->setMaterialFlag(irr::video::EMF_FRONT_FACE_CULLING, frontfaceCulling);
-		tanMesh->setMaterialFlag(irr::video::EMF_ANTI_ALIASING, static_cast<bool>(antiAliasingMode));
-		tanMesh->setMaterialFlag(irr::video::EMF_FOG_ENABLE, isFogEnabled);
-		tanMesh->setMaterialFlag(irr::video::EMF_LIGHTING, lighting);
-		tanMesh->setMaterialFlag(irr::video::EMF_ZWRITE_ENABLE, zWriteEnabled);
-		tanMesh->setMaterialFlag(irr::video::EMF_ANISOTROPIC_FILTER, true);
-		tanMesh->setMaterialFlag(irr::video::EMF_TRILINEAR_FILTER, true);
 
-		Semaphore::Semaphore_post(&useSem);
-		return tanMesh;
+	/*
+	* U64 kaleidoscope::IrrlichtController::staticChunkKey(const irr::core::vector3df& position) const
+	*
+	* In: vector3df : A world position.
+	* Out: U64 : The chunk holding the position, 21 bits per axis.
+	*/
+	U64 IrrlichtController::staticChunkKey(const irr::core::vector3df& position) const
+	{
+		const I32 x = static_cast<I32>(std::floor(position.X / mStaticChunkSize));
+		const I32 y = static_cast<I32>(std::floor(position.Y / mStaticChunkSize));
+		const I32 z = static_cast<I32>(std::floor(position.Z / mStaticChunkSize));
+		return ((static_cast<U64>(x) & 0x1FFFFF) << 42) | ((static_cast<U64>(y) & 0x1FFFFF) << 21) | (static_cast<U64>(z) & 0x1FFFFF);
 	}
 
 
 	/*
-	* irr::scene::ISceneNode* kaleidoscope::IrrlichtController::addSceneNode()
+	* void kaleidoscope::IrrlichtController::drawAll()
 	*
 	* In: void :
-	* Out: ISceneNode* : A pointer to an Irrlicht Scene Node.
+	* Out: void :
 	*
-	* Adds a scene node to the Irrlicht scene.
+	* Draw the Irrlicht Scene.
+	* Queued nodes are hidden from the scene manager, which draws them through the render queue in its solid and
+	*	transparent passes.
 	*/
-	irr::scene::ISceneNode* IrrlichtController::addSceneNode()
+	void IrrlichtController::drawAll()
 	{
-		Semaphore::Semaphore_wait(&useSem);
-		irr::scene::ISceneNode* s = mSmgr->addEmptySceneNode();
-		mAllSceneNodes.push_back(s);
-		Semaphore::Semaphore_post(&useSem);
-		return s;
+		const U64 start = SDL_GetPerformanceCounter();
+		irr::ITimer* timer = mDevice->getTimer();
+		if (mFixedTimeStep != 0)
+		{
+			timer->setTime(timer->getTime() + mFixedTimeStep);
+		}
+		else
+		{
+			timer->tick();
+		}
+
+		// The static batches are ordinary mesh nodes and sort with everything else, they are culled with the rest
+		//	once the scene manager has updated the camera.
+		for (boost::unordered_map<U64, irr::scene::IMeshSceneNode*>::iterator node = mStaticBatchNodes.begin(); node != mStaticBatchNodes.end(); ++node)
+		{
+			submitRenderable(node->second);
+		}
+
+		for (std::vector<irr::scene::IMeshSceneNode*>::iterator node = mQueuedNodes.begin(); node != mQueuedNodes.end(); ++node)
+		{
+			(*node)->setVisible(false);
+		}
+
+		// draw engine picture
+		if (mOffscreenTarget != NULL)
+		{
+			// No endScene(), its per frame upkeep has nothing to do here: Burning's Video keeps no hardware buffers
+			//	or occlusion queries to update and the driver's FPS counter is not read. What is left is presenting,
+			//	which the console device does by printing the frame to the terminal as text.
+			mDriver->beginScene(false, false);
+			mDriver->setRenderTarget(mOffscreenTarget, true, true, irr::video::SColor(255, 0, 128, 128));
+			mSmgr->drawAll();
+			mDriver->setRenderTarget(NULL, false, false);
+		}
+		else
+		{
+			mDriver->beginScene(true, true, 0);
+			mSmgr->drawAll();
+			mDriver->endScene();
+		}
+
+		for (std::vector<irr::scene::IMeshSceneNode*>::iterator node = mQueuedNodes.begin(); node != mQueuedNodes.end(); ++node)
+		{
+			(*node)->setVisible(true);
+		}
+		mNumSubmittedNodes = mQueuedNodes.size();
+		mNumCulledNodes = mCulledThisFrame;
+		mCulledThisFrame = 0;
+		mQueuedNodes.clear();
+		mRenderQueue.clear();
+
+		mLastFrameTime = static_cast<F32>(static_cast<F64>(SDL_GetPerformanceCounter() - start) * 1000.0 / static_cast<F64>(SDL_GetPerformanceFrequency()));
+		mTotalFrameTime += mLastFrameTime;
+		++mNumFramesDrawn;
 	}
 
 
 	/*
-	* irr::scene::IMeshSceneNode* kaleidoscope::IrrlichtController::addMeshSceneNode()
+	* void kaleidoscope::IrrlichtController::setFixedTimeStep(U32 ms)
 	*
-	* In: void :
-	* Out: IMeshSceneNode* : A pointer to an Irrlicht Mesh Scene Node.
+	* In: U32 : The ms the scene's animations advance every frame, 0 to follow the real time again.
+	* Out: void :
 	*
-	* Adds a mesh scene node to the Irrlicht scene.
+	* The device timer is stopped while a step is set so it only moves when drawAll() advances it.
 	*/
-	irr::scene::IMeshSceneNode*   IrrlichtController::addMeshSceneNode()
+	void IrrlichtController::setFixedTimeStep(U32 ms)
 	{
-		Semaphore::Semaphore_wait(&useSem);
-		irr::scene::IMeshSceneNode* m = mSmgr->addMeshSceneNode(NULL, NULL, -1, irr::core::vector3df(0.0f, 0.0f, 0.0f), irr::core::vector3df(0.0f, 0.0f, 0.0f), irr::core::vector3df(1.0f, 1.0f, 1.0f), true);
-		mAllSceneNodes.push_back(m);
-		Semaphore::Semaphore_post(&useSem);
-		return m;
+		irr::ITimer* timer = mDevice->getTimer();
+		if (ms != 0 && mFixedTimeStep == 0)
+		{
+			timer->stop();
+		}
+		else if (ms == 0 && mFixedTimeStep != 0)
+		{
+			timer->start();
+		}
+		mFixedTimeStep = ms;
 	}
 
 
+	U32 IrrlichtController::getFixedTimeStep() const { return mFixedTimeStep; }
+
+
 	/*
-	* irr::scene::ICameraSceneNode* kaleidoscope::IrrlichtController::addCameraSceneNode()
+	* bool kaleidoscope::IrrlichtController::createOffscreenTarget(U32 width, U32 height)
 	*
-	* In: void :
-	* Out: ICameraSceneNode* : A pointer to an Irrlicht Camera Scene Node.
+	* In: U32 : The width of the target in pixels.
+	* In: U32 : The height of the target in pixels.
+	* Out: bool : true on success.
+	*			  false if the driver can not render to textures.
 	*
-	* Adds a camera scene node to the Irrlicht scene.
+	* Every frame drawn after this goes into the target.
 	*/
-	irr::scene::ICameraSceneNode* IrrlichtController::addCameraSceneNode()
+	bool IrrlichtController::createOffscreenTarget(U32 width, U32 height)
 	{
-		Semaphore::Semaphore_wait(&useSem);
-		irr::scene::ICameraSceneNode* c = mSmgr->addCameraSceneNode();
-		mAllSceneNodes.push_back(c);
-		Semaphore::Semaphore_post(&useSem);
-		return c;
+		if (!mDriver->queryFeature(irr::video::EVDF_RENDER_TO_TARGET))
+		{
+			return false;
+		}
+
+		mOffscreenTarget = mDriver->addRenderTargetTexture(irr::core::dimension2d<irr::u32>(width, height), "kaleidoscope.offscreen", irr::video::ECF_A8R8G8B8);
+		return mOffscreenTarget != NULL;
 	}
 
 
+	bool IrrlichtController::hasOffscreenTarget() const { return mOffscreenTarget != NULL; }
+
+
 	/*
-	* irr::scene::ILightSceneNode* kaleidoscope::IrrlichtController::addLightSceneNode()
+	* bool kaleidoscope::IrrlichtController::captureFrame(const irr::io::path& p)
+	*
+	* In: path : The file to write, the extension picks the image format.
+	* Out: bool : true on success.
+	*			  false if nothing could be read back or the file could not be written.
+	*/
+	bool IrrlichtController::captureFrame(const irr::io::path& p)
+	{
+		irr::video::IImage* image = NULL;
+		if (mOffscreenTarget != NULL)
+		{
+			image = mDriver->createImage(mOffscreenTarget, irr::core::position2d<irr::s32>(0, 0), mOffscreenTarget->getSize());
+		}
+		else
+		{
+			image = mDriver->createScreenShot();
+		}
+
+		if (image == NULL)
+		{
+			return false;
+		}
+
+		bool written = mDriver->writeImageToFile(image, p);
+		image->drop();
+		return written;
+	}
+
+
+	/*
+	* Statistics of the frames drawn since the last reset.
+	*/
+	U64 IrrlichtController::getNumFramesDrawn() const { return mNumFramesDrawn; }
+	F32 IrrlichtController::getLastFrameTime() const { return mLastFrameTime; }
+	F32 IrrlichtController::getAverageFrameTime() const { return (mNumFramesDrawn == 0 ? 0.0f : static_cast<F32>(mTotalFrameTime / static_cast<F64>(mNumFramesDrawn))); }
+	U32 IrrlichtController::getNumSubmittedNodes() const { return mNumSubmittedNodes; }
+	U32 IrrlichtController::getNumCulledNodes() const { return mNumCulledNodes; }
+
+	void IrrlichtController::resetFrameStats()
+	{
+		mNumFramesDrawn = 0;
+		mTotalFrameTime = 0.0;
+	}
+
+
+	/*
+	* void kaleidoscope::IrrlichtController::printFrameStats() const
 	*
 	* In: void :
-	* Out: ILightSceneNode* : A pointer to an Irrlicht Light Scene Node.
+	* Out: void :
 	*
-	* Adds a light scene node to the Irrlicht scene.
+	* Print the frame times and how many of the submitted nodes were culled in the last frame.
 	*/
-	irr::scene::ILightSceneNode*  IrrlichtController::addLightSceneNode()
+	void IrrlichtController::printFrameStats() const
 	{
-		Semaphore::Semaphore_wait(&useSem);
-		irr::scene::ILightSceneNode* l = mSmgr->addLightSceneNode();
-		mAllSceneNodes.push_back(l);
-		Semaphore::Semaphore_post(&useSem);
-		return l;
+		gLogManager.log("Frames:");
+		gLogManager.log("	frames drawn = %llu", mNumFramesDrawn);
+		gLogManager.log("	last frame = %.3f ms, average = %.3f ms", mLastFrameTime, getAverageFrameTime());
+		gLogManager.log("	nodes submitted = %u, culled = %u", mNumSubmittedNodes, mNumCulledNodes);
 	}
 
 
 	/*
-	* void kaleidoscope::IrrlichtController::removeSceneNode(irr::scene::ISceneNode* node)
+	* bool kaleidoscope::IrrlichtController::RenderItemOrder(const RenderItem& lhs, const RenderItem& rhs)
 	*
-	* In: ISceneNode* : A pointer to the scene node to remove.
-	* Out: void :
-	* 
-	* Removes the specified scene node from the Irrlicht Scene.
+	* Orders the render queue by sort key.
 	*/
-	void IrrlichtController::removeSceneNode(irr::scene::ISceneNode* node)
+	bool IrrlichtController::RenderItemOrder(const RenderItem& lhs, const RenderItem& rhs)
 	{
-		if (node != NULL)
-		{
-			Semaphore::Semaphore_wait(&useSem);
-			std::list<irr::scene::ISceneNode*>::iterator loc = std::find(mAllSceneNodes.begin(), mAllSceneNodes.end(), node);
-			mAllSceneNodes.erase(loc);
-			node->remove();
-			Semaphore::Semaphore_post(&useSem);
-		}
+		return lhs.mKey < rhs.mKey;
 	}
 
 
 	/*
-	* void kaleidoscope::IrrlichtController::drawAll()
+	* void kaleidoscope::IrrlichtController::drawRenderQueue(bool transparent)
 	*
-	* In: void :
+	* In: bool : true to draw the transparent items, false for the opaque ones.
 	* Out: void :
 	*
-	* Draw the Irrlicht Scene.
+	* Draws one part of the sorted queue, setting the material only when it changes and counting the state switches.
+	* The scene manager has turned the override material on for the pass.
 	*/
-	void IrrlichtController::drawAll()
+	void IrrlichtController::drawRenderQueue(bool transparent)
 	{
-		mDevice->getTimer()->tick();
+		// Transparent keys have the pass bit set so they sort after every opaque item.
+		RenderItem split;
+		split.mKey = static_cast<U64>(1) << 62;
+		std::vector<RenderItem>::const_iterator first = std::lower_bound(mRenderQueue.begin(), mRenderQueue.end(), split, RenderItemOrder);
+		std::vector<RenderItem>::const_iterator last = mRenderQueue.end();
+		if (!transparent)
+		{
+			last = first;
+			first = mRenderQueue.begin();
+		}
 
-		// draw engine picture
-		mDriver->beginScene(true, true, 0);
-		mSmgr->drawAll();
-		mDriver->endScene();
+		// The scene manager may have set other state since the last part, so the first material is always set.
+		const irr::video::SMaterial* lastMaterial = NULL;
+		irr::scene::IMeshBuffer* lastBuffer = NULL;
+		U32 run = 0;		// Items drawn in a row with the same mesh buffer and material.
+		for (std::vector<RenderItem>::const_iterator item = first; item != last; ++item)
+		{
+			const irr::video::SMaterial& material = item->mNode->getMaterial(item->mBuffer);
+			irr::scene::IMeshBuffer* mb = item->mNode->getMesh()->getMeshBuffer(item->mBuffer);
+
+			bool same = true;
+			if (lastMaterial == NULL || material != *lastMaterial)
+			{
+				if (lastMaterial == NULL || material.MaterialType != lastMaterial->MaterialType)
+				{
+					++mNumShaderSwitches;
+				}
+				if (lastMaterial == NULL || material.getTexture(0) != lastMaterial->getTexture(0) || material.getTexture(1) != lastMaterial->getTexture(1))
+				{
+					++mNumTextureSwitches;
+				}
+				mDriver->setMaterial(material);
+				++mNumMaterialSwitches;
+				lastMaterial = &material;
+				same = false;
+			}
+			if (mb != lastBuffer)
+			{
+				++mNumBufferSwitches;
+				lastBuffer = mb;
+				same = false;
+			}
+
+			run = (same ? run + 1 : 1);
+			if (run == 2)
+			{
+				++mNumInstanceGroups;
+				mNumInstancesDrawn += 2;
+			}
+			else if (run > 2)
+			{
+				++mNumInstancesDrawn;
+			}
+
+			mDriver->setTransform(irr::video::ETS_WORLD, item->mNode->getAbsoluteTransformation());
+			mDriver->drawMeshBuffer(mb);
+			++mNumDrawCalls;
+		}
 	}
 
 	/*
@@ -268,13 +2037,46 @@ namespace kaleidoscope
 	bool IrrlichtController::ZWriteEnabled() const { return zWriteEnabled; }
 
 	
+	/*
+	* void kaleidoscope::IrrlichtController::overrideMaterialFlag(irr::video::E_MATERIAL_FLAG flag, bool value, bool meshDefault)
+	*
+	* In: E_MATERIAL_FLAG : The flag to set.
+	* In: bool : The value to draw every material with.
+	* In: bool : The value of the flag in the materials of the meshes getMesh() returns.
+	* Out: void :
+	*
+	* The flag is set once on the drivers override material instead of on every node, so it also holds for
+	*	nodes added later. The sky box pass is left out.
+	* While the value differs from the mesh default the override is global and permanent: it wins over every
+	*	material, so the flag set on one renderable's material has no effect. Setting the default value again
+	*	ends the override and the materials' own flags apply.
+	*/
+	void IrrlichtController::overrideMaterialFlag(irr::video::E_MATERIAL_FLAG flag, bool value, bool meshDefault)
+	{
+		irr::video::SOverrideMaterial& o = mDriver->getOverrideMaterial();
+		o.Material.setFlag(flag, value);
+		if (value == meshDefault)
+		{
+			o.EnableFlags &= ~static_cast<irr::u32>(flag);
+		}
+		else
+		{
+			o.EnableFlags |= flag;
+		}
+		o.EnablePasses = irr::scene::ESNRP_CAMERA | irr::scene::ESNRP_LIGHT | irr::scene::ESNRP_SOLID | irr::scene::ESNRP_TRANSPARENT | irr::scene::ESNRP_TRANSPARENT_EFFECT | irr::scene::ESNRP_SHADOW;
+	}
+
+
 	/*
 	* void kaleidoscope::IrrlichtController::enableXXXXXXX(bool value)
 	*
 	* In : bool value : whether or not the specified property should be enabled or disabled.
 	*
 	* This applied for all functions of this form.
+	* The flag applies to every renderable through the override material, see overrideMaterialFlag().
 	*/
+
+
 	void IrrlichtController::enableMipMaps(bool value)
 	{
 		if (value == useMipMaps)
@@ -284,10 +2086,7 @@ namespace kaleidoscope
 
 		useMipMaps = value;
 
-		for (std::list<irr::scene::ISceneNode*>::iterator node = mAllSceneNodes.begin(); node != mAllSceneNodes.end(); ++node)
-		{
-			(*node)->setMaterialFlag(irr::video::EMF_USE_MIP_MAPS, useMipMaps);
-		}
+		overrideMaterialFlag(irr::video::EMF_USE_MIP_MAPS, useMipMaps, DEFAULTMIPMAPS);
 	}
 
 
@@ -300,10 +2099,7 @@ namespace kaleidoscope
 
 		normalizeNormals = value;
 
-		for (std::list<irr::scene::ISceneNode*>::iterator node = mAllSceneNodes.begin(); node != mAllSceneNodes.end(); ++node)
-		{
-			(*node)->setMaterialFlag(irr::video::EMF_NORMALIZE_NORMALS, normalizeNormals);
-		}
+		overrideMaterialFlag(irr::video::EMF_NORMALIZE_NORMALS, normalizeNormals, DEFAULTNORMALIZENORMALS);
 	}
 
 
@@ -316,10 +2112,7 @@ namespace kaleidoscope
 
 		backfaceCulling = value;
 
-		for (std::list<irr::scene::ISceneNode*>::iterator node = mAllSceneNodes.begin(); node != mAllSceneNodes.end(); ++node)
-		{
-			(*node)->setMaterialFlag(irr::video::EMF_BACK_FACE_CULLING, backfaceCulling);
-		}
+		overrideMaterialFlag(irr::video::EMF_BACK_FACE_CULLING, backfaceCulling, DEFAULTBACKFACECULLING);
 	}
 
 
@@ -332,10 +2125,7 @@ namespace kaleidoscope
 
 		frontfaceCulling = value;
 
-		for (std::list<irr::scene::ISceneNode*>::iterator node = mAllSceneNodes.begin(); node != mAllSceneNodes.end(); ++node)
-		{
-			(*node)->setMaterialFlag(irr::video::EMF_FRONT_FACE_CULLING, frontfaceCulling);
-		}
+		overrideMaterialFlag(irr::video::EMF_FRONT_FACE_CULLING, frontfaceCulling, DEFAULTFRONTFACECULLING);
 	}
 
 
@@ -348,9 +2138,11 @@ namespace kaleidoscope
 
 		antiAliasingMode = mode;
 
-		for (std::list<irr::scene::ISceneNode*>::iterator node = mAllSceneNodes.begin(); node != mAllSceneNodes.end(); ++node)
+		mDriver->getOverrideMaterial().Material.AntiAliasing = antiAliasingMode;
+		overrideMaterialFlag(irr::video::EMF_ANTI_ALIASING, static_cast<bool>(antiAliasingMode), static_cast<bool>(DEFAULTANTIALIASING));
+		if (antiAliasingMode == DEFAULTANTIALIASING)
 		{
-			(*node)->setMaterialFlag(irr::video::EMF_ANTI_ALIASING, static_cast<bool>(antiAliasingMode));
+			mDriver->getOverrideMaterial().EnableFlags &= ~static_cast<irr::u32>(irr::video::EMF_ANTI_ALIASING);
 		}
 	}
 
@@ -364,10 +2156,7 @@ namespace kaleidoscope
 
 		isFogEnabled = value;
 
-		for (std::list<irr::scene::ISceneNode*>::iterator node = mAllSceneNodes.begin(); node != mAllSceneNodes.end(); ++node)
-		{
-			(*node)->setMaterialFlag(irr::video::EMF_FOG_ENABLE, isFogEnabled);
-		}
+		overrideMaterialFlag(irr::video::EMF_FOG_ENABLE, isFogEnabled, DEFAULTFOG);
 	}
 
 
@@ -380,10 +2169,7 @@ namespace kaleidoscope
 
 		lighting = value;
 
-		for (std::list<irr::scene::ISceneNode*>::iterator node = mAllSceneNodes.begin(); node != mAllSceneNodes.end(); ++node)
-		{
-			(*node)->setMaterialFlag(irr::video::EMF_LIGHTING, lighting);
-		}
+		overrideMaterialFlag(irr::video::EMF_LIGHTING, lighting, DEFAULTLIGHTING);
 	}
 
 
@@ -396,10 +2182,7 @@ namespace kaleidoscope
 
 		zWriteEnabled = value;
 
-		for (std::list<irr::scene::ISceneNode*>::iterator node = mAllSceneNodes.begin(); node != mAllSceneNodes.end(); ++node)
-		{
-			(*node)->setMaterialFlag(irr::video::EMF_ZWRITE_ENABLE, zWriteEnabled);
-		}
+		overrideMaterialFlag(irr::video::EMF_ZWRITE_ENABLE, zWriteEnabled, DEFAULTZWRITE);
 	}
 
 
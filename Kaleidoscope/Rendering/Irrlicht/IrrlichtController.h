@@ -1,18 +1,29 @@
 #pragma once
 
+#include <Utility/Typedefs.h>
 #include <Synchronization/Locks/Semaphore/Semaphore.h>
+#include <Synchronization/Threads/Thread.h>
 
 #include <Math/Math.h>
 
 #include <irrlicht.h>
 
+#include <deque>
 #include <list>
+#include <vector>
+
+#include <boost/unordered_map.hpp>
 
 namespace kaleidoscope
 {
 	class IrrlichtController
 	{
 	public:
+		// Called on the render thread by processLoads() with the ticket returned when the load was requested.
+		// The asset is NULL if it failed to load. Meshes handed to the callback must be released with releaseMesh().
+		typedef void (*MeshLoadedCallback)(void* userData, U32 ticket, irr::scene::IMesh* mesh);
+		typedef void (*TextureLoadedCallback)(void* userData, U32 ticket, irr::video::ITexture* texture);
+
 		IrrlichtController();
 		~IrrlichtController();
 
@@ -21,6 +32,36 @@ namespace kaleidoscope
 
 		irr::video::ITexture*      getTexture(const irr::io::path& p);
 		irr::scene::IMesh* getMesh(const irr::io::path& p);
+		irr::scene::IMesh* getSimplifiedMesh(irr::scene::IMesh* source, U32 level);
+		void releaseMesh(irr::scene::IMesh* mesh);
+
+		U32 getNumCachedMeshes() const;
+		U64 getResidentMeshBytes() const;
+		void printMeshCache();
+
+		// Residency.
+		// Textures returned by getTexture() are counted per user with acquireTexture()/releaseTexture(), meshes by
+		//	getMesh()/releaseMesh(). Assets nobody uses stay resident until the budget is exceeded, then the least
+		//	recently used are evicted by updateResidency(). Textures Irrlicht loaded on its own, such as those named
+		//	by mesh files, are not tracked and never evicted.
+		void acquireTexture(irr::video::ITexture* texture);
+		void releaseTexture(irr::video::ITexture* texture);
+		void setResidencyBudget(U64 bytes);
+		U64 getResidencyBudget() const;
+		U64 getResidentTextureBytes() const;
+		void updateResidency();
+		U32 purgeUnreferenced();
+		void printResidency();
+
+		bool startLoader(U32 numThreads);
+		void stopLoader();
+		U32 loadMeshAsync(const irr::io::path& p, MeshLoadedCallback callback, void* userData);
+		U32 loadTextureAsync(const irr::io::path& p, TextureLoadedCallback callback, void* userData);
+		void processLoads(F32 budgetMS);
+		U32 getNumPendingLoads();
+
+		irr::scene::IMesh* getPlaceholderMesh() const { return mPlaceholderMesh; };
+		irr::video::ITexture* getPlaceholderTexture() const { return mPlaceholderTexture; };
 
 		irr::scene::ISceneNode*		  addSceneNode();
 		irr::scene::IMeshSceneNode*   addMeshSceneNode();
@@ -29,8 +70,63 @@ namespace kaleidoscope
 
 		void removeSceneNode(irr::scene::ISceneNode* node);
 
+		// Render queue.
+		// Mesh scene nodes submitted each frame are hidden from the scene manager and drawn in its passes, once
+		//	the active camera is updated for the frame, one item per mesh buffer in the order of a 64 bit sort key.
+		//	Opaque items draw in the solid pass sorted by shader, texture, mesh buffer and then front to back,
+		//	transparent items in the transparent pass back to front. The material is only set when it differs from
+		//	the previous item, so runs of the same mesh and material draw as instances.
+		void enableRenderQueue(bool value);
+		bool renderQueueEnabled() const;
+		void submitRenderable(irr::scene::IMeshSceneNode* node);
+
+		// Statistics of the last frame drawn.
+		U32 getNumDrawCalls() const;
+		U32 getNumMaterialSwitches() const;
+		U32 getNumShaderSwitches() const;
+		U32 getNumTextureSwitches() const;
+		U32 getNumBufferSwitches() const;
+		U32 getNumInstanceGroups() const;
+		U32 getNumInstancesDrawn() const;
+		void printRenderStats() const;
+
+		// Static batching.
+		// Static mesh scene nodes are merged into world space mesh buffers, one scene node per chunk of space with a
+		//	buffer per material. A chunk is rebuilt by clearing it with clearStaticBatch(), adding its nodes with
+		//	addToStaticBatch() and calling endStaticBatches(), the other chunks keep their batches. Buffers keep 16 bit
+		//	indices so a material spills into another buffer past 65535 vertices.
+		void setStaticChunkSize(F32 chunkSize);
+		U64 staticChunkKey(const irr::core::vector3df& position) const;
+		bool addToStaticBatch(irr::scene::IMeshSceneNode* node);
+		void endStaticBatches();
+		void clearStaticBatch(U64 chunk);
+		void clearStaticBatches();
+		U32 getNumStaticBatches() const;
+		U32 getNumStaticBuffers() const;
+
 		void drawAll();
 
+		// Scene animation advances by a fixed number of ms per drawAll() instead of by the real time, 0 for real time.
+		void setFixedTimeStep(U32 ms);
+		U32 getFixedTimeStep() const;
+
+		// Offscreen rendering.
+		// With a target created drawAll() renders into the texture instead of presenting to a window, which the
+		//	software driver needs on machines without a display. captureFrame() writes the last frame drawn to
+		//	an image file, from the target if there is one or the back buffer otherwise.
+		bool createOffscreenTarget(U32 width, U32 height);
+		bool hasOffscreenTarget() const;
+		bool captureFrame(const irr::io::path& p);
+
+		// Frame statistics, the frame time covers drawAll() only.
+		U64 getNumFramesDrawn() const;
+		F32 getLastFrameTime() const;
+		F32 getAverageFrameTime() const;
+		U32 getNumSubmittedNodes() const;
+		U32 getNumCulledNodes() const;
+		void resetFrameStats();
+		void printFrameStats() const;
+
 		bool mipMapsEnabled() const;
 		bool normalizedNormalsEnabled() const;
 		bool backfaceCullingEnabled() const;
@@ -50,12 +146,155 @@ namespace kaleidoscope
 		void enableZWrite(bool value);
 
 	private:
+		void clearMeshCache();
+		void trackTexture(irr::video::ITexture* texture, const irr::io::path& p);
+		U32 evictUnreferenced(U64 targetBytes);
+		irr::scene::IMesh* cacheMesh(irr::scene::IAnimatedMesh* mesh, const irr::io::path& p, U64 key, U32 options, U32 refCount);
+		void addToMeshCache(irr::scene::IMesh* mesh, const irr::io::path& p, U64 key, U32 options, U32 refCount);
+		void overrideMaterialFlag(irr::video::E_MATERIAL_FLAG flag, bool value, bool meshDefault);
+
+		struct LoadWaiter
+		{
+			U32 mTicket;
+			MeshLoadedCallback mMeshCallback;
+			TextureLoadedCallback mTextureCallback;
+			void* mUserData;
+		};
+
+		// A file being loaded, every request for the same asset while it is in flight waits on the same load.
+		struct AssetLoad
+		{
+			bool mIsMesh;
+			irr::io::path mPath;
+			U64 mKey;
+			U32 mOptions;
+			std::vector<LoadWaiter> mWaiters;
+			std::vector<U8> mData;	// The file contents, read by a loader thread.
+			bool mRead;				// false if the file is to be opened by path instead.
+		};
+
+		struct RenderItem
+		{
+			U64 mKey;
+			irr::scene::IMeshSceneNode* mNode;
+			U32 mBuffer;
+		};
+
+		// Registered in the scene managers solid and transparent passes to draw the queue.
+		class RenderQueueNode;
+
+		void buildRenderQueue();
+		void drawRenderQueue(bool transparent);
+		static bool RenderItemOrder(const RenderItem& lhs, const RenderItem& rhs);
+
+		struct StaticChunk
+		{
+			std::vector<irr::scene::SMeshBufferTangents*> mBuffers;
+		};
+		static const U32 MAXBATCHVERTICES = 65535;
+
+		U32 queueLoad(bool isMesh, const irr::io::path& p, const LoadWaiter& waiter);
+		void finishLoad(AssetLoad* load);
+		static int LoaderThread(void* controller);
+		static const U32 MESHLOAD = 0;		// Every mesh carries the default material flags, so meshes share one set of options.
+		static const U32 TEXTURELOAD = 1 << 16;
+		static const U32 LODSHIFT = 17;		// Simplified meshes keep the options of their source with the level in bits 17 to 19.
+		static const U32 MAXLODLEVEL = 3;
+
+		// A mesh processed by getMesh(), shared by every user that asks for the same file with the same options.
+		struct CachedMesh
+		{
+			irr::scene::IMesh* mMesh;
+			irr::io::path mPath;
+			U32 mOptions;
+			U32 mRefCount;
+			U64 mBytes;
+			U64 mLastUsed;	// The residency frame the last user released the mesh on.
+		};
+
+		// A texture loaded by the controller.
+		struct ResidentTexture
+		{
+			irr::io::path mPath;
+			U32 mRefCount;
+			U64 mBytes;
+			U64 mLastUsed;
+		};
+
 		irr::IrrlichtDevice* mDevice;
 		irr::scene::ISceneManager* mSmgr;
 		irr::video::IVideoDriver* mDriver;
 		kaleidoscope::Semaphore useSem;
 
-		std::list<irr::scene::ISceneNode*> mAllSceneNodes;
+		// Irrlicht removes a child with a linear search of its parents children, so mesh scene nodes are spread over
+		//	empty parent nodes of at most MESHNODESPERBLOCK children instead of all sitting under the root.
+		irr::scene::ISceneNode* meshNodeBlock();
+		static const U32 MESHNODESPERBLOCK = 256;
+		std::vector<irr::scene::ISceneNode*> mMeshNodeBlocks;
+		U32 mOpenMeshNodeBlock;	// The block new nodes go to while it has room.
+
+		boost::unordered_map<U64, CachedMesh> mMeshCache;		// Keyed by the path hash in the high bits and the options in the low bits.
+		boost::unordered_map<irr::scene::IMesh*, U64> mMeshKeys;
+		U64 mResidentMeshBytes;
+
+		boost::unordered_map<irr::video::ITexture*, ResidentTexture> mTextureCache;
+		U64 mResidentTextureBytes;
+		U64 mResidencyBudget;
+		U64 mResidencyFrame;	// Counts updateResidency() calls.
+		U64 mNumEvictions;
+		U64 mEvictedBytes;
+		bool mOverBudget;		// The assets in use alone exceed the budget, logged once each time it happens.
+
+		// Loads move from the read queue, through a loader thread, to the ready queue and are finished by processLoads().
+		// Everything here is guarded by loadSem, readSignal counts the loads waiting in the read queue.
+		std::deque<AssetLoad*> mReadQueue;
+		std::deque<AssetLoad*> mReadyQueue;
+		boost::unordered_map<U64, AssetLoad*> mPendingLoads;
+		std::vector<Thread> mLoaderThreads;
+		kaleidoscope::Semaphore loadSem;
+		kaleidoscope::Semaphore readSignal;
+		U32 mNextTicket;
+
+		// Cleared every frame, the vectors keep their memory.
+		std::vector<RenderItem> mRenderQueue;
+		std::vector<irr::scene::IMeshSceneNode*> mQueuedNodes;
+		bool useRenderQueue;
+
+		U32 mNumDrawCalls;
+		U32 mNumMaterialSwitches;
+		U32 mNumShaderSwitches;
+		U32 mNumTextureSwitches;
+		U32 mNumBufferSwitches;
+		U32 mNumInstanceGroups;
+		U32 mNumInstancesDrawn;
+
+		irr::video::ITexture* mOffscreenTarget;
+		U32 mFixedTimeStep;		// ms, 0 while the timer follows the real time.
+		U64 mNumFramesDrawn;
+		F32 mLastFrameTime;		// ms
+		F64 mTotalFrameTime;	// ms, Since the stats were last reset.
+		U32 mNumSubmittedNodes;
+		U32 mNumCulledNodes;
+		U32 mCulledThisFrame;	// Counted by buildRenderQueue() until drawAll() ends the frame.
+
+		boost::unordered_map<U64, StaticChunk> mStaticChunks;	// The chunks being built.
+		boost::unordered_map<U64, irr::scene::IMeshSceneNode*> mStaticBatchNodes;	// The built chunks.
+		F32 mStaticChunkSize;
+		U32 mNumStaticBuffers;
+
+		irr::scene::IMesh* mPlaceholderMesh;
+		irr::video::ITexture* mPlaceholderTexture;
+
+		// The material flags getMesh() bakes into every mesh, toggles that differ from them go through the
+		//	driver's override material.
+		static const bool DEFAULTMIPMAPS = true;
+		static const bool DEFAULTNORMALIZENORMALS = true;
+		static const bool DEFAULTBACKFACECULLING = true;
+		static const bool DEFAULTFRONTFACECULLING = false;
+		static const U8 DEFAULTANTIALIASING = irr::video::EAAM_SIMPLE | irr::video::EAAM_LINE_SMOOTH;
+		static const bool DEFAULTFOG = false;
+		static const bool DEFAULTLIGHTING = false;
+		static const bool DEFAULTZWRITE = true;
 
 		bool useMipMaps;
 		bool normalizeNormals;
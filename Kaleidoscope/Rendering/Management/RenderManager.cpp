@@ -13,6 +13,8 @@
 
 #include <Components/Renderable/Renderable.h>
 #include <Components/Light/Light.h>
+#include <Components/LuaScript/LuaScriptHandle.h>
+#include <Components/Transform/TransformHandle.h>
 
 #include <Debug/Logging/SDLLogManager.h>
 extern kaleidoscope::SDLLogManager gLogManager;
@@ -20,7 +22,7 @@ extern kaleidoscope::SDLLogManager gLogManager;
 namespace kaleidoscope
 {
 
-	RenderManager::RenderManager()
+	RenderManager::RenderManager() : mRendererType(DEFAULTRENDERER)
 	{
 	}
 
@@ -44,6 +46,19 @@ namespace kaleidoscope
 	*			  false on failure.
 	*
 	* Initializes everything the rendering system needs to function.
+	*
+	* renderer = "opengl" | "null" | "software" The backend to draw with, "null" opens no window and draws nothing so the
+	*			 engine can run on machines without a display or GPU. "software" opens no window either and rasterizes
+	*			 on the CPU into an offscreen target of the configured size, it needs an Irrlicht built with
+	*			 _IRR_COMPILE_WITH_CONSOLE_DEVICE_, which Irrlicht's default IrrCompileConfig.h leaves out.
+	* loader threads = U32 The number of threads reading asset files in the background.
+	* load budget = F32 ms, The time spent each frame turning loaded files into meshes and textures.
+	* residency budget = U32 MB, The memory meshes and textures may hold before unused ones are evicted.
+	* render queue = bool Whether renderables are drawn sorted by state through the render queue, true by default.
+	* instancing = bool The older name of render queue, read when render queue is not given.
+	* min instances = U32 No longer used, runs of two or more renderables sharing a mesh and material draw as instances.
+	* fixed timestep = U32 ms, When above 0 the scene's animations advance by this much every frame instead of by the
+	*				   real time passed, so captured frames repeat between runs. 0 by default.
 	*/
 	bool RenderManager::startUp(boost::optional<const boost::property_tree::ptree&> info,
 								boost::optional<const boost::property_tree::ptree&> cameraInfo,
@@ -56,6 +71,7 @@ namespace kaleidoscope
 		boost::optional<std::string> wndSz = info->get_optional<std::string>("size");
 		boost::optional<std::string> wndDM = info->get_optional<std::string>("display mode");
 		boost::optional<std::string> wndRM = info->get_optional<std::string>("swap mode");
+		boost::optional<std::string> renderer = info->get_optional<std::string>("renderer");
 
 		std::string wT;
 		math::vec2 wS;
@@ -64,7 +80,7 @@ namespace kaleidoscope
 
 		(title ? wT = *title : wT = DEFAULTTITLE);
 		bool b123;
-		(wndSz ? wS = stringToVec2(wndSz->c_str(), b123) : DEFAULTSIZE );
+		(wndSz ? wS = stringToVec2(wndSz->c_str(), b123) : wS = DEFAULTSIZE );
 		
 		if (wndDM)
 		{
@@ -110,37 +126,60 @@ namespace kaleidoscope
 			wSM = DEFAULTSWAPMODE;
 		}
 
-		// Create the window to render to.
-		mWindow = GLWindow();
-		if (!mWindow.init(wT.c_str(), wDM, wSM, wS))
+		mRendererType = DEFAULTRENDERER;
+		if (renderer)
 		{
-			return false;
+			if (renderer->compare("opengl") == 0)
+			{
+				mRendererType = RT_OPENGL;
+			}
+			else if (renderer->compare("null") == 0)
+			{
+				mRendererType = RT_NULL;
+			}
+			else if (renderer->compare("software") == 0)
+			{
+				mRendererType = RT_SOFTWARE;
+			}
+			else
+			{
+				gLogManager.log("Unknown renderer \"%s\", using the default", renderer->c_str());
+			}
 		}
-		mWindow.setClearColor(math::vec4(0.0f, 0.5f, 0.5f, 1.0f));
 
 		mViewCamera = CameraHandle::null;
 		mCullCamera = CameraHandle::null;
 
-		SDL_SysWMinfo nfo;
-		SDL_version compiledVersion;
-		SDL_VERSION(&compiledVersion);
-		nfo.version = compiledVersion;
-		SDL_bool b =  SDL_GetWindowWMInfo( mWindow.getWindow(), &nfo);
-		if (b != SDL_TRUE)
+		bool created = false;
+		switch (mRendererType)
 		{
+		case RT_NULL:
+			created = createNullDevice(wS);
+			break;
+		case RT_SOFTWARE:
+			created = createSoftwareDevice(wS);
+			break;
+		default:
+			created = createWindowedDevice(wT, wDM, wSM, wS);
+			break;
+		}
+		if (created == false)
+		{
+			gLogManager.log("Irrlicht setup Failed");
 			return false;
 		}
 
-		// Initialize Irrlicht Rendering System
-		// Give Irrlicht access to the window.
-		irr::SIrrlichtCreationParameters creationParams;
-		creationParams.DriverType = irr::video::EDT_OPENGL;
-		creationParams.WindowId = reinterpret_cast<void*>(nfo.info.win.window);
-		creationParams.Vsync = true;
-
-		if (mIrrController.createDevice(creationParams) == false)
+		mLoadBudget = info->get<F32>("load budget", DEFAULTLOADBUDGET);
+		mIrrController.setResidencyBudget(static_cast<U64>(info->get<U32>("residency budget", DEFAULTRESIDENCYBUDGET)) * 1024 * 1024);
+		mIrrController.enableRenderQueue(info->get<bool>("render queue", info->get<bool>("instancing", true)));
+		mIrrController.setFixedTimeStep(info->get<U32>("fixed timestep", 0));
+		if (info->get_optional<U32>("min instances"))
 		{
-			gLogManager.log("Irrlicht setup Failed");
+			gLogManager.log("The renderer option min instances is no longer used and is ignored");
+		}
+		if (mIrrController.startLoader(info->get<U32>("loader threads", DEFAULTLOADERTHREADS)) == false)
+		{
+			gLogManager.log("Asset loader setup Failed");
 			return false;
 		}
 
@@ -178,6 +217,121 @@ namespace kaleidoscope
 	}
 
 
+	/*
+	* bool kaleidoscope::RenderManager::createWindowedDevice(const std::string& title, GLWindow::DisplayType displayType,
+	*														  GLWindow::SwapMode swapMode, const math::vec2& size)
+	*
+	* In: string : The window title.
+	* In: DisplayType : Whether the window is fullscreen.
+	* In: SwapMode : How the window refreshes.
+	* In: vec2 : The size of the window as (w, h).
+	* Out: bool : true on success.
+	*			  false on failure.
+	*
+	* Opens the SDL window and gives Irrlicht an OpenGL device drawing into it.
+	*/
+	bool RenderManager::createWindowedDevice(const std::string& title, GLWindow::DisplayType displayType, GLWindow::SwapMode swapMode, const math::vec2& size)
+	{
+		// Create the window to render to.
+		mWindow = GLWindow();
+		if (!mWindow.init(title.c_str(), displayType, swapMode, size))
+		{
+			return false;
+		}
+		mWindow.setClearColor(math::vec4(0.0f, 0.5f, 0.5f, 1.0f));
+
+		SDL_SysWMinfo nfo;
+		SDL_version compiledVersion;
+		SDL_VERSION(&compiledVersion);
+		nfo.version = compiledVersion;
+		SDL_bool b =  SDL_GetWindowWMInfo( mWindow.getWindow(), &nfo);
+		if (b != SDL_TRUE)
+		{
+			return false;
+		}
+
+		// Initialize Irrlicht Rendering System
+		// Give Irrlicht access to the window.
+		irr::SIrrlichtCreationParameters creationParams;
+		creationParams.DriverType = irr::video::EDT_OPENGL;
+#if defined(SDL_VIDEO_DRIVER_WINDOWS)
+		creationParams.WindowId = reinterpret_cast<void*>(nfo.info.win.window);
+#elif defined(SDL_VIDEO_DRIVER_X11)
+		creationParams.WindowId = reinterpret_cast<void*>(nfo.info.x11.window);
+#else
+		gLogManager.log("Irrlicht can not draw into this platforms windows, use the null renderer");
+		return false;
+#endif
+		creationParams.Vsync = true;
+
+		return mIrrController.createDevice(creationParams);
+	}
+
+
+	/*
+	* bool kaleidoscope::RenderManager::createNullDevice(const math::vec2& size)
+	*
+	* In: vec2 : The resolution to report as the screen size as (w, h).
+	* Out: bool : true on success.
+	*			  false on failure.
+	*
+	* Gives Irrlicht its null driver without opening a window.
+	* Scene nodes, meshes and textures are still created so the components keep their state, draws do nothing.
+	*/
+	bool RenderManager::createNullDevice(const math::vec2& size)
+	{
+		mHeadlessResolution = size;
+
+		irr::SIrrlichtCreationParameters creationParams;
+		creationParams.DriverType = irr::video::EDT_NULL;
+		creationParams.WindowSize = irr::core::dimension2d<irr::u32>(static_cast<irr::u32>(size.x), static_cast<irr::u32>(size.y));
+
+		return mIrrController.createDevice(creationParams);
+	}
+
+
+	/*
+	* bool kaleidoscope::RenderManager::createSoftwareDevice(const math::vec2& size)
+	*
+	* In: vec2 : The size of the offscreen target as (w, h).
+	* Out: bool : true on success.
+	*			  false on failure.
+	*
+	* Gives Irrlicht the Burning's Video software driver on its console device, which needs no display, and
+	*	draws every frame into an offscreen target.
+	* The console device only exists in Irrlicht builds with _IRR_COMPILE_WITH_CONSOLE_DEVICE_ defined.
+	* Scene animation follows the real time unless the "fixed timestep" option is set.
+	*/
+	bool RenderManager::createSoftwareDevice(const math::vec2& size)
+	{
+		mHeadlessResolution = size;
+
+#if !defined(_IRR_COMPILE_WITH_CONSOLE_DEVICE_)
+		gLogManager.log("The software renderer needs Irrlicht built with _IRR_COMPILE_WITH_CONSOLE_DEVICE_");
+		return false;
+#else
+		irr::SIrrlichtCreationParameters creationParams;
+		creationParams.DriverType = irr::video::EDT_BURNINGSVIDEO;
+		creationParams.DeviceType = irr::EIDT_CONSOLE;
+		creationParams.WindowSize = irr::core::dimension2d<irr::u32>(static_cast<irr::u32>(size.x), static_cast<irr::u32>(size.y));
+
+		if (mIrrController.createDevice(creationParams) == false)
+		{
+			gLogManager.log("Irrlicht could not create its console device with the Burning's Video driver");
+			return false;
+		}
+
+		if (mIrrController.createOffscreenTarget(static_cast<U32>(size.x), static_cast<U32>(size.y)) == false)
+		{
+			gLogManager.log("Offscreen render target setup Failed");
+			return false;
+		}
+
+		return true;
+#endif
+	}
+
+
 	/*
 	* bool kaleidoscope::RenderManager::shutDown()
 	*
@@ -185,6 +339,8 @@ namespace kaleidoscope
 	*/
 	bool RenderManager::shutDown()
 	{
+		// No load may finish into a component that is being shut down.
+		mIrrController.stopLoader();
 
 		kaleidoscope::CameraHandle::ShutDown();
 		kaleidoscope::RenderableHandle::ShutDown();
@@ -204,11 +360,22 @@ namespace kaleidoscope
 	*/
 	void RenderManager::render()
 	{
+		// Scripts updated by distance and renderable levels of detail measure from the camera being rendered from.
+		if (mViewCamera.valid() && mViewCamera.transform().valid())
+		{
+			LuaScriptHandle::SetUpdateLODOrigin(mViewCamera.transform().getWorldPosition());
+			RenderableHandle::SetLODCamera(mViewCamera.transform().getWorldPosition(), mViewCamera.getFieldOfView());
+		}
+
+		mIrrController.processLoads(mLoadBudget);
+
 		CameraHandle::UpdateAll();
 		RenderableHandle::UpdateAll();
 		LightHandle::UpdateAll();
 
 		mIrrController.drawAll();
+
+		mIrrController.updateResidency();
 	}
 
 	/*
@@ -240,9 +407,48 @@ namespace kaleidoscope
 	*/
 	math::vec2 RenderManager::getScreenDimensions() const
 	{
+		if (isHeadless())
+		{
+			return mHeadlessResolution;
+		}
 		return mWindow.getRenderResolution();
 	}
 
+	/*
+	* The backend chosen by the "renderer" property, headless when there is no window.
+	*/
+	RenderManager::RendererType RenderManager::getRendererType() const { return mRendererType; }
+	bool RenderManager::isHeadless() const { return mRendererType == RT_NULL || mRendererType == RT_SOFTWARE; }
+
+	/*
+	* bool kaleidoscope::RenderManager::captureFrame(const char * path)
+	*
+	* In: const char * : The image file to write, the extension picks the format.
+	* Out: bool : true on success.
+	*			  false on failure, always with the null renderer.
+	*
+	* Writes the last frame drawn to disk.
+	*/
+	bool RenderManager::captureFrame(const char * path)
+	{
+		if (mRendererType == RT_NULL)
+		{
+			return false;
+		}
+		return mIrrController.captureFrame(path);
+	}
+
+	/*
+	* The time spent drawing frames and how much of the scene was culled in the last one.
+	*/
+	U64 RenderManager::getNumFramesDrawn() const { return mIrrController.getNumFramesDrawn(); }
+	F32 RenderManager::getLastFrameTime() const { return mIrrController.getLastFrameTime(); }
+	F32 RenderManager::getAverageFrameTime() const { return mIrrController.getAverageFrameTime(); }
+	U32 RenderManager::getNumSubmittedNodes() const { return mIrrController.getNumSubmittedNodes(); }
+	U32 RenderManager::getNumCulledNodes() const { return mIrrController.getNumCulledNodes(); }
+	void RenderManager::resetFrameStats() { mIrrController.resetFrameStats(); }
+	void RenderManager::printFrameStats() const { mIrrController.printFrameStats(); }
+
 	CameraHandle RenderManager::getCullCamera() const { return mCullCamera; }
 
 	/*
@@ -252,8 +458,45 @@ namespace kaleidoscope
 	void RenderManager::disableLighting() { mIrrController.enableLighting(true); }
 	bool RenderManager::isLightingEnabled() const { return mIrrController.lightingEnabled(); }
 
+	/*
+	* Report the meshes shared through the Irrlicht controllers mesh cache.
+	*/
+	U64 RenderManager::getResidentMeshBytes() const { return mIrrController.getResidentMeshBytes(); }
+	void RenderManager::printMeshCache() { mIrrController.printMeshCache(); }
+
+	/*
+	* The number of meshes and textures still being loaded in the background.
+	*/
+	U32 RenderManager::getNumPendingLoads() { return mIrrController.getNumPendingLoads(); }
+
+	/*
+	* Report and trim the meshes and textures held by the Irrlicht controller.
+	*/
+	U64 RenderManager::getResidentTextureBytes() const { return mIrrController.getResidentTextureBytes(); }
+	U32 RenderManager::purgeUnreferencedAssets() { return mIrrController.purgeUnreferenced(); }
+	void RenderManager::printResidency() { mIrrController.printResidency(); }
+
+	/*
+	* The draw calls, state switches and instances of the last frame.
+	*/
+	U32 RenderManager::getNumDrawCalls() const { return mIrrController.getNumDrawCalls(); }
+	U32 RenderManager::getNumMaterialSwitches() const { return mIrrController.getNumMaterialSwitches(); }
+	U32 RenderManager::getNumInstanceGroups() const { return mIrrController.getNumInstanceGroups(); }
+	U32 RenderManager::getNumInstancesDrawn() const { return mIrrController.getNumInstancesDrawn(); }
+	void RenderManager::printRenderStats() const { mIrrController.printRenderStats(); }
+
+	/*
+	* The scene nodes and mesh buffers the static renderables were merged into.
+	*/
+	U32 RenderManager::getNumStaticBatches() const { return mIrrController.getNumStaticBatches(); }
+	U32 RenderManager::getNumStaticBuffers() const { return mIrrController.getNumStaticBuffers(); }
+
+	const RenderManager::RendererType RenderManager::DEFAULTRENDERER = RenderManager::RT_OPENGL;
 	const char * RenderManager::DEFAULTTITLE = "Kaleidoscope Engine";
 	const math::vec2 RenderManager::DEFAULTSIZE(640.0f, 480.0f);
 	const GLWindow::DisplayType RenderManager::DEFAULTDISPLAYTYPE = GLWindow::DT_WINDOWED;
 	const GLWindow::SwapMode RenderManager::DEFAULTSWAPMODE = GLWindow::SM_TEAR;
+	const U32 RenderManager::DEFAULTLOADERTHREADS = 2;
+	const F32 RenderManager::DEFAULTLOADBUDGET = 4.0f;
+	const U32 RenderManager::DEFAULTRESIDENCYBUDGET = 256;
 }
\ No newline at end of file
@@ -22,6 +22,13 @@ namespace kaleidoscope
 	class RenderManager
 	{
 	public:
+		enum RendererType
+		{
+			RT_OPENGL,
+			RT_NULL,		// No window, Irrlichts null driver, the components update but nothing is drawn.
+			RT_SOFTWARE		// No window, Burning's Video draws into an offscreen target frames can be captured from.
+		};
+
 		RenderManager();
 		~RenderManager();
 
@@ -43,11 +50,44 @@ namespace kaleidoscope
 
 		math::vec2 getScreenDimensions() const;
 
+		RendererType getRendererType() const;
+		bool isHeadless() const;
+
+		bool captureFrame(const char * path);
+		U64 getNumFramesDrawn() const;
+		F32 getLastFrameTime() const;
+		F32 getAverageFrameTime() const;
+		U32 getNumSubmittedNodes() const;
+		U32 getNumCulledNodes() const;
+		void resetFrameStats();
+		void printFrameStats() const;
+
 		void enableLighting();
 		void disableLighting();
 		bool isLightingEnabled() const;
 
+		U64 getResidentMeshBytes() const;
+		void printMeshCache();
+
+		U32 getNumPendingLoads();
+
+		U64 getResidentTextureBytes() const;
+		U32 purgeUnreferencedAssets();
+		void printResidency();
+
+		U32 getNumDrawCalls() const;
+		U32 getNumMaterialSwitches() const;
+		U32 getNumInstanceGroups() const;
+		U32 getNumInstancesDrawn() const;
+		void printRenderStats() const;
+		U32 getNumStaticBatches() const;
+		U32 getNumStaticBuffers() const;
+
 	private:
+		bool createWindowedDevice(const std::string& title, GLWindow::DisplayType displayType, GLWindow::SwapMode swapMode, const math::vec2& size);
+		bool createNullDevice(const math::vec2& size);
+		bool createSoftwareDevice(const math::vec2& size);
+
 		GLWindow mWindow;
 		IrrlichtController mIrrController;
 
@@ -58,10 +98,19 @@ namespace kaleidoscope
 		CameraHandle mViewCamera;
 		CameraHandle mCullCamera;
 
+		RendererType mRendererType;
+		math::vec2 mHeadlessResolution;
+
+		F32 mLoadBudget;	// ms, The time render() spends finishing asynchronous loads each frame.
+
+		static const RendererType DEFAULTRENDERER;
 		static const char * DEFAULTTITLE;
 		static const math::vec2 DEFAULTSIZE;
 		static const GLWindow::DisplayType DEFAULTDISPLAYTYPE;
 		static const GLWindow::SwapMode DEFAULTSWAPMODE;
+		static const U32 DEFAULTLOADERTHREADS;
+		static const F32 DEFAULTLOADBUDGET;
+		static const U32 DEFAULTRESIDENCYBUDGET;
 	};
 }
 
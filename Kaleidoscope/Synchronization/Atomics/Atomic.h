@@ -0,0 +1,121 @@
+#pragma  once
+#include <SDL_atomic.h>
+
+#include <Utility/Typedefs.h>
+
+namespace kaleidoscope
+{
+	// This class is a shell for the SDL atomic operations.
+	// Every operation is a full memory barrier.
+	// Atomics and SpinLocks are zero initialized, so they are usable from static initialization without an init call.
+	class Atomic
+	{
+	public:
+		typedef SDL_SpinLock SpinLock;
+
+
+		/*
+		* I32 kaleidoscope::Atomic::Atomic_get(kaleidoscope::Atomic* a)
+		*
+		* In: Atomic* a : The atomic to read.
+		* Out: I32 : The current value.
+		*/
+		static I32 Atomic_get(Atomic* a)
+		{
+			return SDL_AtomicGet(&a->mValue);
+		}
+
+
+		/*
+		* I32 kaleidoscope::Atomic::Atomic_set(kaleidoscope::Atomic* a, I32 value)
+		*
+		* In: Atomic* a : The atomic to write.
+		* In: I32 value : The new value.
+		* Out: I32 : The previous value.
+		*/
+		static I32 Atomic_set(Atomic* a, I32 value)
+		{
+			return SDL_AtomicSet(&a->mValue, value);
+		}
+
+
+		/*
+		* I32 kaleidoscope::Atomic::Atomic_add(kaleidoscope::Atomic* a, I32 value)
+		*
+		* In: Atomic* a : The atomic to add to.
+		* In: I32 value : The amount to add.
+		* Out: I32 : The value before the add.
+		*/
+		static I32 Atomic_add(Atomic* a, I32 value)
+		{
+			return SDL_AtomicAdd(&a->mValue, value);
+		}
+
+
+		/*
+		* bool kaleidoscope::Atomic::Atomic_compareAndSwap(kaleidoscope::Atomic* a, I32 oldValue, I32 newValue)
+		*
+		* In: Atomic* a : The atomic to update.
+		* In: I32 oldValue : The value a must hold for the swap to happen.
+		* In: I32 newValue : The value to store.
+		* Out: bool : true if the swap happened.
+		*/
+		static bool Atomic_compareAndSwap(Atomic* a, I32 oldValue, I32 newValue)
+		{
+			return SDL_AtomicCAS(&a->mValue, oldValue, newValue) == SDL_TRUE;
+		}
+
+
+		/*
+		* void* kaleidoscope::Atomic::Atomic_getPtr(void** p)
+		*
+		* In: void** p : The pointer to read.
+		* Out: void* : The current value.
+		*/
+		static void* Atomic_getPtr(void** p)
+		{
+			return SDL_AtomicGetPtr(p);
+		}
+
+
+		/*
+		* void* kaleidoscope::Atomic::Atomic_setPtr(void** p, void* value)
+		*
+		* In: void** p : The pointer to write.
+		* In: void* value : The new value.
+		* Out: void* : The previous value.
+		*/
+		static void* Atomic_setPtr(void** p, void* value)
+		{
+			return SDL_AtomicSetPtr(p, value);
+		}
+
+
+		/*
+		* bool kaleidoscope::Atomic::Atomic_compareAndSwapPtr(void** p, void* oldValue, void* newValue)
+		*
+		* In: void** p : The pointer to update.
+		* In: void* oldValue : The value p must hold for the swap to happen.
+		* In: void* newValue : The value to store.
+		* Out: bool : true if the swap happened.
+		*/
+		static bool Atomic_compareAndSwapPtr(void** p, void* oldValue, void* newValue)
+		{
+			return SDL_AtomicCASPtr(p, oldValue, newValue) == SDL_TRUE;
+		}
+
+
+		// Spin locks are for very short critical sections only, a waiting thread burns its time slice.
+		static void SpinLock_lock(SpinLock* l)
+		{
+			SDL_AtomicLock(l);
+		}
+
+		static void SpinLock_unlock(SpinLock* l)
+		{
+			SDL_AtomicUnlock(l);
+		}
+
+		SDL_atomic_t mValue;
+	};
+}
@@ -1,38 +1,135 @@
 #include <Utility/StringID/StringId.h>
 
+#include <Synchronization/Atomics/Atomic.h>
+
+#include <SDL_log.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
 namespace kaleidoscope
 {
+	// The string table is an open addressed hash table of pointers to records in an arena.
+	// A slot is claimed by compare and swapping its pointer from NULL, a record is fully written before it is
+	//	published so readers never take a lock. Records are never removed until shutdown.
+	// Everything here is zero initialized, so strings can be interned during static initialization.
+	struct StringRecord
+	{
+		StringID mSid;
+		char mString[1]; // Allocated to the length of the string.
+	};
+
+	struct ArenaChunk
+	{
+		ArenaChunk* mNext;
+		U32 mSize;
+		Atomic mUsed;
+		// The chunks bytes follow.
+	};
+
+	// Byte at a time crc32 table, built from the constexpr entries so it is constant initialized.
+#define KALEIDOSCOPE_CRC1(n) crc32::byteEntry((n), 8)
+#define KALEIDOSCOPE_CRC4(n) KALEIDOSCOPE_CRC1(n), KALEIDOSCOPE_CRC1((n) + 1), KALEIDOSCOPE_CRC1((n) + 2), KALEIDOSCOPE_CRC1((n) + 3)
+#define KALEIDOSCOPE_CRC16(n) KALEIDOSCOPE_CRC4(n), KALEIDOSCOPE_CRC4((n) + 4), KALEIDOSCOPE_CRC4((n) + 8), KALEIDOSCOPE_CRC4((n) + 12)
+#define KALEIDOSCOPE_CRC64(n) KALEIDOSCOPE_CRC16(n), KALEIDOSCOPE_CRC16((n) + 16), KALEIDOSCOPE_CRC16((n) + 32), KALEIDOSCOPE_CRC16((n) + 48)
+	static const U32 crcTable[256] = { KALEIDOSCOPE_CRC64(0u), KALEIDOSCOPE_CRC64(64u), KALEIDOSCOPE_CRC64(128u), KALEIDOSCOPE_CRC64(192u) };
+#undef KALEIDOSCOPE_CRC64
+#undef KALEIDOSCOPE_CRC16
+#undef KALEIDOSCOPE_CRC4
+#undef KALEIDOSCOPE_CRC1
+
+	struct RecordOrder
+	{
+		bool operator()(const StringRecord* lhs, const StringRecord* rhs) const { return lhs->mSid < rhs->mSid; }
+	};
 
-	static boost::unordered_map<StringID, const char *> gStringIDTable;
-	static Semaphore internSem;
+	static const U32 TABLESIZE = 1 << 17;	// Must be a power of two.
+	static const U32 TABLEMASK = TABLESIZE - 1;
+	static const U32 MAXPROBES = 256;		// Past this many slots a string is treated as if the table were full.
+	static const U32 CHUNKSIZE = 64 * 1024;
+
+	static void* gStringTable[TABLESIZE];
+	static void* gArenaHead = NULL;		// ArenaChunk*, the chunk records are bumped out of.
+	static Atomic::SpinLock arenaLock = 0;	// Only taken to add a chunk.
+	static Atomic gNumStrings;
+	static Atomic gNumCollisions;
 	static bool initialized = false;
 
 
 	/*
-	 * bool kaleidoscope::StringIDInit()
+	 * void* kaleidoscope::arenaAllocate(U32 size)
 	 *
-	 * Starts up the StringID system
-	 * returns true if start up was successful or if startup was already completed.
-	 * returns false if startup failed.
+	 * Bump allocates size bytes from the current arena chunk, adding a chunk when it is full.
+	 * The bytes are 8 byte aligned.
+	 * Returns NULL if a new chunk could not be allocated.
 	 */
-	bool StringIDInit()
+	static void* arenaAllocate(U32 size)
 	{
-		if (!initialized)
-		{
-			initialized = true;
+		size = (size + 7) & ~7u;
 
-			I32 success = Semaphore::Semaphore_init(&internSem, 1);
-			if (success == 0)
+		for (;;)
+		{
+			ArenaChunk* chunk = static_cast<ArenaChunk*>(Atomic::Atomic_getPtr(&gArenaHead));
+			if (chunk != NULL)
 			{
-				return true;
+				const U32 offset = static_cast<U32>(Atomic::Atomic_add(&chunk->mUsed, static_cast<I32>(size)));
+				if (offset + size <= chunk->mSize)
+				{
+					return reinterpret_cast<U8*>(chunk + 1) + offset;
+				}
 			}
-			else
+
+			// The chunk is full, the first thread in replaces it and the rest retry on the new chunk.
+			Atomic::SpinLock_lock(&arenaLock);
+			if (Atomic::Atomic_getPtr(&gArenaHead) == chunk)
 			{
-				initialized = false;
-				return false;
+				const U32 chunkSize = (size > CHUNKSIZE ? size : CHUNKSIZE);
+				ArenaChunk* n = static_cast<ArenaChunk*>(std::malloc(sizeof(ArenaChunk) + chunkSize));
+				if (n == NULL)
+				{
+					Atomic::SpinLock_unlock(&arenaLock);
+					return NULL;
+				}
+				n->mNext = chunk;
+				n->mSize = chunkSize;
+				Atomic::Atomic_set(&n->mUsed, 0);
+				Atomic::Atomic_setPtr(&gArenaHead, n);
 			}
+			Atomic::SpinLock_unlock(&arenaLock);
+		}
+	}
+
+
+	/*
+	 * bool kaleidoscope::StringIDInit()
+	 *
+	 * Starts up the StringID system
+	 * The table needs no setup, this remains so systems can require the StringID system during their own startup.
+	 * With KALEIDOSCOPE_STRIP_STRINGS the first call loads the string database, paths, script file names and event
+	 *	names are only known through it.
+	 * returns true.
+	 *		   false if the string database is needed and could not be loaded.
+	 */
+	bool StringIDInit()
+	{
+		if (initialized)
+		{
+			return true;
 		}
 
+#ifdef KALEIDOSCOPE_STRIP_STRINGS
+		if (!StringIDLoadDatabase(KALEIDOSCOPE_STRINGID_DATABASE))
+		{
+			SDL_LogError(SDL_LOG_CATEGORY_ERROR, "StringID database %s could not be loaded, save one from a debug build", KALEIDOSCOPE_STRINGID_DATABASE);
+			return false;
+		}
+#endif
+
+		initialized = true;
 		return true;
 	}
 
@@ -41,6 +138,8 @@ namespace kaleidoscope
 	 * bool kaleidoscope::StringIDShutdown()
 	 *
 	 * Shuts down the StringID system and clears the record of stored strings.
+	 * Debug builds first save the string database for builds with KALEIDOSCOPE_STRIP_STRINGS.
+	 * No other thread may be using the StringID system while it shuts down.
 	 * returns true if shutdown was successful or if shutdown was already completed.
 	 */
 	bool StringIDShutdown()
@@ -48,8 +147,25 @@ namespace kaleidoscope
 		if (initialized)
 		{
 			initialized = false;
-			Semaphore::Semaphore_destroy(&internSem);
-			gStringIDTable.clear();
+
+#if defined(KALEIDOSCOPE_STRINGID_COLLISIONS) && !defined(KALEIDOSCOPE_STRIP_STRINGS)
+			if (!StringIDSaveDatabase(KALEIDOSCOPE_STRINGID_DATABASE))
+			{
+				SDL_LogError(SDL_LOG_CATEGORY_ERROR, "StringID database %s could not be saved", KALEIDOSCOPE_STRINGID_DATABASE);
+			}
+#endif
+
+			std::memset(gStringTable, 0, sizeof(gStringTable));
+			Atomic::Atomic_set(&gNumStrings, 0);
+			Atomic::Atomic_set(&gNumCollisions, 0);
+
+			ArenaChunk* chunk = static_cast<ArenaChunk*>(Atomic::Atomic_setPtr(&gArenaHead, NULL));
+			while (chunk != NULL)
+			{
+				ArenaChunk* next = chunk->mNext;
+				std::free(chunk);
+				chunk = next;
+			}
 			return true;
 		}
 
@@ -62,17 +178,103 @@ namespace kaleidoscope
 	 *
 	 * Takes in a c str, computes its StringID sid, and returns sid
 	 * THIS FUNCTION DOES NOT KEEP A RECORD OF THE STRING IN THE STRINGID SYSTEM.
+	 * Gives the same ids as the "name"_sid literal, hashes the string in one pass without a strlen.
 	 */
 	StringID hashCRC32(const char *str)
 	{
-		boost::crc_32_type crc32Computer;
+		U32 crc = 0xFFFFFFFFu;
+		for (const U8* c = reinterpret_cast<const U8*>(str); *c != '\0'; ++c)
+		{
+			crc = crcTable[(crc ^ *c) & 0xFFu] ^ (crc >> 8);
+		}
+		return crc ^ 0xFFFFFFFFu;
+	}
+
+
+	/*
+	 * kaleidoscope::StringID kaleidoscope::hashCRC32Lower(const char *str)
+	 *
+	 * Takes in a c str and returns the StringID of its lowercase form, folding 'A' - 'Z' as it hashes.
+	 * Used to match keys regardless of capitalization, nothing is allocated and the string is not interned.
+	 */
+	StringID hashCRC32Lower(const char *str)
+	{
+		U32 crc = 0xFFFFFFFFu;
+		for (const U8* c = reinterpret_cast<const U8*>(str); *c != '\0'; ++c)
+		{
+			const U8 folded = ((*c >= 'A' && *c <= 'Z') ? static_cast<U8>(*c + ('a' - 'A')) : *c);
+			crc = crcTable[(crc ^ folded) & 0xFFu] ^ (crc >> 8);
+		}
+		return crc ^ 0xFFFFFFFFu;
+	}
+
+
+	/*
+	* const char * kaleidoscope::insertString(kaleidoscope::StringID sid, const char *str)
+	*
+	* Stores str under sid unless sid is already stored.
+	* Returns the string stored for sid, which differs from str if the two collide.
+	* Lock free, threads only contend when they claim the same slot.
+	* Probing stops after MAXPROBES slots so a crowded table can not make every insert walk all of it.
+	*/
+	static const char * insertString(StringID sid, const char *str)
+	{
+		StringRecord* record = NULL;
+		for (U32 probe = 0; probe < MAXPROBES; ++probe)
+		{
+			void** slot = &gStringTable[(sid + probe) & TABLEMASK];
+			StringRecord* existing = static_cast<StringRecord*>(Atomic::Atomic_getPtr(slot));
 
-		U32 numBytes = strlen(str) * sizeof(char);
+			if (existing == NULL)
+			{
+				if (record == NULL)
+				{
+					const U32 length = static_cast<U32>(strlen(str));
+					record = static_cast<StringRecord*>(arenaAllocate(sizeof(StringRecord) + length));
+					if (record == NULL)
+					{
+						// Out of memory, the id is still valid but getString() will not find it.
+						return str;
+					}
+					record->mSid = sid;
+					std::memcpy(record->mString, str, length + 1);
+				}
 
-		crc32Computer.process_bytes(str, numBytes);
-		StringID retID = crc32Computer.checksum();
+				if (Atomic::Atomic_compareAndSwapPtr(slot, NULL, record))
+				{
+					Atomic::Atomic_add(&gNumStrings, 1);
+					return record->mString;
+				}
 
-		return retID;
+				// Another thread claimed the slot first, check what it stored.
+				existing = static_cast<StringRecord*>(Atomic::Atomic_getPtr(slot));
+			}
+
+			if (existing->mSid == sid)
+			{
+				// This id is already in the table, an unused record stays in the arena until shutdown.
+				return existing->mString;
+			}
+		}
+
+		// The table is full around sid, the id is still valid but getString() will not find it.
+		return str;
+	}
+
+
+	/*
+	* void kaleidoscope::checkCollision(kaleidoscope::StringID sid, const char *stored, const char *str)
+	*
+	* Reports str if a different string is already stored under its id.
+	*/
+	static void checkCollision(StringID sid, const char *stored, const char *str)
+	{
+		if (stored != str && std::strcmp(stored, str) != 0)
+		{
+			Atomic::Atomic_add(&gNumCollisions, 1);
+			// SDL_Log directly, strings are interned before the log manager starts.
+			SDL_LogError(SDL_LOG_CATEGORY_ERROR, "StringID collision: \"%s\" and \"%s\" both hash to %u", stored, str, sid);
+		}
 	}
 
 
@@ -80,20 +282,20 @@ namespace kaleidoscope
 	* kaleidoscope::StringID kaleidoscope::internString(const char *str)
 	*
 	* Takes in a c str, computes its StringID sid, stores a record of the string and returns sid
+	* With KALEIDOSCOPE_STRIP_STRINGS nothing is stored, see StringIDLoadDatabase().
 	*/
 	StringID internString(const char *str)
 	{
 		StringID sid = hashCRC32(str);
 
-		Semaphore::Semaphore_wait(&internSem);
-		boost::unordered_map<StringID, const char *>::iterator it = gStringIDTable.find(sid);
-
-		if (it == gStringIDTable.end())
-		{
-			// This string has not yet been added to the table.
-			gStringIDTable[sid] = _strdup(str);
-		}
-		Semaphore::Semaphore_post(&internSem);
+#ifndef KALEIDOSCOPE_STRIP_STRINGS
+		const char * stored = insertString(sid, str);
+#ifdef KALEIDOSCOPE_STRINGID_COLLISIONS
+		checkCollision(sid, stored, str);
+#else
+		static_cast<void>(stored);
+#endif
+#endif
 
 		return sid;
 	}
@@ -103,10 +305,136 @@ namespace kaleidoscope
 	* const char * kaleidoscope::getString(kaleidoscope::StringID sid)
 	*
 	* Takes a StringID sid and returns the c string it represents if its value is stored.
+	* Returns NULL if it is not stored. Never inserts and never waits.
 	*/
 	const char * getString(StringID sid)
 	{
-		return gStringIDTable[sid];
+		for (U32 probe = 0; probe < MAXPROBES; ++probe)
+		{
+			StringRecord* existing = static_cast<StringRecord*>(Atomic::Atomic_getPtr(&gStringTable[(sid + probe) & TABLEMASK]));
+			if (existing == NULL)
+			{
+				return NULL;
+			}
+			if (existing->mSid == sid)
+			{
+				return existing->mString;
+			}
+		}
+		return NULL;
+	}
+
+
+	/*
+	* U32 kaleidoscope::getNumInternedStrings()
+	*
+	* Returns the number of strings stored in the StringID system.
+	*/
+	U32 getNumInternedStrings()
+	{
+		return static_cast<U32>(Atomic::Atomic_get(&gNumStrings));
+	}
+
+
+	/*
+	* U32 kaleidoscope::getNumStringIDCollisions()
+	*
+	* Returns the number of collisions found, always 0 without KALEIDOSCOPE_STRINGID_COLLISIONS.
+	*/
+	U32 getNumStringIDCollisions()
+	{
+		return static_cast<U32>(Atomic::Atomic_get(&gNumCollisions));
+	}
+
+
+	/*
+	* bool kaleidoscope::StringIDSaveDatabase(const char *path)
+	*
+	* Writes every stored string to path as "id string" lines, sorted by id.
+	* Strings containing a newline are skipped as they cannot be read back.
+	* Returns false if the file could not be written.
+	*/
+	bool StringIDSaveDatabase(const char *path)
+	{
+		std::vector<const StringRecord*> records;
+		for (U32 i = 0; i < TABLESIZE; ++i)
+		{
+			const StringRecord* r = static_cast<const StringRecord*>(Atomic::Atomic_getPtr(&gStringTable[i]));
+			if (r != NULL && std::strchr(r->mString, '\n') == NULL)
+			{
+				records.push_back(r);
+			}
+		}
+		std::sort(records.begin(), records.end(), RecordOrder());
+
+		FILE* db = std::fopen(path, "w");
+		if (db == NULL)
+		{
+			return false;
+		}
+		for (std::vector<const StringRecord*>::iterator r = records.begin(); r != records.end(); ++r)
+		{
+			std::fprintf(db, "%u %s\n", (*r)->mSid, (*r)->mString);
+		}
+		return std::fclose(db) == 0;
+	}
+
+
+	/*
+	* bool kaleidoscope::StringIDLoadDatabase(const char *path)
+	*
+	* Stores every string in a file written by StringIDSaveDatabase().
+	* This is how builds with KALEIDOSCOPE_STRIP_STRINGS get their strings back, so the file must come from a run
+	*	that touched all of the content.
+	* With KALEIDOSCOPE_STRINGID_COLLISIONS the ids are checked against the strings and against what is already stored.
+	* Returns false if the file could not be read.
+	*/
+	bool StringIDLoadDatabase(const char *path)
+	{
+		FILE* db = std::fopen(path, "r");
+		if (db == NULL)
+		{
+			return false;
+		}
+
+		std::string line;
+		I32 c;
+		do
+		{
+			c = std::fgetc(db);
+			if (c != '\n' && c != EOF)
+			{
+				line.push_back(static_cast<char>(c));
+				continue;
+			}
+
+			// The last line may end at the end of the file without a newline.
+			if (line.empty())
+			{
+				continue;
+			}
+
+			const size_t space = line.find(' ');
+			if (space != std::string::npos)
+			{
+				const StringID sid = static_cast<StringID>(std::strtoul(line.c_str(), NULL, 10));
+				const char * str = line.c_str() + space + 1;
+				const char * stored = insertString(sid, str);
+#ifdef KALEIDOSCOPE_STRINGID_COLLISIONS
+				if (hashCRC32(str) != sid)
+				{
+					SDL_LogError(SDL_LOG_CATEGORY_ERROR, "StringID database %s: \"%s\" does not hash to %u", path, str, sid);
+				}
+				checkCollision(sid, stored, str);
+#else
+				static_cast<void>(stored);
+#endif
+			}
+			line.clear();
+		} while (c != EOF);
+
+		std::fclose(db);
+		return true;
 	}
 
 }
\ No newline at end of file
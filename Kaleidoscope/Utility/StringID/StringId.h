@@ -5,20 +5,80 @@
 #include <Synchronization/Locks/Semaphore/Semaphore.h>
 
 
-#include <boost/crc.hpp>
 #include <boost/unordered_map.hpp>
 
+#include <cstddef>
+
 namespace kaleidoscope
 {
 
 	typedef U32 StringID;
 
-	static const StringID NULLNAME = 2226387543;
+	// Compile time CRC32 (the zlib / boost::crc_32_type polynomial), gives the same ids as hashCRC32.
+	// Constant ids should be written as "name"_sid so they are compile time values usable in switch statements.
+	namespace crc32
+	{
+		static const U32 POLYNOMIAL = 0xEDB88320u;
+
+		// The table entry for one byte, eight shifts of the reflected polynomial.
+		constexpr U32 byteEntry(U32 c, U32 bits)
+		{
+			return (bits == 0 ? c : byteEntry(((c & 1u) != 0 ? (POLYNOMIAL ^ (c >> 1)) : (c >> 1)), bits - 1));
+		}
+
+		constexpr U32 update(U32 crc, U8 byte)
+		{
+			return byteEntry((crc ^ byte) & 0xFFu, 8) ^ (crc >> 8);
+		}
+
+		constexpr U32 process(const char * str, size_t length, U32 crc)
+		{
+			return (length == 0 ? crc : process(str + 1, length - 1, update(crc, static_cast<U8>(*str))));
+		}
+
+		constexpr size_t length(const char * str)
+		{
+			return (*str == '\0' ? 0 : 1 + length(str + 1));
+		}
+	}
+
+	constexpr StringID hashCRC32Constant(const char * str)
+	{
+		return crc32::process(str, crc32::length(str), 0xFFFFFFFFu) ^ 0xFFFFFFFFu;
+	}
+
+	constexpr StringID operator"" _sid(const char * str, size_t length)
+	{
+		return crc32::process(str, length, 0xFFFFFFFFu) ^ 0xFFFFFFFFu;
+	}
+
+	static_assert(""_sid == 0u, "StringID crc32 of the empty string");
+	static_assert("null"_sid == 634125391u, "StringID crc32 mismatch");
+	static_assert("gameobject"_sid == 279330559u, "StringID crc32 mismatch");
+
+	static const StringID NULLNAME = "NULLNAME"_sid;
+	static_assert(NULLNAME == 2226387543u, "NULLNAME must keep its value");
 
 	extern bool StringIDInit();
 	extern bool StringIDShutdown();
 	extern StringID internString(const char *str);
 	extern StringID hashCRC32(const char *str);
+	extern StringID hashCRC32Lower(const char *str);
 	extern const char * getString(StringID sid);
+	extern U32 getNumInternedStrings();
+
+	// Collision checks compare each interned string with the one already stored for its id, on in debug builds.
+	// KALEIDOSCOPE_STRIP_STRINGS stops internString from storing strings, getString then only knows the strings
+	//	loaded from a database saved by a build without it. StringIDInit loads KALEIDOSCOPE_STRINGID_DATABASE in
+	//	those builds, and debug builds save it from StringIDShutdown.
+#if defined(_DEBUG) && !defined(KALEIDOSCOPE_STRINGID_COLLISIONS)
+#define KALEIDOSCOPE_STRINGID_COLLISIONS
+#endif
+#ifndef KALEIDOSCOPE_STRINGID_DATABASE
+#define KALEIDOSCOPE_STRINGID_DATABASE "stringids.txt"
+#endif
+	extern U32 getNumStringIDCollisions();
+	extern bool StringIDSaveDatabase(const char *path);
+	extern bool StringIDLoadDatabase(const char *path);
 
 }
\ No newline at end of file